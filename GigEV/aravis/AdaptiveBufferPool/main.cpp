@@ -0,0 +1,126 @@
+/* SPDX-License-Identifier:Unlicense */
+
+#include "common/PhoAravisCommon.h"
+#include "common/AdaptiveBufferPool.h"
+#include "common/DeviceConfig.h"
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+
+using namespace pho;
+
+/*
+ * Streams freerun frames with a simulated, jittering processing time and lets AdaptiveBufferPool size the stream
+ * buffer pool within a memory budget. Every 20th frame takes `spike` ms longer, the pool grows until these spikes
+ * no longer cause underruns. The pool state is printed every second, its decisions at the end.
+ *
+ * Usage: AdaptiveBufferPool <device IP> [seconds [processing ms [spike ms [budget MiB]]]]
+ */
+int main (int argc, char **argv)
+{
+    if(argc < 2) {
+        std::cerr << "Provide device IP as a parameter!" << std::endl;
+        return 1;
+    }
+
+    const char* deviceIp = argv[1];
+    const int seconds = argc >= 3 ? std::max(1, std::stoi(argv[2])) : 30;
+    const int processingMs = argc >= 4 ? std::max(0, std::stoi(argv[3])) : 5;
+    const int spikeMs = argc >= 5 ? std::max(0, std::stoi(argv[4])) : 200;
+
+    AdaptiveBufferPool::Config poolConfig;
+    if (argc >= 6) {
+        poolConfig.memoryBudget = size_t(std::max(1, std::stoi(argv[5]))) << 20;
+    }
+
+    GError *error = nullptr;
+
+    /* Connect to the first available camera */
+    auto camera = create_gobject_unique(arv_camera_new (deviceIp, &error));
+    if(error) {
+        std::cerr << "Error: " << error->message << std::endl;
+        return 1;
+    }
+
+    if(!ARV_IS_CAMERA(camera.get())) {
+        std::cerr << "Error: Not a camera instance!";
+        return 1;
+    }
+
+    std::cerr << "Connected to camera: " << arv_camera_get_model_name (camera.get(), nullptr) << std::endl;
+
+    ///-----------------------------------------------------------------------------------------------------------------
+
+    arv_camera_gv_set_packet_size_adjustment (camera.get(), ARV_GV_PACKET_SIZE_ADJUSTMENT_ALWAYS);
+
+    DeviceConfig config;
+    config.triggerMode = TriggerMode::Freerun;
+    config.components = {{Intensity, true}, {Range, true}, {Normal, false}, {Confidence, false}, {Event, false},
+                         {ColorCameraImage, false}, {CoordinateMapA, false}, {CoordinateMapB, false}};
+    config.outputFormat = StreamOutputFormat::MultipartData;
+
+    if(!DeviceConfigurator(camera.get()).apply(config)) {
+        std::cerr << "Error: Failed to configure the device!" << std::endl;
+        return 1;
+    }
+
+    size_t payload = arv_camera_get_payload (camera.get(), &error);
+    if(error) {
+        std::cerr << "Error: Failed to obtain payload size!" << std::endl;
+        return 1;
+    }
+    std::cout << "Payload size: " << payload << " bytes" << std::endl;
+
+    auto stream = create_gobject_unique(arv_camera_create_stream (camera.get(), nullptr, nullptr, &error));
+    if(error || !ARV_IS_STREAM(stream.get())) {
+        std::cerr << "Error: Failed to create stream!" << std::endl;
+        return 1;
+    }
+
+    /* Declared after the stream, it must not outlive it */
+    AdaptiveBufferPool pool(poolConfig);
+    if(!pool.start(stream.get(), payload)) {
+        return 1;
+    }
+    std::cout << "Buffer pool: " << pool.allocated() << " buffers, at most " << pool.maxBuffers() << std::endl;
+
+    arv_camera_start_acquisition(camera.get(), &error);
+    if(error) {
+        std::cerr << "Error: Failed to start acquisition!" << std::endl;
+        return 1;
+    }
+    std::cout << "Acquisition started..." << std::endl;
+
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> jitter(0, std::max(1, processingMs / 2));
+    const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    auto nextReport = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    uint64_t frames = 0;
+    while (std::chrono::steady_clock::now() < end) {
+        auto* buffer = arv_stream_timeout_pop_buffer(stream.get(), 1000000);
+        if (!ARV_IS_BUFFER (buffer)) {
+            continue;
+        }
+
+        /* Simulated processing */
+        const int ms = processingMs + jitter(random) + (++frames % 20 == 0 ? spikeMs : 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+
+        pool.release(buffer);
+
+        if (std::chrono::steady_clock::now() >= nextReport) {
+            nextReport += std::chrono::seconds(1);
+            std::cout << "Frames " << frames << ", pool " << pool.allocated() << " buffers ("
+                      << pool.bytes() / 1024 / 1024 << " MiB), underruns "
+                      << StreamStatistics::transport(stream.get()).underruns << std::endl;
+        }
+    }
+
+    arv_camera_stop_acquisition(camera.get(), nullptr);
+    std::cout << "Acquisition stopped..." << std::endl;
+
+    pool.print(std::cout);
+    return 0;
+}
@@ -0,0 +1,151 @@
+/* SPDX-License-Identifier:Unlicense */
+
+#include "common/PhoAravisCommon.h"
+#include "common/BandwidthOptimizer.h"
+#include "common/BufferArena.h"
+
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace pho;
+
+bool parseNeeds(const std::string& list, ConsumerNeeds& needs) {
+    std::stringstream stream(list);
+    std::string quantity;
+    while (std::getline(stream, quantity, ',')) {
+        if (quantity == "points") {
+            needs.points = true;
+        } else if (quantity == "normals") {
+            needs.normals = true;
+        } else if (quantity == "texture") {
+            needs.texture = true;
+        } else if (quantity == "color") {
+            needs.colorTexture = true;
+        } else if (quantity == "confidence") {
+            needs.confidence = true;
+        } else if (quantity == "events") {
+            needs.events = true;
+        } else {
+            std::cerr << "Error: Unknown quantity '" << quantity << "'!" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Declares which quantities the application consumes and lets BandwidthOptimizer pick the smallest transport
+ * formats the device supports (ProjectedC range, Coord3D_AC8 normals, YCoCg color). Frames are decoded on the host
+ * and the bytes saved on the link and the decoding time per frame are printed.
+ *
+ * Quantities: points, normals, texture, color, confidence, events (comma separated, default points,normals,texture)
+ *
+ * Usage: BandwidthOptimizer <device IP> [quantities [frames]]
+ */
+int main (int argc, char **argv)
+{
+    if(argc < 2) {
+        std::cerr << "Provide device IP as a parameter!" << std::endl;
+        return 1;
+    }
+
+    const char* deviceIp = argv[1];
+    ConsumerNeeds needs;
+    if(!parseNeeds(argc >= 3 ? argv[2] : "points,normals,texture", needs)) {
+        return 1;
+    }
+    const int frames = argc >= 4 ? std::max(1, std::stoi(argv[3])) : 20;
+
+    GError *error = nullptr;
+
+    /* Connect to the first available camera */
+    auto camera = create_gobject_unique(arv_camera_new (deviceIp, &error));
+    if(error) {
+        std::cerr << "Error: " << error->message << std::endl;
+        return 1;
+    }
+
+    if(!ARV_IS_CAMERA(camera.get())) {
+        std::cerr << "Error: Not a camera instance!";
+        return 1;
+    }
+
+    std::cerr << "Connected to camera: " << arv_camera_get_model_name (camera.get(), nullptr) << std::endl;
+
+    ///-----------------------------------------------------------------------------------------------------------------
+
+    if(!setTriggerMode(camera.get(), TriggerMode::Freerun)) {
+        return 1;
+    }
+
+    arv_camera_gv_set_packet_size_adjustment (camera.get(), ARV_GV_PACKET_SIZE_ADJUSTMENT_ALWAYS);
+
+    /* Transport formats are chosen and the decoders prepared BEFORE creating the stream */
+    BandwidthOptimizer optimizer;
+    TransportPlan plan;
+    if(!optimizer.configure(camera.get(), needs, &plan)) {
+        return 1;
+    }
+    plan.print(std::cout);
+
+    MultipartViews views;
+    if(!views.configure(camera.get())) {
+        std::cerr << "Error: Failed to read enabled components!" << std::endl;
+        return 1;
+    }
+
+    BufferArena arena;
+    auto stream = create_gobject_unique(arv_camera_create_stream (camera.get(), nullptr, nullptr, &error));
+    if(error || !ARV_IS_STREAM(stream.get())) {
+        std::cerr << "Error: Failed to create stream!" << std::endl;
+        return 1;
+    }
+
+    if(!arena.allocate(plan.payload, 10)) {
+        return 1;
+    }
+    arena.pushBuffers(stream.get());
+
+    arv_camera_start_acquisition(camera.get(), &error);
+    if(error) {
+        std::cerr << "Error: Failed to start acquisition!" << std::endl;
+        return 1;
+    }
+
+    const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    DecodedFrame frame;
+    size_t decoded = 0, savedBytes = 0;
+    double decodeMs = 0.0;
+    for (int i = 0; i < frames; i++) {
+        auto* buffer = arv_stream_timeout_pop_buffer(stream.get(), 5000000);
+        if (!ARV_IS_BUFFER (buffer)) {
+            std::cerr << "Error: No buffer received!" << std::endl;
+            break;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        if (arv_buffer_get_status(buffer) == ARV_BUFFER_STATUS_SUCCESS && views.map(buffer)
+            && optimizer.decode(views, frame, threads)) {
+            decodeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            savedBytes += frame.savedBytes();
+            ++decoded;
+            if (frame.points) {
+                const Vec3D& center = frame.points[size_t(frame.height / 2) * frame.width + frame.width / 2];
+                std::cout << "Frame " << i << " center point: [" << center.x << ", " << center.y << ", " << center.z
+                          << "]" << std::endl;
+            }
+        }
+
+        arv_stream_push_buffer (stream.get(), buffer);
+    }
+
+    arv_camera_stop_acquisition(camera.get(), nullptr);
+
+    if (decoded) {
+        std::cout << "Decoded " << decoded << " frames, " << savedBytes / decoded << " bytes saved per frame, "
+                  << decodeMs / decoded << " ms host decoding per frame" << std::endl;
+    }
+    return 0;
+}
@@ -141,6 +141,9 @@ int main (int argc, char **argv)
     auto nparts = arv_buffer_get_n_parts (buffer);
     std::cout << "MULTIPART Buffer contains: " << nparts << " parts\n";
 
+    /* Note: for per-frame access in an acquisition loop, see MultipartViews in common/PhoAravisCommon.h which
+     * resolves the component IDs once and indexes the parts without searching every buffer.
+     */
     gint partId = -1;
     size_t dataSize = 0;
     for(const auto& component: componentStrIdPairs) {
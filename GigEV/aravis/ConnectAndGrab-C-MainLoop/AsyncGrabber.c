@@ -0,0 +1,416 @@
+#include "AsyncGrabber.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+typedef struct _Camera Camera;
+
+/* One per buffer, attached as the buffer's user data */
+typedef struct {
+    Camera* camera;
+    gint64 queuedNs;    /* written by the stream thread before queuing the buffer */
+} BufferSlot;
+
+struct _Camera {
+    PhoAsyncGrabber* grabber;
+    guint index;
+    ArvCamera* camera;
+    ArvStream* stream;
+    BufferSlot* slots;
+    guint bufferCount;
+    gulong signalId;
+    PhoAsyncStatistics statistics;
+};
+
+typedef struct {
+    guint id;
+    PhoFrameCallback callback;  /* NULL once removed */
+    gpointer userData;
+    GDestroyNotify destroy;
+} Callback;
+
+typedef struct {
+    GSource source;
+    PhoAsyncGrabber* grabber;
+} GrabberSource;
+
+struct _PhoAsyncGrabber {
+    GSource* source;
+    GAsyncQueue* queue;         /* ArvBuffer*, pushed by the stream threads */
+    GPtrArray* cameras;         /* Camera* */
+    GArray* callbacks;          /* Callback */
+    guint nextCallbackId;
+    guint bufferCount;          /* all cameras, bounds the buffers handled in one dispatch */
+    gboolean running;
+    gboolean dispatching;
+    gboolean callbacksRemoved;
+    guint64 dispatches;
+    guint64 dispatchNs;
+};
+
+static gint64 nowNs(void) {
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    return (gint64) (counter.QuadPart / frequency.QuadPart * 1000000000
+                     + counter.QuadPart % frequency.QuadPart * 1000000000 / frequency.QuadPart);
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (gint64) now.tv_sec * 1000000000 + now.tv_nsec;
+#endif
+}
+
+/**
+ * Stream thread: queue the buffer and wake up the main context.
+ *
+ * The context is only woken up when the queue was empty, otherwise a dispatch is already pending or running and
+ * drains the queue.
+ */
+static void onNewBuffer(ArvStream* stream, gpointer userData) {
+    Camera* camera = userData;
+    ArvBuffer* buffer = arv_stream_try_pop_buffer(stream);
+    if (!buffer) {
+        return;
+    }
+
+    BufferSlot* slot = arv_buffer_get_user_data(buffer);
+    slot->queuedNs = nowNs();
+
+    GAsyncQueue* queue = camera->grabber->queue;
+    g_async_queue_lock(queue);
+    g_async_queue_push_unlocked(queue, buffer);
+    const gboolean wasEmpty = g_async_queue_length_unlocked(queue) == 1;
+    g_async_queue_unlock(queue);
+
+    if (wasEmpty) {
+        g_source_set_ready_time(camera->grabber->source, 0);
+    }
+}
+
+static void compactCallbacks(PhoAsyncGrabber* grabber) {
+    for (guint i = grabber->callbacks->len; i > 0; --i) {
+        if (!g_array_index(grabber->callbacks, Callback, i - 1).callback) {
+            g_array_remove_index(grabber->callbacks, i - 1);
+        }
+    }
+    grabber->callbacksRemoved = FALSE;
+}
+
+/* Calls the callbacks and pushes the buffer back to its stream */
+static void handleBuffer(PhoAsyncGrabber* grabber, ArvBuffer* buffer) {
+    const gint64 start = nowNs();
+    BufferSlot* slot = arv_buffer_get_user_data(buffer);
+    Camera* camera = slot->camera;
+    PhoAsyncStatistics* statistics = &camera->statistics;
+
+    const guint64 latency = (guint64) (start - slot->queuedNs);
+    statistics->received++;
+    statistics->latencyNs += latency;
+    if (latency > statistics->maxLatencyNs) {
+        statistics->maxLatencyNs = latency;
+    }
+
+    gint64 callbackNs = 0;
+    if (!grabber->running) {
+        /* Queued before the acquisition was stopped */
+    } else if (arv_buffer_get_status(buffer) != ARV_BUFFER_STATUS_SUCCESS) {
+        statistics->failed++;
+    } else {
+        const gint64 callbackStart = nowNs();
+        /* Callbacks added from inside a callback are called from the next buffer on */
+        const guint count = grabber->callbacks->len;
+        for (guint i = 0; i < count; ++i) {
+            const Callback callback = g_array_index(grabber->callbacks, Callback, i);
+            if (callback.callback) {
+                callback.callback(grabber, camera->index, buffer, callback.userData);
+            }
+        }
+        callbackNs = nowNs() - callbackStart;
+        statistics->delivered++;
+    }
+
+    arv_stream_push_buffer(camera->stream, buffer);
+    statistics->callbackNs += callbackNs;
+    statistics->overheadNs += nowNs() - start - callbackNs;
+}
+
+static gboolean dispatchBuffers(GSource* source, GSourceFunc callback, gpointer userData) {
+    (void) callback;
+    (void) userData;
+    PhoAsyncGrabber* grabber = ((GrabberSource*) source)->grabber;
+    const gint64 start = nowNs();
+
+    /* Before draining, a buffer queued meanwhile wakes the context up again */
+    g_source_set_ready_time(source, -1);
+
+    grabber->dispatching = TRUE;
+    for (guint i = 0; i < grabber->bufferCount; ++i) {
+        ArvBuffer* buffer = g_async_queue_try_pop(grabber->queue);
+        if (!buffer) {
+            break;
+        }
+        handleBuffer(grabber, buffer);
+    }
+    grabber->dispatching = FALSE;
+
+    /* Leave the rest for the next iteration so that other sources of the context are not starved */
+    if (g_async_queue_length(grabber->queue) > 0) {
+        g_source_set_ready_time(source, 0);
+    }
+    if (grabber->callbacksRemoved) {
+        compactCallbacks(grabber);
+    }
+
+    grabber->dispatches++;
+    grabber->dispatchNs += nowNs() - start;
+    return G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs grabberSourceFuncs = {
+    NULL, /* prepare, the ready time is used instead */
+    NULL, /* check */
+    dispatchBuffers,
+    NULL, /* finalize */
+    NULL,
+    NULL,
+};
+
+/* Pushes queued buffers back to their streams without calling the callbacks */
+static void recycleQueuedBuffers(PhoAsyncGrabber* grabber, gboolean streamsAlive) {
+    ArvBuffer* buffer;
+    while ((buffer = g_async_queue_try_pop(grabber->queue))) {
+        BufferSlot* slot = arv_buffer_get_user_data(buffer);
+        if (streamsAlive) {
+            arv_stream_push_buffer(slot->camera->stream, buffer);
+        } else {
+            g_object_unref(buffer);
+        }
+    }
+}
+
+PhoAsyncGrabber* phoAsyncGrabberNew(GMainContext* context) {
+    PhoAsyncGrabber* grabber = g_new0(PhoAsyncGrabber, 1);
+    grabber->queue = g_async_queue_new();
+    grabber->cameras = g_ptr_array_new();
+    grabber->callbacks = g_array_new(FALSE, FALSE, sizeof(Callback));
+    grabber->nextCallbackId = 1;
+
+    grabber->source = g_source_new(&grabberSourceFuncs, sizeof(GrabberSource));
+    ((GrabberSource*) grabber->source)->grabber = grabber;
+    g_source_set_name(grabber->source, "PhoAsyncGrabber");
+    g_source_set_ready_time(grabber->source, -1);
+    g_source_attach(grabber->source, context);
+    return grabber;
+}
+
+void phoAsyncGrabberFree(PhoAsyncGrabber* grabber) {
+    if (!grabber) {
+        return;
+    }
+
+    phoAsyncGrabberStop(grabber);
+
+    /* Destroying a stream joins its thread, a signal emitted meanwhile may still have queued a buffer */
+    for (guint i = 0; i < grabber->cameras->len; ++i) {
+        Camera* camera = g_ptr_array_index(grabber->cameras, i);
+        g_clear_object(&camera->stream);
+    }
+    recycleQueuedBuffers(grabber, FALSE);
+
+    g_source_destroy(grabber->source);
+    g_source_unref(grabber->source);
+
+    for (guint i = 0; i < grabber->cameras->len; ++i) {
+        Camera* camera = g_ptr_array_index(grabber->cameras, i);
+        g_clear_object(&camera->camera);
+        g_free(camera->slots);
+        g_free(camera);
+    }
+    g_ptr_array_unref(grabber->cameras);
+
+    for (guint i = 0; i < grabber->callbacks->len; ++i) {
+        Callback* callback = &g_array_index(grabber->callbacks, Callback, i);
+        if (callback->callback && callback->destroy) {
+            callback->destroy(callback->userData);
+        }
+    }
+    g_array_unref(grabber->callbacks);
+    g_async_queue_unref(grabber->queue);
+    g_free(grabber);
+}
+
+gint phoAsyncGrabberAddCamera(PhoAsyncGrabber* grabber, ArvCamera* camera, guint bufferCount, GError** err) {
+    g_return_val_if_fail(grabber && ARV_IS_CAMERA(camera) && bufferCount > 0, -1);
+    g_return_val_if_fail(!grabber->running, -1);
+
+    GError* error = NULL;
+    const guint payload = arv_camera_get_payload(camera, &error);
+    if (error) {
+        g_propagate_error(err, error);
+        return -1;
+    }
+
+    ArvStream* stream = arv_camera_create_stream(camera, NULL, NULL, &error);
+    if (error) {
+        g_propagate_error(err, error);
+        return -1;
+    }
+
+    Camera* entry = g_new0(Camera, 1);
+    entry->grabber = grabber;
+    entry->index = grabber->cameras->len;
+    entry->camera = g_object_ref(camera);
+    entry->stream = stream;
+    entry->bufferCount = bufferCount;
+    entry->slots = g_new0(BufferSlot, bufferCount);
+    for (guint i = 0; i < bufferCount; ++i) {
+        entry->slots[i].camera = entry;
+        arv_stream_push_buffer(stream, arv_buffer_new_full(payload, NULL, &entry->slots[i], NULL));
+    }
+
+    g_ptr_array_add(grabber->cameras, entry);
+    grabber->bufferCount += bufferCount;
+    return (gint) entry->index;
+}
+
+guint phoAsyncGrabberAddCallback(PhoAsyncGrabber* grabber, PhoFrameCallback callback, gpointer userData,
+                                 GDestroyNotify destroy) {
+    g_return_val_if_fail(grabber && callback, 0);
+
+    Callback entry = {grabber->nextCallbackId++, callback, userData, destroy};
+    g_array_append_val(grabber->callbacks, entry);
+    return entry.id;
+}
+
+void phoAsyncGrabberRemoveCallback(PhoAsyncGrabber* grabber, guint id) {
+    g_return_if_fail(grabber);
+
+    for (guint i = 0; i < grabber->callbacks->len; ++i) {
+        Callback* callback = &g_array_index(grabber->callbacks, Callback, i);
+        if (callback->id != id || !callback->callback) {
+            continue;
+        }
+
+        /* Only marked while dispatching, the array is compacted afterwards */
+        GDestroyNotify destroy = callback->destroy;
+        gpointer userData = callback->userData;
+        callback->callback = NULL;
+        grabber->callbacksRemoved = TRUE;
+        if (!grabber->dispatching) {
+            compactCallbacks(grabber);
+        }
+        if (destroy) {
+            destroy(userData);
+        }
+        return;
+    }
+}
+
+gboolean phoAsyncGrabberStart(PhoAsyncGrabber* grabber, GError** err) {
+    g_return_val_if_fail(grabber, FALSE);
+    if (grabber->running) {
+        return TRUE;
+    }
+
+    grabber->running = TRUE;
+    for (guint i = 0; i < grabber->cameras->len; ++i) {
+        Camera* camera = g_ptr_array_index(grabber->cameras, i);
+        camera->signalId = g_signal_connect(camera->stream, "new-buffer", G_CALLBACK(onNewBuffer), camera);
+        arv_stream_set_emit_signals(camera->stream, TRUE);
+
+        GError* error = NULL;
+        arv_camera_start_acquisition(camera->camera, &error);
+        if (error) {
+            g_propagate_error(err, error);
+            phoAsyncGrabberStop(grabber);
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+void phoAsyncGrabberStop(PhoAsyncGrabber* grabber) {
+    g_return_if_fail(grabber);
+    if (!grabber->running) {
+        return;
+    }
+
+    grabber->running = FALSE;
+    for (guint i = 0; i < grabber->cameras->len; ++i) {
+        Camera* camera = g_ptr_array_index(grabber->cameras, i);
+        if (!camera->signalId) {
+            continue;
+        }
+        arv_stream_set_emit_signals(camera->stream, FALSE);
+        arv_camera_stop_acquisition(camera->camera, NULL);
+        g_signal_handler_disconnect(camera->stream, camera->signalId);
+        camera->signalId = 0;
+    }
+    recycleQueuedBuffers(grabber, TRUE);
+}
+
+guint phoAsyncGrabberGetCameraCount(const PhoAsyncGrabber* grabber) {
+    g_return_val_if_fail(grabber, 0);
+    return grabber->cameras->len;
+}
+
+ArvStream* phoAsyncGrabberGetStream(const PhoAsyncGrabber* grabber, guint camera) {
+    g_return_val_if_fail(grabber && camera < grabber->cameras->len, NULL);
+    return ((Camera*) g_ptr_array_index(grabber->cameras, camera))->stream;
+}
+
+void phoAsyncGrabberGetStatistics(const PhoAsyncGrabber* grabber, guint camera, PhoAsyncStatistics* statistics) {
+    g_return_if_fail(grabber && statistics);
+
+    if (camera != G_MAXUINT) {
+        g_return_if_fail(camera < grabber->cameras->len);
+        *statistics = ((Camera*) g_ptr_array_index(grabber->cameras, camera))->statistics;
+        return;
+    }
+
+    memset(statistics, 0, sizeof(*statistics));
+    for (guint i = 0; i < grabber->cameras->len; ++i) {
+        const PhoAsyncStatistics* cameraStatistics = &((Camera*) g_ptr_array_index(grabber->cameras, i))->statistics;
+        statistics->received += cameraStatistics->received;
+        statistics->delivered += cameraStatistics->delivered;
+        statistics->failed += cameraStatistics->failed;
+        statistics->latencyNs += cameraStatistics->latencyNs;
+        statistics->maxLatencyNs = MAX(statistics->maxLatencyNs, cameraStatistics->maxLatencyNs);
+        statistics->callbackNs += cameraStatistics->callbackNs;
+    }
+    statistics->dispatches = grabber->dispatches;
+    statistics->overheadNs = grabber->dispatchNs > statistics->callbackNs
+                                     ? grabber->dispatchNs - statistics->callbackNs : 0;
+}
+
+void phoAsyncGrabberPrintStatistics(const PhoAsyncGrabber* grabber, FILE* out) {
+    g_return_if_fail(grabber && out);
+
+    PhoAsyncStatistics statistics;
+    for (guint i = 0; i < grabber->cameras->len; ++i) {
+        phoAsyncGrabberGetStatistics(grabber, i, &statistics);
+        fprintf(out, "Camera %u: %" G_GUINT64_FORMAT " received, %" G_GUINT64_FORMAT " delivered, %"
+                G_GUINT64_FORMAT " failed\n", i, statistics.received, statistics.delivered, statistics.failed);
+    }
+
+    phoAsyncGrabberGetStatistics(grabber, G_MAXUINT, &statistics);
+    if (statistics.received == 0) {
+        fprintf(out, "Main loop: no buffers received\n");
+        return;
+    }
+    const double frames = (double) statistics.received;
+    fprintf(out, "Main loop: %" G_GUINT64_FORMAT " dispatches (%.2f buffers each), latency %.1f us avg / %.1f us max,"
+            " overhead %.0f ns per frame, callbacks %.0f ns per frame\n",
+            statistics.dispatches, frames / (double) MAX(statistics.dispatches, 1), statistics.latencyNs / frames / 1e3,
+            statistics.maxLatencyNs / 1e3, statistics.overheadNs / frames, statistics.callbackNs / frames);
+}
@@ -0,0 +1,89 @@
+/**
+ * Asynchronous acquisition from one or more cameras driven by a GLib main loop.
+ *
+ * Buffers are received in the stream's `new-buffer` signal (on the aravis stream thread), queued and dispatched
+ * by a single GSource attached to the application's GMainContext, so all callbacks run on the loop thread and no
+ * thread blocks in arv_stream_pop_buffer(). After the callbacks return, the buffer is pushed back to its stream
+ * automatically, callbacks must not keep pointers into it.
+ *
+ *     PhoAsyncGrabber* grabber = phoAsyncGrabberNew(NULL);           // NULL = default main context
+ *     phoAsyncGrabberAddCamera(grabber, camera, 8, &error);          // configure the camera before
+ *     phoAsyncGrabberAddCallback(grabber, onFrame, userData, NULL);
+ *     phoAsyncGrabberStart(grabber, &error);
+ *     g_main_loop_run(loop);
+ *     phoAsyncGrabberStop(grabber);
+ *     phoAsyncGrabberFree(grabber);
+ *
+ * All functions must be called from the thread running the main context.
+ */
+#ifndef PHOTONEOMAIN_ASYNCGRABBER_H
+#define PHOTONEOMAIN_ASYNCGRABBER_H
+
+#include <arv.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _PhoAsyncGrabber PhoAsyncGrabber;
+
+/* Called on the main loop thread for every successfully received buffer, `camera` is the index returned by
+ * phoAsyncGrabberAddCamera() */
+typedef void (*PhoFrameCallback)(PhoAsyncGrabber* grabber, guint camera, ArvBuffer* buffer, gpointer userData);
+
+typedef struct {
+    guint64 received;       /* buffers delivered by the streams */
+    guint64 delivered;      /* buffers passed to the callbacks */
+    guint64 failed;         /* buffers with a status other than success, recycled without callbacks */
+    guint64 dispatches;     /* main loop wake-ups, several buffers may be handled in one (all cameras only) */
+    guint64 latencyNs;      /* sum of the times from the new-buffer signal to the dispatch of the buffer */
+    guint64 maxLatencyNs;
+    guint64 overheadNs;     /* time spent in the dispatch excluding the callbacks, for all cameras including the
+                               wake-ups, per camera only the handling of its buffers (queue pop, recycling) */
+    guint64 callbackNs;     /* time spent in the callbacks */
+} PhoAsyncStatistics;
+
+/* Creates the grabber and attaches its source to `context` (NULL for the default context) */
+PhoAsyncGrabber* phoAsyncGrabberNew(GMainContext* context);
+
+/* Stops the acquisition, destroys the streams and the source and releases the cameras. Not from a callback. */
+void phoAsyncGrabberFree(PhoAsyncGrabber* grabber);
+
+/*
+ * Creates a stream with `bufferCount` buffers of the current payload size for an already configured camera, the
+ * grabber keeps a reference to the camera. Returns the camera index or -1 on error. Add all cameras before
+ * phoAsyncGrabberStart().
+ */
+gint phoAsyncGrabberAddCamera(PhoAsyncGrabber* grabber, ArvCamera* camera, guint bufferCount, GError** err);
+
+/*
+ * Registers a callback, callbacks are called in the order of registration. `destroy` (may be NULL) is called on
+ * `userData` when the callback is removed or the grabber freed. Returns an id for phoAsyncGrabberRemoveCallback().
+ */
+guint phoAsyncGrabberAddCallback(PhoAsyncGrabber* grabber, PhoFrameCallback callback, gpointer userData,
+                                 GDestroyNotify destroy);
+
+/* Removes a callback, may be called from inside a callback */
+void phoAsyncGrabberRemoveCallback(PhoAsyncGrabber* grabber, guint id);
+
+/* Starts the acquisition on all cameras */
+gboolean phoAsyncGrabberStart(PhoAsyncGrabber* grabber, GError** err);
+
+/* Stops the acquisition, buffers still queued are recycled without callbacks */
+void phoAsyncGrabberStop(PhoAsyncGrabber* grabber);
+
+guint phoAsyncGrabberGetCameraCount(const PhoAsyncGrabber* grabber);
+ArvStream* phoAsyncGrabberGetStream(const PhoAsyncGrabber* grabber, guint camera);
+
+/* Statistics of one camera, or of all cameras if `camera` is G_MAXUINT */
+void phoAsyncGrabberGetStatistics(const PhoAsyncGrabber* grabber, guint camera, PhoAsyncStatistics* statistics);
+
+/* Prints per-camera frame counts and the per-frame loop latency and overhead */
+void phoAsyncGrabberPrintStatistics(const PhoAsyncGrabber* grabber, FILE* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PHOTONEOMAIN_ASYNCGRABBER_H */
@@ -0,0 +1,188 @@
+/**
+ * Asynchronous acquisition from one or more Photoneo devices on a GLib main loop, using the C API in
+ * AsyncGrabber.h.
+ *
+ * Demonstrates
+ *   - receiving buffers from several cameras on one loop thread without blocking pops,
+ *   - plugging the grabber into an existing GMainContext next to other sources (timers here),
+ *   - measuring the per-frame loop overhead and the signal to callback latency.
+ *
+ * Usage:
+ *
+ *   ConnectAndGrabC-MainLoop <device IP> [<device IP> ...] [-t seconds]
+ *   ConnectAndGrabC-MainLoop --benchmark [cameras [seconds]]
+ *
+ * The benchmark runs on aravis' built-in fake cameras, no device needed: the callbacks do no work, so the reported
+ * overhead is the cost of the loop itself (queue, wake-up, dispatch, buffer recycling).
+ *
+ * Compile with
+ *
+ *   gcc -o ConnectAndGrabC-MainLoop main.c AsyncGrabber.c -Wall $(pkg-config --libs --cflags aravis-0.8)
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <arv.h>
+
+#include "AsyncGrabber.h"
+
+void fail(const char *msg) {
+    fprintf(stderr, "Error: %s\n", msg);
+    exit(1);
+}
+
+void checkError(GError* error) {
+    if (error) {
+        fail(error->message);
+    }
+}
+
+typedef struct {
+    guint64* frames;    /* per camera */
+    gboolean verbose;
+} FrameCounter;
+
+void onFrame(PhoAsyncGrabber* grabber, guint camera, ArvBuffer* buffer, gpointer userData) {
+    (void) grabber;
+    FrameCounter* counter = userData;
+    counter->frames[camera]++;
+    if (!counter->verbose) {
+        return;
+    }
+
+    if (arv_buffer_get_payload_type(buffer) == ARV_BUFFER_PAYLOAD_TYPE_MULTIPART) {
+        printf("Camera %u frame %" G_GUINT64_FORMAT ": MULTIPART buffer, %u parts\n",
+               camera, arv_buffer_get_frame_id(buffer), arv_buffer_get_n_parts(buffer));
+    } else {
+        size_t dataSize = 0;
+        arv_buffer_get_data(buffer, &dataSize);
+        printf("Camera %u frame %" G_GUINT64_FORMAT ": %zu bytes\n", camera, arv_buffer_get_frame_id(buffer), dataSize);
+    }
+}
+
+gboolean printStatistics(gpointer userData) {
+    phoAsyncGrabberPrintStatistics(userData, stdout);
+    return G_SOURCE_CONTINUE;
+}
+
+gboolean quitLoop(gpointer userData) {
+    g_main_loop_quit(userData);
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * Configure a device for freerun multipart streaming.
+ */
+ArvCamera* connectCamera(const char* deviceId, gboolean fake, GError **err) {
+    GError *error = NULL;
+    ArvCamera* camera = arv_camera_new(deviceId, &error);
+    if (error) {
+        g_propagate_error(err, error);
+        return NULL;
+    }
+    fprintf(stderr, "Connected to camera: %s\n", arv_camera_get_model_name(camera, NULL));
+
+    arv_camera_set_acquisition_mode(camera, ARV_ACQUISITION_MODE_CONTINUOUS, &error);
+    if (!error) {
+        arv_camera_clear_triggers(camera, &error);
+    }
+    if (!error && fake) {
+        /* As many frames as the fake camera can generate, small so that copying the image does not dominate */
+        double minRate = 0.0, maxRate = 0.0;
+        arv_camera_set_region(camera, 0, 0, 64, 64, &error);
+        if (!error) {
+            arv_camera_get_frame_rate_bounds(camera, &minRate, &maxRate, &error);
+        }
+        if (!error) {
+            arv_camera_set_frame_rate(camera, maxRate, &error);
+        }
+    } else if (!error) {
+        arv_camera_gv_set_packet_size_adjustment(camera, ARV_GV_PACKET_SIZE_ADJUSTMENT_ALWAYS);
+        arv_camera_gv_set_multipart(camera, TRUE, &error);
+    }
+    if (error) {
+        g_propagate_error(err, error);
+        g_clear_object(&camera);
+        return NULL;
+    }
+    return camera;
+}
+
+int main (int argc, char **argv) {
+    if (argc < 2) {
+        fail("Provide device IP(s) or --benchmark as parameters!");
+    }
+
+    const gboolean benchmark = !strcmp(argv[1], "--benchmark");
+    guint seconds = benchmark ? 5 : 10;
+    GPtrArray* deviceIds = g_ptr_array_new();
+    if (benchmark) {
+        /* Every instance of the fake device is an independent camera with its own stream thread */
+        const int cameras = argc >= 3 ? MAX(1, atoi(argv[2])) : 4;
+        seconds = argc >= 4 ? (guint) MAX(1, atoi(argv[3])) : seconds;
+        arv_enable_interface("Fake");
+        for (int i = 0; i < cameras; ++i) {
+            g_ptr_array_add(deviceIds, "Fake_1");
+        }
+    } else {
+        for (int i = 1; i < argc; ++i) {
+            if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+                seconds = (guint) MAX(1, atoi(argv[++i]));
+            } else {
+                g_ptr_array_add(deviceIds, argv[i]);
+            }
+        }
+    }
+
+    GError *error = NULL;
+
+    /* The grabber lives in the default context, the one g_main_loop_new(NULL, ...) runs */
+    PhoAsyncGrabber* grabber = phoAsyncGrabberNew(NULL);
+    for (guint i = 0; i < deviceIds->len; ++i) {
+        ArvCamera* camera = connectCamera(g_ptr_array_index(deviceIds, i), benchmark, &error);
+        checkError(error);
+
+        phoAsyncGrabberAddCamera(grabber, camera, 8, &error);
+        checkError(error);
+        g_clear_object(&camera);
+    }
+
+    FrameCounter counter;
+    counter.frames = g_new0(guint64, deviceIds->len);
+    counter.verbose = !benchmark;
+    phoAsyncGrabberAddCallback(grabber, onFrame, &counter, NULL);
+
+    GMainLoop* loop = g_main_loop_new(NULL, FALSE);
+    g_timeout_add_seconds(1, printStatistics, grabber);
+    g_timeout_add_seconds(seconds, quitLoop, loop);
+
+    phoAsyncGrabberStart(grabber, &error);
+    checkError(error);
+    fprintf(stdout, "Acquisition started on %u camera(s) for %u s...\n", deviceIds->len, seconds);
+
+    const gint64 start = g_get_monotonic_time();
+    g_main_loop_run(loop);
+    const double elapsed = (double) (g_get_monotonic_time() - start) / 1e6;
+
+    phoAsyncGrabberStop(grabber);
+    fprintf(stdout, "Acquisition stopped...\n");
+
+    PhoAsyncStatistics statistics;
+    phoAsyncGrabberGetStatistics(grabber, G_MAXUINT, &statistics);
+    phoAsyncGrabberPrintStatistics(grabber, stdout);
+    fprintf(stdout, "%.1f frames/s in total on one loop thread\n", (double) statistics.delivered / elapsed);
+    if (statistics.received) {
+        /* Busy time of the loop thread, not counting the callbacks */
+        fprintf(stdout, "Loop thread load without callbacks: %.3f %%\n",
+                100.0 * (double) statistics.overheadNs / (elapsed * 1e9));
+    }
+
+    g_main_loop_unref(loop);
+    phoAsyncGrabberFree(grabber);
+    g_free(counter.frames);
+    g_ptr_array_unref(deviceIds);
+
+    return 0;
+}
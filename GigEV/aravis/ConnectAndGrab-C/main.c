@@ -6,6 +6,9 @@
  *   - software trigger or freerun,
  *   - enabling / disabling different components.
  *
+ * Buffers are popped blocking on the main thread, see ConnectAndGrab-C-MainLoop for asynchronous acquisition
+ * from several cameras on a GLib main loop.
+ *
  * Compile with
  *
  *   gcc -o ConnectAndGrabC main.c -Wall $(pkg-config --libs --cflags  aravis-0.8)
@@ -0,0 +1,144 @@
+/* SPDX-License-Identifier:Unlicense */
+
+#include "common/PhoAravisCommon.h"
+#include "common/AcquisitionEngine.h"
+#include "common/CalculateNormals.h"
+
+#include <chrono>
+#include <thread>
+
+using namespace pho;
+
+/* Per-worker state, each worker only touches its own instance so no locking is needed */
+struct WorkerContext {
+    MultipartViews views;
+    std::vector<Vec3D> normals;
+    uint64_t frames = 0;
+};
+
+/*
+ * Connect to the camera, then acquire in freerun for a few seconds. Buffers are received in the stream callback and
+ * processed (normals decoding) on a pool of worker threads, while the main thread only prints statistics.
+ *
+ * Usage: ConnectAndGrab-Callback <device IP> [workers [seconds]]
+ */
+int main (int argc, char **argv)
+{
+    if(argc < 2) {
+        std::cerr << "Provide device IP as a parameter!" << std::endl;
+        return 1;
+    }
+
+    const char* deviceIp = argv[1];
+    const unsigned workers = argc >= 3 ? std::max(1, std::stoi(argv[2])) : 2;
+    const int seconds = argc >= 4 ? std::max(1, std::stoi(argv[3])) : 5;
+
+    GError *error = nullptr;
+
+    /* Connect to the first available camera */
+    auto camera = create_gobject_unique(arv_camera_new (deviceIp, &error));
+    if(error) {
+        std::cerr << "Error: " << error->message << std::endl;
+        return 1;
+    }
+
+    if(!ARV_IS_CAMERA(camera.get())) {
+        std::cerr << "Error: Not a camera instance!";
+        return 1;
+    }
+
+    std::cerr << "Connected to camera: " << arv_camera_get_model_name (camera.get(), nullptr) << std::endl;
+
+    ///-----------------------------------------------------------------------------------------------------------------
+
+    if(!setTriggerMode(camera.get(), TriggerMode::Freerun)) {
+        return 1;
+    }
+
+    arv_camera_gv_set_packet_size_adjustment (camera.get(), ARV_GV_PACKET_SIZE_ADJUSTMENT_ALWAYS);
+
+    /* Intensity, Range and Normal (as Coord3D_AC8 angles, decoded by the workers) */
+    const std::pair<OutputMat, bool> outputMats[] = {
+        {Intensity, true},
+        {Range, true},
+        {Normal, true},
+        {Confidence, false},
+        {Event, false},
+        {ColorCameraImage, false},
+        {CoordinateMapA, false},
+        {CoordinateMapB, false},
+    };
+    for(const auto& output : outputMats) {
+        if(!setOutputMat(camera.get(), output.first, output.second)) {
+            return 1;
+        }
+    }
+
+    arv_camera_set_string(camera.get(), "ComponentSelector", "Normal", &error);
+    if(error) {
+        std::cerr << "Error: Failed to select ComponentSelector='Normal'!";
+        return 1;
+    }
+    arv_camera_set_string(camera.get(), "PixelFormat", "Coord3D_AC8", &error);
+    if(error) {
+        std::cerr << "Error: Failed to set PixelFormat='Coord3D_AC8'!";
+        return 1;
+    }
+
+    if(!setStreamOutputFormat(camera.get(), StreamOutputFormat::MultipartData)) {
+        return 1;
+    }
+
+    MultipartViews views;
+    if(!views.configure(camera.get())) {
+        std::cerr << "Error: Failed to read enabled components!" << std::endl;
+        return 1;
+    }
+
+    std::vector<WorkerContext> contexts(workers);
+    for(auto& context : contexts) {
+        context.views = views;
+    }
+
+    /* Two buffers per worker in flight plus some slack for the stream itself */
+    AcquisitionEngine engine(workers, 2);
+    StreamStatistics streamStatistics;
+    engine.setStreamStatistics(&streamStatistics);
+    const bool started = engine.start(camera.get(), 2 * workers + 4, [&](ArvBuffer* buffer, unsigned worker) {
+        WorkerContext& context = contexts[worker];
+        if(!context.views.map(buffer)) {
+            return;
+        }
+
+        const PartView normal = context.views.normal();
+        /* Coord3D_AC8 is two bytes per pixel, skip if the format was changed to Coord3D_ABC32f */
+        if(normal && ARV_PIXEL_FORMAT_BIT_PER_PIXEL(normal.pixelFormat) == 16) {
+            context.normals.resize(size_t(normal.width) * normal.height);
+            calculateNormals(normal.as<NormalsAngles>(), normal.width, normal.height, context.normals.data());
+        }
+        ++context.frames;
+    });
+    if(!started) {
+        return 1;
+    }
+    std::cout << "Acquisition started with " << workers << " worker(s)..." << std::endl;
+
+    for(int i = 0; i < seconds; ++i) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        const auto statistics = engine.statistics();
+        std::cout << "received: " << statistics.received << " processed: " << statistics.processed
+                  << " dropped: " << statistics.dropped << " failed: " << statistics.failed
+                  << " queue depth: " << statistics.queueDepth << " (max " << statistics.maxQueueDepth << ")"
+                  << std::endl;
+        streamStatistics.print(std::cout, engine.stream());
+    }
+
+    engine.stop();
+    std::cout << "Acquisition stopped..." << std::endl;
+
+    for(unsigned i = 0; i < workers; ++i) {
+        std::cout << "Worker " << i << " processed " << contexts[i].frames << " frames" << std::endl;
+    }
+
+    return 0;
+}
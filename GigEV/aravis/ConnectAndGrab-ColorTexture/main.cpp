@@ -7,6 +7,8 @@
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
 
+#include <thread>
+
 using namespace pho;
 
 void handleImageDataBufferMono16(ArvBuffer *buffer) {
@@ -22,16 +24,14 @@ void handleImageDataBufferMono16(ArvBuffer *buffer) {
     std::cout << "Height: " << height << std::endl;
 
     auto mat = cv::Mat(height, width, CV_16U, (void*)data);
-    cv::Mat rgbMat = YCoCg::convertToRGB(mat);
-
-    /* Normalize just for visualization */
-    cv::normalize(rgbMat, rgbMat, 0, 255, cv::NORM_MINMAX);
-    rgbMat.convertTo(rgbMat, CV_8UC3);
 
-    /* cv::imshow uses BRG format */
-    cv::cvtColor(rgbMat, rgbMat, cv::COLOR_RGB2BGR);
+    /* Decode directly to 8 bit BGR (cv::imshow uses BGR format), scaling is done in the same pass.
+     * The output image is only allocated on the first call, pass the same image for every frame.
+     */
+    static cv::Mat_<YCoCg::RGB8Type> bgrMat;
+    YCoCg::convertToRGB8(mat, bgrMat, YCoCg::ChannelOrder::BGR, std::thread::hardware_concurrency());
 
-    cv::imshow("YCoCg converted to RGB", rgbMat);
+    cv::imshow("YCoCg converted to RGB", bgrMat);
     cv::imshow("YCoCg texture", mat);
     cv::waitKey(0);
 }
@@ -0,0 +1,149 @@
+/* SPDX-License-Identifier:Unlicense */
+
+#include "common/PhoAravisCommon.h"
+#include "common/ProjectedC.h"
+
+#include <thread>
+
+using namespace pho;
+
+/*
+ * Connect to the camera, stream only the depth (ProjectedC) and reconstruct the point cloud on the host using the
+ * cached static coordinate maps.
+ */
+int main (int argc, char **argv)
+{
+    if(argc < 2) {
+        std::cerr << "Provide device IP as a parameter!" << std::endl;
+        return 1;
+    }
+
+    const char* deviceIp = argv[1];
+
+    GError *error = nullptr;
+
+    /* Connect to the first available camera */
+    auto camera = create_gobject_unique(arv_camera_new (deviceIp, &error));
+    if(error) {
+        std::cerr << "Error: " << error->message << std::endl;
+        return 1;
+    }
+
+    if(!ARV_IS_CAMERA(camera.get())) {
+        std::cerr << "Error: Not a camera instance!";
+        return 1;
+    }
+
+    std::cerr << "Connected to camera: " << arv_camera_get_model_name (camera.get(), nullptr) << std::endl;
+
+    /* Set trigger mode */
+    if(!setTriggerMode(camera.get(), TriggerMode::Freerun)) {
+        return 1;
+    }
+
+    arv_camera_gv_set_packet_size_adjustment (camera.get(), ARV_GV_PACKET_SIZE_ADJUSTMENT_ALWAYS);
+
+    /* Enable required output matrices, coordinate maps are only needed once and handled by ProjectedCReconstructor */
+    const std::pair<OutputMat, bool> outputMats[] = {
+        {Intensity, true},
+        {Range, true},
+        {Normal, false},
+        {Confidence, false},
+        {Event, false},
+        {ColorCameraImage, false},
+        {CoordinateMapA, false},
+        {CoordinateMapB, false},
+    };
+
+    for(const auto& output : outputMats) {
+        if(!setOutputMat(camera.get(), output.first, output.second)) {
+            return 1;
+        }
+    }
+
+    /* ProjectedC -> only projected Z value, a third of the CalibratedABC_Grid data */
+    arv_camera_set_string(camera.get(), "Scan3dOutputMode", "ProjectedC", &error);
+    if(error) {
+        std::cerr << "Error: Failed to set Scan3dOutputMode!" << std::endl;
+        return 1;
+    }
+
+    if(!setStreamOutputFormat(camera.get(), StreamOutputFormat::MultipartData)) {
+        return 1;
+    }
+
+    /* Fetch the coordinate maps BEFORE creating the stream, they are cached until relevant settings change.
+     * Call prepare() again after changing settings (with the acquisition stopped).
+     */
+    ProjectedCReconstructor reconstructor;
+    if(!reconstructor.prepare(camera.get())) {
+        std::cerr << "Error: Failed to fetch the coordinate maps!" << std::endl;
+        return 1;
+    }
+    std::cout << "Coordinate maps: " << reconstructor.width() << "x" << reconstructor.height() << std::endl;
+
+    /* Create the stream object */
+    auto stream = create_gobject_unique(arv_camera_create_stream (camera.get(), nullptr, nullptr, &error));
+    if(error) {
+        std::cerr << "Error: " << error->message << std::endl;
+        return 1;
+    }
+
+    if(!ARV_IS_STREAM(stream.get())) {
+        std::cerr << "Error: Not a stream instance!";
+        return 1;
+    }
+
+    /* Retrieve the payload size for buffer creation */
+    size_t payload = arv_camera_get_payload (camera.get(), &error);
+    if(error) {
+        std::cerr << "Error: Failed to obtain payload size!" << std::endl;
+        return 1;
+    }
+    std::cout << "Payload size: " << payload << " bytes" << std::endl;
+
+    /* Insert some buffers in the stream buffer pool */
+    for (int i = 0; i < 10; i++) {
+        arv_stream_push_buffer(stream.get(), arv_buffer_new(payload, nullptr));
+    }
+
+    /* Start the acquisition */
+    arv_camera_start_acquisition(camera.get(), &error);
+    if(error) {
+        std::cerr << "Error: Failed to start acquisition!" << std::endl;
+        return 1;
+    }
+    std::cout << "Acquisition started..." << std::endl;
+
+    /* Point cloud buffer is allocated once and reused for every frame */
+    std::vector<Vec3D> pointCloud(size_t(reconstructor.width()) * reconstructor.height());
+    const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    /* Retrieve 10 buffers */
+    for (int i = 0; i < 10; i++) {
+        auto* buffer = arv_stream_pop_buffer(stream.get());
+        if (!ARV_IS_BUFFER (buffer)) {
+            std::cerr << "Error: Buffer " << i << " is not a buffer instance!" << std::endl;
+            continue;
+        }
+
+        if (arv_buffer_get_status(buffer) == ARV_BUFFER_STATUS_SUCCESS
+            && reconstructor.reconstruct(buffer, pointCloud.data(), threads)) {
+            const auto& center = pointCloud[pointCloud.size() / 2 + reconstructor.width() / 2];
+            std::cout << "Frame " << i << " center point: [" << center.x << ", " << center.y << ", " << center.z
+                      << "]" << std::endl;
+        }
+
+        arv_stream_push_buffer (stream.get(), buffer);
+    }
+
+    /* Stop the acquisition */
+    arv_camera_stop_acquisition(camera.get(), &error);
+    if(error) {
+        std::cerr << "Error: " << error->message << std::endl;
+        return 1;
+    }
+    std::cout << "Acquisition stopped..." << std::endl;
+
+    return 0;
+}
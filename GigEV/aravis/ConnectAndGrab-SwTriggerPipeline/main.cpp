@@ -0,0 +1,175 @@
+/* SPDX-License-Identifier:Unlicense */
+
+#include "common/PhoAravisCommon.h"
+#include "common/DeviceConfig.h"
+#include "common/TriggerPipeline.h"
+
+#include <string>
+
+using namespace pho;
+
+using Clock = std::chrono::steady_clock;
+
+/* Stands in for the application processing: touches every byte of the range part */
+class Processing {
+public:
+    void operator()(ArvBuffer* buffer) {
+        if (arv_buffer_get_status(buffer) != ARV_BUFFER_STATUS_SUCCESS || !_views.map(buffer)) {
+            return;
+        }
+        const PartView& range = _views.range();
+        const auto* data = range.as<uint8_t>();
+        for (size_t i = 0; i < range.size; ++i) {
+            _checksum += data[i];
+        }
+    }
+
+    bool configure(ArvCamera* camera) { return _views.configure(camera); }
+    uint64_t checksum() const { return _checksum; }
+
+private:
+    MultipartViews _views;
+    uint64_t _checksum = 0;
+};
+
+void printResult(const std::string& name, size_t frames, double seconds, const LatencyHistogram& latency) {
+    std::cout << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(8) << frames / seconds << " fps | trigger to frame p50 " << std::setw(8)
+              << latency.percentile(50) / 1000.0 << " ms, p95 " << std::setw(8) << latency.percentile(95) / 1000.0
+              << " ms" << std::endl;
+}
+
+/* The baseline of ConnectAndGrab-SWTrigger: trigger, wait for the frame, process it, trigger again */
+bool lockStep(ArvCamera* camera, int frames, Processing& processing) {
+    GError* error = nullptr;
+    auto stream = create_gobject_unique(arv_camera_create_stream(camera, nullptr, nullptr, &error));
+    if (error || !ARV_IS_STREAM(stream.get())) {
+        std::cerr << "Error: Failed to create stream!" << std::endl;
+        g_clear_error(&error);
+        return false;
+    }
+    const size_t payload = arv_camera_get_payload(camera, &error);
+    if (error) {
+        std::cerr << "Error: Failed to obtain payload size!" << std::endl;
+        g_clear_error(&error);
+        return false;
+    }
+    arv_stream_push_buffer(stream.get(), arv_buffer_new(payload, nullptr));
+
+    arv_camera_start_acquisition(camera, &error);
+    if (error) {
+        std::cerr << "Error: Failed to start acquisition!" << std::endl;
+        g_clear_error(&error);
+        return false;
+    }
+
+    LatencyHistogram latency;
+    const auto start = Clock::now();
+    for (int i = 0; i < frames; ++i) {
+        const gint64 triggered = g_get_real_time();
+        triggerFrame(camera);
+        auto* buffer = arv_stream_timeout_pop_buffer(stream.get(), 2000000);
+        if (!ARV_IS_BUFFER(buffer)) {
+            std::cerr << "Error: No buffer received!" << std::endl;
+            break;
+        }
+        latency.record(triggerToBufferUs(triggered, buffer));
+        processing(buffer);
+        arv_stream_push_buffer(stream.get(), buffer);
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    arv_camera_stop_acquisition(camera, nullptr);
+    printResult("Lock-step", size_t(frames), seconds, latency);
+    return true;
+}
+
+bool pipelined(ArvCamera* camera, unsigned depth, int frames, Processing& processing) {
+    TriggerPipeline pipeline(camera, depth);
+    if (!pipeline.start()) {
+        return false;
+    }
+
+    const auto start = Clock::now();
+    for (int i = 0; i < frames; ++i) {
+        ArvBuffer* buffer = pipeline.pop();
+        if (!buffer) {
+            continue;
+        }
+        processing(buffer);
+        pipeline.release(buffer);
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    pipeline.stop();
+
+    const auto& statistics = pipeline.statistics();
+    printResult("Pipelined, depth " + std::to_string(depth), statistics.completed, seconds, pipeline.latency());
+    if (statistics.failed || statistics.lost) {
+        std::cout << "  " << statistics.failed << " failed, " << statistics.lost << " lost ("
+                  << statistics.timeouts << " timeouts)" << std::endl;
+    }
+    return true;
+}
+
+/*
+ * Compares lock-step software triggering with a pipeline keeping up to `depth` triggers outstanding.
+ *
+ * Usage: ConnectAndGrab-SWTriggerPipeline <device IP> [max depth [frames]]
+ */
+int main (int argc, char **argv)
+{
+    if(argc < 2) {
+        std::cerr << "Provide device IP as a parameter!" << std::endl;
+        return 1;
+    }
+
+    const char* deviceIp = argv[1];
+    const unsigned maxDepth = argc >= 3 ? unsigned(std::max(1, std::stoi(argv[2]))) : 3;
+    const int frames = argc >= 4 ? std::max(1, std::stoi(argv[3])) : 50;
+
+    GError *error = nullptr;
+
+    /* Connect to the first available camera */
+    auto camera = create_gobject_unique(arv_camera_new (deviceIp, &error));
+    if(error) {
+        std::cerr << "Error: " << error->message << std::endl;
+        return 1;
+    }
+
+    if(!ARV_IS_CAMERA(camera.get())) {
+        std::cerr << "Error: Not a camera instance!";
+        return 1;
+    }
+
+    std::cerr << "Connected to camera: " << arv_camera_get_model_name (camera.get(), nullptr) << std::endl;
+
+    arv_camera_gv_set_packet_size_adjustment (camera.get(), ARV_GV_PACKET_SIZE_ADJUSTMENT_ALWAYS);
+
+    DeviceConfig config;
+    config.triggerMode = TriggerMode::SWTrigger;
+    config.components = {{Intensity, true}, {Range, true}, {Normal, false}, {Confidence, false}, {Event, false},
+                         {ColorCameraImage, false}, {CoordinateMapA, false}, {CoordinateMapB, false}};
+    config.outputFormat = StreamOutputFormat::MultipartData;
+    if(!DeviceConfigurator(camera.get()).apply(config)) {
+        std::cerr << "Error: Failed to configure the device!" << std::endl;
+        return 1;
+    }
+
+    Processing processing;
+    if(!processing.configure(camera.get())) {
+        std::cerr << "Error: Failed to read enabled components!" << std::endl;
+        return 1;
+    }
+
+    if(!lockStep(camera.get(), frames, processing)) {
+        return 1;
+    }
+    for (unsigned depth = 1; depth <= maxDepth; ++depth) {
+        if(!pipelined(camera.get(), depth, frames, processing)) {
+            return 1;
+        }
+    }
+
+    std::cout << "Checksum: " << processing.checksum() << std::endl;
+    return 0;
+}
@@ -1,7 +1,11 @@
 /* SPDX-License-Identifier:Unlicense */
 
 #include "common/PhoAravisCommon.h"
+#include "common/BufferArena.h"
 #include "common/CalculateNormals.h"
+#include "common/DeviceConfig.h"
+#include "common/FrameTracker.h"
+#include "common/StreamStatistics.h"
 #include <iomanip>
 
 using namespace pho;
@@ -12,17 +16,29 @@ void handleImageBuffer(ArvBuffer *buffer) {
     std::cout << "Height: " << arv_buffer_get_image_height(buffer) << std::endl;
 }
 
-void handleMultipartBuffer(ArvBuffer *buffer) {
-    auto nparts = arv_buffer_get_n_parts(buffer);
+void printPartView(const char* name, const PartView& view) {
+    if (!view) {
+        return;
+    }
+    std::cout << name << ": " << view.width << "x" << view.height << " stride: " << view.stride
+              << " size: " << view.size << " pixel format: 0x" << std::hex << view.pixelFormat << std::dec << std::endl;
+}
+
+void handleMultipartBuffer(ArvBuffer *buffer, MultipartViews& views) {
     std::cout << "MULTIPART buffer:" << std::endl;
 
-    for(uint32_t i = 0; i < nparts; ++i) {
-        size_t dataSize = 0;
-        auto data = arv_buffer_get_part_data(buffer, i, &dataSize);
-        auto dataType = arv_buffer_get_part_data_type(buffer, i);
-        std::cout << "Part " << i << " size: " << dataSize << " type: " << dataType << std::endl;
+    /* Views point directly into the buffer, they are valid until the buffer is pushed back to the stream */
+    if (!views.map(buffer)) {
+        std::cerr << "Error: Failed to map multipart buffer!" << std::endl;
+        return;
     }
 
+    printPartView("Intensity", views.intensity());
+    printPartView("Range", views.range());
+    printPartView("Normal", views.normal());
+    printPartView("Confidence", views.confidence());
+    printPartView("Event", views.event());
+
     std::cout << "-------------------------------" << std::endl;
 }
 
@@ -56,10 +72,8 @@ int main (int argc, char **argv)
 
     ///-----------------------------------------------------------------------------------------------------------------
 
-    /* Set trigger mode */
-    if(!setTriggerMode(camera.get(), TriggerMode::Freerun)) {
-        return 1;
-    }
+    /* Memory of the stream buffers, declared before the stream so it outlives it */
+    BufferArena arena;
 
     /* Create the stream object */
     auto stream = create_gobject_unique(arv_camera_create_stream (camera.get(), nullptr, nullptr, &error));
@@ -75,73 +89,52 @@ int main (int argc, char **argv)
 
     arv_camera_gv_set_packet_size_adjustment (camera.get(), ARV_GV_PACKET_SIZE_ADJUSTMENT_ALWAYS);
 
-    /* Enable required output matrices BEFORE getting payload size for buffers */
-    const std::pair<OutputMat, bool> outputMats[] = {
+    /*
+     * Describe the required device state, the configurator reads the current values once and writes only
+     * the features which differ. Apply it BEFORE getting payload size for buffers.
+     */
+    DeviceConfig config;
+    config.triggerMode = TriggerMode::Freerun;
+    config.components = {
         {Intensity, true},
+        /*
+         * Range:
+         * CalibratedABC_Grid -> direct XYZ point cloud, more data, no post-processing
+         * ProjectedC -> only projected Z value, less data, requires post-processing with CoordinateMapA and B
+         */
         {Range, true},
-        {Normal, true},
+        /* Normal pixel format:
+         * Coord3D_ABC32f - vectors, more data, no post-processing needed
+         * Coord3D_AC8 - angles of normal vector, less data, required post-processing, see header file
+         *               `CalculateNormals.h`
+         */
+        {Normal, true, "Coord3D_ABC32f"},
         {Confidence, false},
         {Event, false},
         {ColorCameraImage, false},
         {CoordinateMapA, false},
         {CoordinateMapB, false},
     };
-
-    for(const auto& output : outputMats) {
-        if(!setOutputMat(camera.get(), output.first, output.second)) {
-            return 1;
-        }
-
-        if(output.first == Normal && output.second) {
-            /* If Normal is enabled, check custom setting NormalsEstimationRadius and if value is 0 set to 1 (range: 1-4) */
-            auto radius = arv_camera_get_integer(camera.get(), "NormalsEstimationRadius", &error);
-            if(error) {
-                std::cerr << "Error: Failed to get NormalsEstimationRadius!" << std::endl;
-                return 1;
-            }
-            if(radius == 0) {
-                arv_camera_set_integer(camera.get(), "NormalsEstimationRadius", 1, &error);
-                if(error) {
-                    std::cerr << "Error: Failed to set NormalsEstimationRadius!" << std::endl;
-                    return 1;
-                }
-            }
-
-            /* Set normals pixel format to:
-             * Coord3D_ABC32f - vectors, more data, no post-processing needed
-             * Coord3D_AC8 - angles of normal vector, less data, required post-processing, see header file
-             *               `CalculateNormals.h`
-             */
-            arv_camera_set_string(camera.get(), "ComponentSelector", "Normal", &error);
-            if(error) {
-                std::cerr << "Error: Failed to select ComponentSelector='Normal'!";
-                return 1;
-            }
-            arv_camera_set_string(camera.get(), "PixelFormat", "Coord3D_ABC32f", &error);
-            if(error) {
-                std::cerr << "Error: Failed to set PixelFormat='Coord3D_ABC32f'!";
-                return 1;
-            }
-        }
-        /* If Range is enabled set required format */
-        else if(output.first == Range && output.second) {
-            /*
-             * CalibratedABC_Grid -> direct XYZ point cloud, more data, no post-processing
-             * ProjectedC -> only projected Z value, less data, requires post-processing with CoordinateMapA and B
-             */
-            arv_camera_set_string(camera.get(), "Scan3dOutputMode", "CalibratedABC_Grid", &error);
-            if(error) {
-                std::cerr << "Error: Failed to set Scan3dOutputMode!" << std::endl;
-                return 1;
-            }
-        }
-    }
-
-    /* Set output format BEFORE getting payload size for buffers */
+    config.scan3dOutputMode = "CalibratedABC_Grid";
+    /* Custom setting used when Normal is enabled, range: 1-4. 0 is not valid with normals and is raised to 1, a
+     * configured radius is kept. */
+    config.minNormalsEstimationRadius = 1;
     /* ImageData: Only Texture is sent.
      * MultipartData: Multipart buffer with selected components is sent
      */
-    if(!setStreamOutputFormat(camera.get(), StreamOutputFormat::MultipartData)) {
+    config.outputFormat = StreamOutputFormat::MultipartData;
+
+    ApplyReport report;
+    if(!DeviceConfigurator(camera.get()).apply(config, &report)) {
+        std::cerr << "Error: Failed to configure the device!" << std::endl;
+        return 1;
+    }
+    report.print(std::cout);
+
+    /* Resolve component IDs of the enabled components once, they are used to index the parts of every buffer */
+    MultipartViews views;
+    if(!views.configure(camera.get())) {
+        std::cerr << "Error: Failed to read enabled components!" << std::endl;
         return 1;
     }
 
@@ -153,10 +146,17 @@ int main (int argc, char **argv)
     }
     std::cout << "Payload size: " << payload << " bytes" << std::endl;
 
-    /* Insert some buffers in the stream buffer pool */
-    for (int i = 0; i < 10; i++) {
-        arv_stream_push_buffer(stream.get(), arv_buffer_new(payload, nullptr));
+    /*
+     * Insert some buffers in the stream buffer pool. They share one pre-faulted, 64 byte aligned arena (huge pages
+     * when available) instead of one heap allocation per buffer. The count is fixed, see the AdaptiveBufferPool
+     * example for sizing the pool from the observed frame rate, processing time and underruns.
+     */
+    if(!arena.allocate(payload, 10)) {
+        return 1;
     }
+    arena.pushBuffers(stream.get());
+    std::cout << "Buffer arena: " << arena.bytes() << " bytes, " << BufferArena::backingName(arena.backing())
+              << std::endl;
 
     /* Start the acquisition */
     arv_camera_start_acquisition(camera.get(), &error);
@@ -166,11 +166,27 @@ int main (int argc, char **argv)
     }
     std::cout << "Acquisition started..." << std::endl;
 
+    /* Transport counters, buffer status and per-frame latencies */
+    StreamStatistics statistics;
+    /* Skipped frame IDs, failed buffers, late frames and stalls */
+    FrameTracker tracker;
+
     /* Retrieve 10 buffers */
     for (int i = 0; i < 10; i++) {
         auto* buffer = arv_stream_pop_buffer(stream.get());
         if (!ARV_IS_BUFFER (buffer)) {
             std::cerr << "Error: Buffer " << i << " is not a buffer instance!" << std::endl;
+            tracker.onNoBuffer();
+            continue;
+        }
+        statistics.onDequeued(buffer);
+        tracker.onBuffer(buffer);
+
+        if (arv_buffer_get_status(buffer) != ARV_BUFFER_STATUS_SUCCESS) {
+            std::cerr << "Buffer " << i << " (frame " << arv_buffer_get_frame_id(buffer) << ") incomplete: "
+                      << bufferStatusName(arv_buffer_get_status(buffer)) << std::endl;
+            statistics.onReleased(buffer);
+            arv_stream_push_buffer (stream.get(), buffer);
             continue;
         }
 
@@ -180,7 +196,7 @@ int main (int argc, char **argv)
             handleImageBuffer(buffer);
             break;
         case ARV_BUFFER_PAYLOAD_TYPE_MULTIPART:
-            handleMultipartBuffer(buffer);
+            handleMultipartBuffer(buffer, views);
             break;
         default:
             std::cerr << "Unsupported buffer type: 0x" << std::hex << std::setfill('0') << std::setw(4) << payloadType
@@ -188,9 +204,13 @@ int main (int argc, char **argv)
             break;
         }
 
+        statistics.onReleased(buffer);
         arv_stream_push_buffer (stream.get(), buffer);
     }
 
+    statistics.print(std::cout, stream.get());
+    tracker.print(std::cout);
+
     /* Stop the acquisition */
     arv_camera_stop_acquisition(camera.get(), &error);
     if(error) {
@@ -0,0 +1,64 @@
+/* SPDX-License-Identifier:Unlicense */
+
+#include "common/PhoAravisCommon.h"
+
+#include <string>
+
+using namespace pho;
+
+double median(std::vector<double> values) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+    return values[values.size() / 2];
+}
+
+/*
+ * Measures the connect latency: device lookup, GenICam XML download and parsing, all inside arv_camera_new().
+ * aravis 0.8 downloads the XML on every connect, so all connects pay the same. With an export directory, the XML of
+ * the device is additionally written there once (see exportGenicamXml()), timed separately.
+ *
+ * Usage: ConnectLatency <device IP> [connects] [export directory]
+ */
+int main (int argc, char **argv)
+{
+    if(argc < 2) {
+        std::cerr << "Provide device IP as a parameter!" << std::endl;
+        return 1;
+    }
+
+    const char* deviceIp = argv[1];
+    const int connects = argc >= 3 ? std::max(1, std::stoi(argv[2])) : 5;
+
+    std::vector<double> connectMs;
+    size_t xmlSize = 0;
+    for (int i = 0; i < connects; ++i) {
+        GError* error = nullptr;
+        ConnectReport report;
+        auto camera = create_gobject_unique(connectCamera(deviceIp, &error, &report));
+        if(error || !ARV_IS_CAMERA(camera.get())) {
+            std::cerr << "Error: " << (error ? error->message : "Not a camera instance!") << std::endl;
+            g_clear_error(&error);
+            return 1;
+        }
+        connectMs.push_back(report.connectMs);
+        xmlSize = report.xmlSize;
+
+        if (argc >= 4 && i == 0) {
+            std::string file;
+            const auto start = std::chrono::steady_clock::now();
+            if (!exportGenicamXml(camera.get(), argv[3], &file)) {
+                return 1;
+            }
+            std::cout << "GenICam XML exported to " << file << " in "
+                      << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+                      << " ms" << std::endl;
+        }
+    }
+
+    std::cout << "Connect (" << connects << "x, GenICam XML " << xmlSize << " bytes): median " << median(connectMs)
+              << " ms, min " << *std::min_element(connectMs.begin(), connectMs.end()) << " ms, max "
+              << *std::max_element(connectMs.begin(), connectMs.end()) << " ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,437 @@
+/* SPDX-License-Identifier:Unlicense */
+
+#include "common/PhoAravisCommon.h"
+#include "common/BufferArena.h"
+#include "common/CalculateNormals.h"
+#include "common/CompactPoints.h"
+#include "common/FrameTracker.h"
+#include "common/StreamStatistics.h"
+
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+
+#if defined(__linux__)
+#include <unistd.h>
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+using namespace pho;
+
+/*
+ * End-to-end GigE Vision throughput without a device: aravis' fake GigE camera runs in this process and streams
+ * over loopback, received by the same pop -> map -> process -> push loop as ConnectAndGrab (BufferArena,
+ * StreamStatistics, FrameTracker). Reports sustained frames/s, CPU time per frame and dropped frames.
+ *
+ * The payload has the size and content of a Photoneo multipart frame with Intensity (Mono12), Range
+ * (Coord3D_ABC32f), Normal (Coord3D_AC8) and Confidence8, 17 bytes per pixel. aravis' fake camera only streams
+ * single-part images, so the four parts are sent back to back as one Mono8 image of width x 17 * height and
+ * carved into MultipartViews on the host, the GVSP traffic (bytes, packets) matches the multipart stream. Every
+ * frame is processed like a real one: the normals are decoded and the valid points compacted.
+ *
+ * On Linux the CPU time is split per thread (/proc/self/task): the grab loop, the aravis receive threads and the
+ * fake camera, which is not part of the cost per frame. Elsewhere only the process CPU time, including the fake
+ * camera, is reported.
+ *
+ * Usage: FakeCameraBenchmark [width height [fps [seconds [packet size]]]]
+ */
+
+struct Settings {
+    uint32_t width = 1032;
+    uint32_t height = 772;
+    double frameRate = 10.0;
+    int seconds = 10;
+    guint packetSize = 8192;  // loopback has no MTU limit worth mentioning, jumbo frames as on a tuned link
+};
+
+/* Photoneo part layout inside the fake image, all parts unpadded */
+const ArvPixelFormat mono12 = 0x01100005, coord3dAbc32f = 0x026000C0, coord3dAc8 = 0x021000B4,
+                     confidence8 = 0x010800C6;
+const size_t bytesPerPixel = sizeof(uint16_t) + sizeof(Vec3D) + sizeof(NormalsAngles) + sizeof(uint8_t);
+
+struct SyntheticFrame {
+    std::vector<uint8_t> data;    // the four parts back to back
+    size_t validPixels = 0;
+};
+
+/* A tilted plane with a box on it, every fifth run of 37 pixels is invalid (zero range, zero confidence) */
+SyntheticFrame createFrame(uint32_t width, uint32_t height) {
+    const size_t pixels = size_t(width) * height;
+    std::vector<uint16_t> intensity(pixels);
+    std::vector<Vec3D> range(pixels);
+    std::vector<Vec3D> normals(pixels);
+    std::vector<uint8_t> confidence(pixels);
+
+    SyntheticFrame frame;
+    const Vec3D planeNormal = {0.0f, -0.2f / std::sqrt(1.04f), 1.0f / std::sqrt(1.04f)};
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            const size_t i = size_t(y) * width + x;
+            const bool box = x > width / 3 && x < 2 * width / 3 && y > height / 3 && y < 2 * height / 3;
+            const bool valid = (i / 37) % 5 != 0;
+            intensity[i] = static_cast<uint16_t>((x * 7 + y * 3) & 0x0FFF);
+            normals[i] = box ? Vec3D{0.0f, 0.0f, 1.0f} : planeNormal;
+            if (valid) {
+                const float z = box ? 700.0f : 900.0f + 0.2f * float(y);
+                range[i] = {(float(x) - width / 2.0f) * z / 1000.0f, (float(y) - height / 2.0f) * z / 1000.0f, z};
+                confidence[i] = 255;
+                ++frame.validPixels;
+            } else {
+                range[i] = {0.0f, 0.0f, 0.0f};
+                confidence[i] = 0;
+            }
+        }
+    }
+
+    frame.data.resize(pixels * bytesPerPixel);
+    uint8_t* out = frame.data.data();
+    std::memcpy(out, intensity.data(), pixels * sizeof(uint16_t));
+    out += pixels * sizeof(uint16_t);
+    std::memcpy(out, range.data(), pixels * sizeof(Vec3D));
+    out += pixels * sizeof(Vec3D);
+    encodeNormals(normals.data(), width, height, reinterpret_cast<NormalsAngles*>(out));
+    out += pixels * sizeof(NormalsAngles);
+    std::memcpy(out, confidence.data(), pixels);
+    return frame;
+}
+
+/* Fill pattern of the fake camera, runs on its thread: the synthetic frame instead of the diagonal ramp */
+void fillFrame(ArvBuffer* buffer, void* frameData, guint32, guint32, ArvPixelFormat) {
+    const auto* frame = static_cast<const SyntheticFrame*>(frameData);
+    size_t size = 0;
+    auto* data = static_cast<uint8_t*>(const_cast<void*>(arv_buffer_get_data(buffer, &size)));
+    std::memcpy(data, frame->data.data(), std::min(size, frame->data.size()));
+}
+
+/* Views of the four parts in a received frame, the same views MultipartViews::map() gives for a device frame */
+bool mapParts(ArvBuffer* buffer, uint32_t width, uint32_t height, MultipartViews& views) {
+    size_t size = 0;
+    const auto* data = static_cast<const uint8_t*>(arv_buffer_get_data(buffer, &size));
+    const size_t pixels = size_t(width) * height;
+    if (!data || size < pixels * bytesPerPixel) {
+        return false;
+    }
+
+    const auto part = [&](size_t elementSize, ArvPixelFormat pixelFormat) {
+        PartView view;
+        view.data = data;
+        view.size = pixels * elementSize;
+        view.width = width;
+        view.height = height;
+        view.stride = width * elementSize;
+        view.pixelFormat = pixelFormat;
+        data += view.size;
+        return view;
+    };
+    views.setView(1, part(sizeof(uint16_t), mono12));
+    views.setView(2, part(sizeof(Vec3D), coord3dAbc32f));
+    views.setView(4, part(sizeof(NormalsAngles), coord3dAc8));
+    views.setView(3, part(sizeof(uint8_t), confidence8));
+    return true;
+}
+
+/* CPU seconds consumed so far, per thread id where the platform tells, else one entry for the process */
+std::map<long, double> cpuTimes() {
+    std::map<long, double> times;
+#if defined(__linux__)
+    const double tick = 1.0 / double(sysconf(_SC_CLK_TCK));
+    GDir* dir = g_dir_open("/proc/self/task", 0, nullptr);
+    if (!dir) {
+        return times;
+    }
+    while (const gchar* name = g_dir_read_name(dir)) {
+        std::ifstream file(std::string("/proc/self/task/") + name + "/stat");
+        std::string stat;
+        std::getline(file, stat);
+        const size_t comm = stat.rfind(')');
+        if (comm == std::string::npos) {
+            continue;
+        }
+        /* After the command name: state, 10 fields, utime, stime */
+        std::istringstream fields(stat.substr(comm + 2));
+        std::string skipped;
+        for (int i = 0; i < 11; ++i) {
+            fields >> skipped;
+        }
+        unsigned long long utime = 0, stime = 0;
+        if (fields >> utime >> stime) {
+            times[std::atol(name)] = double(utime + stime) * tick;
+        }
+    }
+    g_dir_close(dir);
+#elif defined(_WIN32)
+    FILETIME creation, exitTime, kernel, user;
+    if (GetProcessTimes(GetCurrentProcess(), &creation, &exitTime, &kernel, &user)) {
+        const auto seconds = [](const FILETIME& time) {
+            return double((uint64_t(time.dwHighDateTime) << 32) | time.dwLowDateTime) * 1e-7;
+        };
+        times[0] = seconds(kernel) + seconds(user);
+    }
+#else
+    times[0] = double(std::clock()) / CLOCKS_PER_SEC;
+#endif
+    return times;
+}
+
+/* Id of the calling thread in cpuTimes() */
+long currentThreadId() {
+#if defined(__linux__)
+    return long(getpid()); /* main() runs on the initial thread, its id is the process id */
+#else
+    return 0;
+#endif
+}
+
+std::set<long> threadIds() {
+    std::set<long> ids;
+    for (const auto& entry : cpuTimes()) {
+        ids.insert(entry.first);
+    }
+    return ids;
+}
+
+int main (int argc, char **argv)
+{
+    Settings settings;
+    if(argc >= 3) {
+        settings.width = uint32_t(std::max(16, std::stoi(argv[1])));
+        settings.height = uint32_t(std::max(16, std::stoi(argv[2])));
+    }
+    if(argc >= 4) {
+        settings.frameRate = std::max(0.1, std::stod(argv[3]));
+    }
+    if(argc >= 5) {
+        settings.seconds = std::max(1, std::stoi(argv[4]));
+    }
+    if(argc >= 6) {
+        settings.packetSize = guint(std::max(576, std::stoi(argv[5])));
+    }
+
+    const uint32_t imageHeight = settings.height * uint32_t(bytesPerPixel);
+    const SyntheticFrame frame = createFrame(settings.width, settings.height);
+    std::cout << "Frame: " << settings.width << "x" << settings.height << ", " << frame.data.size()
+              << " bytes (Mono12 + ABC32f + AC8 + Confidence8), sent as a " << settings.width << "x" << imageHeight
+              << " Mono8 image" << std::endl;
+
+    ///-----------------------------------------------------------------------------------------------------------------
+
+    /* The threads started by the fake camera are told apart from the receiving side by their ids */
+    const std::set<long> threadsBefore = threadIds();
+
+    auto fakeCamera = create_gobject_unique(arv_gv_fake_camera_new("127.0.0.1", "PHO-BENCH"));
+    if(!fakeCamera || !arv_gv_fake_camera_is_running(fakeCamera.get())) {
+        std::cerr << "Error: Failed to start the fake GigE camera on 127.0.0.1!" << std::endl;
+        return 1;
+    }
+
+    /* Large enough a sensor for the whole frame, and the frame as its image */
+    ArvFakeCamera* sensor = arv_gv_fake_camera_get_fake_camera(fakeCamera.get());
+    arv_fake_camera_write_register(sensor, ARV_FAKE_CAMERA_REGISTER_SENSOR_WIDTH, settings.width);
+    arv_fake_camera_write_register(sensor, ARV_FAKE_CAMERA_REGISTER_SENSOR_HEIGHT, imageHeight);
+    arv_fake_camera_set_fill_pattern(sensor, fillFrame, const_cast<SyntheticFrame*>(&frame));
+
+    std::set<long> cameraThreads;
+    for (long id : threadIds()) {
+        if (!threadsBefore.count(id)) {
+            cameraThreads.insert(id);
+        }
+    }
+
+    GError *error = nullptr;
+
+    auto camera = create_gobject_unique(arv_camera_new ("127.0.0.1", &error));
+    if(error) {
+        std::cerr << "Error: " << error->message << std::endl;
+        return 1;
+    }
+
+    if(!ARV_IS_CAMERA(camera.get())) {
+        std::cerr << "Error: Not a camera instance!";
+        return 1;
+    }
+
+    std::cerr << "Connected to camera: " << arv_camera_get_model_name (camera.get(), nullptr) << std::endl;
+
+    double minRate = 0.0, maxRate = 0.0;
+    arv_camera_set_acquisition_mode(camera.get(), ARV_ACQUISITION_MODE_CONTINUOUS, &error);
+    if(!error) {
+        arv_camera_set_pixel_format(camera.get(), ARV_PIXEL_FORMAT_MONO_8, &error);
+    }
+    if(!error) {
+        arv_camera_set_region(camera.get(), 0, 0, gint(settings.width), gint(imageHeight), &error);
+    }
+    if(!error) {
+        arv_camera_get_frame_rate_bounds(camera.get(), &minRate, &maxRate, &error);
+    }
+    if(!error) {
+        arv_camera_set_frame_rate(camera.get(), std::min(std::max(settings.frameRate, minRate), maxRate), &error);
+    }
+    if(!error) {
+        arv_camera_gv_set_packet_size(camera.get(), gint(settings.packetSize), &error);
+    }
+    if(error) {
+        std::cerr << "Error: Failed to configure the fake camera: " << error->message << std::endl;
+        return 1;
+    }
+
+    const double frameRate = arv_camera_get_frame_rate(camera.get(), nullptr);
+    if(std::abs(frameRate - settings.frameRate) > 0.01 * settings.frameRate) {
+        std::cerr << "Warning: The fake camera runs at " << frameRate << " fps instead of " << settings.frameRate
+                  << std::endl;
+    }
+
+    size_t payload = arv_camera_get_payload (camera.get(), &error);
+    if(error || payload < frame.data.size()) {
+        std::cerr << "Error: Unexpected payload size " << payload << ", the fake camera did not accept a "
+                  << settings.width << "x" << imageHeight << " region!" << std::endl;
+        return 1;
+    }
+
+    /* Memory of the stream buffers, declared before the stream so it outlives it */
+    BufferArena arena;
+
+    const std::set<long> threadsBeforeStream = threadIds();
+    auto stream = create_gobject_unique(arv_camera_create_stream (camera.get(), nullptr, nullptr, &error));
+    if(error || !ARV_IS_STREAM(stream.get())) {
+        std::cerr << "Error: Failed to create stream!" << std::endl;
+        return 1;
+    }
+
+    if(!arena.allocate(payload, 10)) {
+        return 1;
+    }
+    arena.pushBuffers(stream.get());
+
+    /* The receiving threads: everything started with the stream */
+    std::set<long> receiveThreads;
+    for (long id : threadIds()) {
+        if (!threadsBeforeStream.count(id) && !cameraThreads.count(id)) {
+            receiveThreads.insert(id);
+        }
+    }
+
+    MultipartViews views;
+    views.configure({{Intensity, 1}, {Range, 2}, {Confidence, 3}, {Normal, 4}});
+    std::vector<Vec3D> normals(size_t(settings.width) * settings.height);
+    CompactedPoints points;
+
+    arv_camera_start_acquisition(camera.get(), &error);
+    if(error) {
+        std::cerr << "Error: Failed to start acquisition!" << std::endl;
+        return 1;
+    }
+    std::cout << "Acquisition started: " << frameRate << " fps requested, " << settings.packetSize
+              << " byte packets, " << settings.seconds << " s after 1 s of warm-up..." << std::endl;
+
+    StreamStatistics statistics;
+    FrameTracker tracker;
+
+    TransportCounters startCounters;
+    std::map<long, double> startCpu;
+    uint64_t frames = 0;
+    uint64_t corrupted = 0;
+
+    const auto warmUpEnd = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    const auto end = warmUpEnd + std::chrono::seconds(settings.seconds);
+    auto start = warmUpEnd;
+    bool measuring = false;
+    for (auto now = std::chrono::steady_clock::now(); now < end; now = std::chrono::steady_clock::now()) {
+        if (!measuring && now >= warmUpEnd) {
+            measuring = true;
+            start = now;
+            statistics.clear();
+            tracker.clear();
+            startCounters = StreamStatistics::transport(stream.get());
+            startCpu = cpuTimes();
+            frames = corrupted = 0;
+        }
+
+        auto* buffer = arv_stream_timeout_pop_buffer(stream.get(), 1000000);
+        if (!ARV_IS_BUFFER (buffer)) {
+            tracker.onNoBuffer();
+            continue;
+        }
+        statistics.onDequeued(buffer);
+        tracker.onBuffer(buffer);
+
+        if (arv_buffer_get_status(buffer) == ARV_BUFFER_STATUS_SUCCESS) {
+            /* Decode and process as a real frame: normals to vectors, valid points compacted by confidence */
+            bool processed = mapParts(buffer, settings.width, settings.height, views);
+            if (processed) {
+                const PartView& normal = views.normal();
+                calculateNormals(normal.as<NormalsAngles>(), normal.width, normal.height, normals.data());
+                processed = compactPoints(views, points, CompactionMask::Confidence);
+            }
+            /* Every frame carries the same content, a different point count means damaged data */
+            if (!processed || points.size() != frame.validPixels) {
+                ++corrupted;
+            }
+            ++frames;
+        }
+
+        statistics.onReleased(buffer);
+        arv_stream_push_buffer (stream.get(), buffer);
+    }
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const std::map<long, double> endCpu = cpuTimes();
+    const TransportCounters endCounters = StreamStatistics::transport(stream.get());
+
+    arv_camera_stop_acquisition(camera.get(), nullptr);
+    std::cout << "Acquisition stopped..." << std::endl;
+
+    statistics.print(std::cout, stream.get());
+    tracker.print(std::cout);
+
+    /* CPU seconds of the measured period, threads created meanwhile count from zero */
+    double loopCpu = 0.0, receiveCpu = 0.0, cameraCpu = 0.0, otherCpu = 0.0;
+    for (const auto& entry : endCpu) {
+        const auto begin = startCpu.find(entry.first);
+        const double cpu = entry.second - (begin != startCpu.end() ? begin->second : 0.0);
+        if (cameraThreads.count(entry.first)) {
+            cameraCpu += cpu;
+        } else if (receiveThreads.count(entry.first)) {
+            receiveCpu += cpu;
+        } else if (entry.first == currentThreadId()) {
+            loopCpu += cpu;
+        } else {
+            otherCpu += cpu;
+        }
+    }
+
+    const FrameTracker::Counters& counters = tracker.counters();
+    const double perFrame = frames ? 1000.0 / double(frames) : 0.0;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Sustained: " << double(frames) / elapsed << " frames/s of " << frameRate << " requested, "
+              << double(frames) * double(frame.data.size()) / elapsed / 1e9 * 8.0 << " Gbit/s" << std::endl;
+#if defined(__linux__)
+    std::cout << "CPU per frame: " << (loopCpu + receiveCpu + otherCpu) * perFrame << " ms (grab loop "
+              << loopCpu * perFrame << " ms, receive threads " << receiveCpu * perFrame << " ms, other "
+              << otherCpu * perFrame << " ms), fake camera " << cameraCpu * perFrame << " ms not counted"
+              << std::endl;
+#else
+    std::cout << "CPU per frame: " << (loopCpu + receiveCpu + cameraCpu + otherCpu) * perFrame
+              << " ms for the whole process, including the fake camera" << std::endl;
+#endif
+    std::cout << "Drops: " << counters.skipped << " skipped, " << counters.failed << " failed, "
+              << endCounters.underruns - startCounters.underruns << " underruns, "
+              << endCounters.missingPackets - startCounters.missingPackets << " missing packets ("
+              << endCounters.resentPackets - startCounters.resentPackets << " resent), " << corrupted
+              << " corrupted, loss " << counters.lossPercent() << " %" << std::endl;
+    std::cout << std::defaultfloat;
+
+    if (frames == 0) {
+        std::cerr << "Error: No frame received!" << std::endl;
+        return 1;
+    }
+    return 0;
+}
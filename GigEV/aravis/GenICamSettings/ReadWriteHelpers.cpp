@@ -1,5 +1,8 @@
 #include "ReadWriteHelpers.h"
 
+#include <chrono>
+#include <unordered_map>
+
 namespace pho {
 
 bool ReadWriteHelper::testCommandFeature(const std::string& nodeName) {
@@ -283,4 +286,332 @@ std::vector<uint8_t> ReadWriteHelper::getBuffer(const std::string& nodeName) {
     return buffer;
 }
 
-}  // namespace pho
\ No newline at end of file
+std::string FeatureSnapshot::Entry::printable() const {
+    if (!isRegister) {
+        return value;
+    }
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(value.size() * 2);
+    for (unsigned char byte : value) {
+        hex += digits[byte >> 4];
+        hex += digits[byte & 0xF];
+    }
+    return hex;
+}
+
+const FeatureSnapshot::Entry* FeatureSnapshot::find(const std::string& key) const {
+    for (const auto& entry : entries) {
+        if (entry.key() == key) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+/* Register nodes which are not integers, floats or strings hold raw arrays (e.g. camera matrices) */
+static bool isRawRegister(ArvGcFeatureNode* node) {
+    return ARV_IS_GC_REGISTER(node) && !ARV_IS_GC_INTEGER(node) && !ARV_IS_GC_FLOAT(node) && !ARV_IS_GC_STRING(node);
+}
+
+static bool isEnumerationSelector(ArvGcFeatureNode* node) {
+    return ARV_IS_GC_ENUMERATION(node) && ARV_IS_GC_SELECTOR(node) && arv_gc_selector_is_selector(ARV_GC_SELECTOR(node));
+}
+
+void ReadWriteHelper::collectFeatures(ArvGc* genicam, const char* categoryName,
+                                      std::vector<ArvGcFeatureNode*>& features,
+                                      std::unordered_set<ArvGcFeatureNode*>& seen) {
+    ArvGcNode* node = arv_gc_get_node(genicam, categoryName);
+    if (ARV_IS_GC_CATEGORY(node)) {
+        for (const GSList* iter = arv_gc_category_get_features(ARV_GC_CATEGORY(node)); iter; iter = iter->next) {
+            collectFeatures(genicam, static_cast<const char*>(iter->data), features, seen);
+        }
+        return;
+    }
+    if (ARV_IS_GC_FEATURE_NODE(node) && !ARV_IS_GC_COMMAND(node) && seen.insert(ARV_GC_FEATURE_NODE(node)).second) {
+        features.push_back(ARV_GC_FEATURE_NODE(node));
+    }
+}
+
+bool ReadWriteHelper::readEntry(ArvGcFeatureNode* node, FeatureSnapshot::Entry& entry) {
+    GError* error = nullptr;
+    const bool readable = arv_gc_feature_node_is_implemented(node, &error) && !error
+                          && arv_gc_feature_node_is_available(node, &error) && !error
+                          && arv_gc_feature_node_get_actual_access_mode(node) != ARV_GC_ACCESS_MODE_WO;
+    if (!readable) {
+        g_clear_error(&error);
+        return false;
+    }
+
+    entry.feature = arv_gc_feature_node_get_name(node);
+    entry.writable = arv_gc_feature_node_get_actual_access_mode(node) == ARV_GC_ACCESS_MODE_RW;
+    entry.isRegister = isRawRegister(node);
+    if (entry.isRegister) {
+        const guint64 length = arv_gc_register_get_length(ARV_GC_REGISTER(node), &error);
+        if (!error) {
+            entry.value.resize(length);
+            arv_gc_register_get(ARV_GC_REGISTER(node), &entry.value[0], length, &error);
+        }
+    } else {
+        const char* value = arv_gc_feature_node_get_value_as_string(node, &error);
+        entry.value = value && !error ? value : "";
+    }
+
+    if (error) {
+        g_clear_error(&error);
+        return false;
+    }
+    return true;
+}
+
+bool ReadWriteHelper::writeFeature(ArvGc* genicam, const std::string& feature, const std::string& value,
+                                   bool isRegister) {
+    ArvGcNode* node = arv_gc_get_node(genicam, feature.c_str());
+    if (!ARV_IS_GC_FEATURE_NODE(node)) {
+        return false;
+    }
+
+    GError* error = nullptr;
+    if (isRegister) {
+        arv_gc_register_set(ARV_GC_REGISTER(node), value.data(), value.size(), &error);
+    } else {
+        arv_gc_feature_node_set_value_from_string(ARV_GC_FEATURE_NODE(node), value.c_str(), &error);
+    }
+    if (error) {
+        g_clear_error(&error);
+        return false;
+    }
+    return true;
+}
+
+FeatureSnapshot ReadWriteHelper::takeSnapshot() {
+    const auto start = std::chrono::steady_clock::now();
+    FeatureSnapshot snapshot;
+    ArvGc* genicam = getGenicam();
+
+    std::vector<ArvGcFeatureNode*> features;
+    std::unordered_set<ArvGcFeatureNode*> seen;
+    collectFeatures(genicam, "Root", features, seen);
+
+    /* Registers read by several features are read from the device once, writes go through to the device */
+    const ArvRegisterCachePolicy cachePolicy = arv_gc_get_register_cache_policy(genicam);
+    arv_gc_set_register_cache_policy(genicam, ARV_REGISTER_CACHE_POLICY_ENABLE);
+
+    /* Features behind enumeration selectors are read once per selector entry, not at their own tree position */
+    std::unordered_set<ArvGcFeatureNode*> selected;
+    for (auto* node : features) {
+        if (isEnumerationSelector(node)) {
+            for (const GSList* iter = arv_gc_selector_get_selected_features(ARV_GC_SELECTOR(node)); iter; iter = iter->next) {
+                selected.insert(ARV_GC_FEATURE_NODE(iter->data));
+            }
+        }
+    }
+
+    for (auto* node : features) {
+        if (selected.count(node)) {
+            continue;
+        }
+
+        FeatureSnapshot::Entry entry;
+        if (!readEntry(node, entry)) {
+            continue;
+        }
+
+        if (isEnumerationSelector(node)) {
+            GError* error = nullptr;
+            guint count = 0;
+            const char** values = arv_gc_enumeration_dup_available_string_values(ARV_GC_ENUMERATION(node), &count, &error);
+            for (guint i = 0; !error && i < count; ++i) {
+                arv_gc_feature_node_set_value_from_string(node, values[i], &error);
+                if (error) {
+                    g_clear_error(&error);
+                    continue;
+                }
+                for (const GSList* iter = arv_gc_selector_get_selected_features(ARV_GC_SELECTOR(node)); iter; iter = iter->next) {
+                    FeatureSnapshot::Entry selectedEntry;
+                    if (readEntry(ARV_GC_FEATURE_NODE(iter->data), selectedEntry)) {
+                        selectedEntry.selector = entry.feature;
+                        selectedEntry.selectorValue = values[i];
+                        snapshot.entries.push_back(std::move(selectedEntry));
+                    }
+                }
+            }
+            g_clear_error(&error);
+            g_free(values);
+
+            /* Set the selector back, its own entry follows the selected features so it is restored after them */
+            arv_gc_feature_node_set_value_from_string(node, entry.value.c_str(), &error);
+            if (error) {
+                handleError(error);
+                g_clear_error(&error);
+            }
+        }
+
+        snapshot.entries.push_back(std::move(entry));
+    }
+    arv_gc_set_register_cache_policy(genicam, cachePolicy);
+
+    snapshot.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return snapshot;
+}
+
+std::vector<FeatureChange> ReadWriteHelper::diffSnapshots(const FeatureSnapshot& from, const FeatureSnapshot& to) {
+    std::unordered_map<std::string, const FeatureSnapshot::Entry*> before;
+    for (const auto& entry : from.entries) {
+        before.emplace(entry.key(), &entry);
+    }
+
+    std::vector<FeatureChange> changes;
+    for (const auto& entry : to.entries) {
+        const std::string key = entry.key();
+        const auto it = before.find(key);
+        if (it == before.end()) {
+            changes.push_back({key, "", entry.printable()});
+            continue;
+        }
+        if (it->second->value != entry.value) {
+            changes.push_back({key, it->second->printable(), entry.printable()});
+        }
+        before.erase(it);
+    }
+    for (const auto& entry : from.entries) {
+        if (before.count(entry.key())) {
+            changes.push_back({entry.key(), entry.printable(), ""});
+        }
+    }
+    return changes;
+}
+
+bool ReadWriteHelper::restoreSnapshot(const FeatureSnapshot& target, RestoreReport* report,
+                                      const FeatureSnapshot* current) {
+    const auto start = std::chrono::steady_clock::now();
+    RestoreReport localReport;
+    RestoreReport& out = report ? *report : localReport;
+    out = RestoreReport();
+
+    FeatureSnapshot fresh;
+    if (!current) {
+        fresh = takeSnapshot();
+        current = &fresh;
+    }
+    std::unordered_map<std::string, const FeatureSnapshot::Entry*> currentEntries;
+    for (const auto& entry : current->entries) {
+        currentEntries.emplace(entry.key(), &entry);
+    }
+
+    /* Device value of every selector, tracked while the selected features are written */
+    std::unordered_map<std::string, std::string> selectorState;
+    for (const auto& entry : target.entries) {
+        if (!entry.selector.empty() && !selectorState.count(entry.selector)) {
+            const auto it = currentEntries.find(entry.selector);
+            selectorState[entry.selector] = it != currentEntries.end() ? it->second->value : "";
+        }
+    }
+    const auto selectorOf = [&selectorState](const FeatureSnapshot::Entry& entry) {
+        return entry.selector.empty() ? selectorState.find(entry.feature) : selectorState.end();
+    };
+
+    /* Only the entries which differ from the device are written, selectors only when their value changes */
+    std::vector<const FeatureSnapshot::Entry*> pending;
+    for (const auto& entry : target.entries) {
+        if (!entry.writable) {
+            continue;
+        }
+        const auto selector = selectorOf(entry);
+        if (selector != selectorState.end()) {
+            if (selector->second != entry.value) {
+                pending.push_back(&entry);
+            }
+            continue;
+        }
+        const auto it = currentEntries.find(entry.key());
+        if (it == currentEntries.end() || it->second->value != entry.value) {
+            pending.push_back(&entry);
+        }
+    }
+
+    /* Features constrained by others (e.g. bounds depending on a mode) may fail until a later entry is restored */
+    ArvGc* genicam = getGenicam();
+    std::vector<const FeatureSnapshot::Entry*> written;
+    for (int pass = 0; pass < 3 && !pending.empty(); ++pass) {
+        std::vector<const FeatureSnapshot::Entry*> failed;
+        for (const auto* entry : pending) {
+            if (!entry->selector.empty()) {
+                std::string& state = selectorState[entry->selector];
+                if (state != entry->selectorValue) {
+                    ++out.writes;
+                    if (!writeFeature(genicam, entry->selector, entry->selectorValue, false)) {
+                        failed.push_back(entry);
+                        continue;
+                    }
+                    state = entry->selectorValue;
+                }
+            }
+
+            ++out.writes;
+            if (!writeFeature(genicam, entry->feature, entry->value, entry->isRegister)) {
+                failed.push_back(entry);
+                continue;
+            }
+            const auto selector = selectorOf(*entry);
+            if (selector != selectorState.end()) {
+                selector->second = entry->value;
+            } else {
+                written.push_back(entry);
+            }
+        }
+        const bool progress = failed.size() < pending.size();
+        pending.swap(failed);
+        if (!progress) {
+            break;
+        }
+    }
+
+    /* An accepted write may still be changed by a later one (e.g. a mode resetting a bound), read them back */
+    const auto matches = [this, genicam](const FeatureSnapshot::Entry& entry) {
+        ArvGcNode* node = arv_gc_get_node(genicam, entry.feature.c_str());
+        FeatureSnapshot::Entry device;
+        return ARV_IS_GC_FEATURE_NODE(node) && readEntry(ARV_GC_FEATURE_NODE(node), device)
+               && device.value == entry.value;
+    };
+    for (const auto* entry : written) {
+        if (!entry->selector.empty()) {
+            std::string& state = selectorState[entry->selector];
+            if (state != entry->selectorValue) {
+                ++out.writes;
+                if (!writeFeature(genicam, entry->selector, entry->selectorValue, false)) {
+                    out.mismatched.push_back(entry->key());
+                    continue;
+                }
+                state = entry->selectorValue;
+            }
+        }
+        if (!matches(*entry)) {
+            out.mismatched.push_back(entry->key());
+        }
+    }
+
+    /* Retried and read back entries may have moved selectors away from their snapshot value */
+    for (const auto& entry : target.entries) {
+        const auto selector = selectorOf(entry);
+        if (entry.writable && selector != selectorState.end() && selector->second != entry.value) {
+            ++out.writes;
+            if (writeFeature(genicam, entry.feature, entry.value, false)) {
+                selector->second = entry.value;
+            }
+        }
+    }
+    for (const auto& entry : target.entries) {
+        if (entry.writable && selectorOf(entry) != selectorState.end() && !matches(entry)) {
+            out.mismatched.push_back(entry.key());
+        }
+    }
+
+    for (const auto* entry : pending) {
+        out.failed.push_back(entry->key());
+    }
+    out.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return pending.empty() && out.mismatched.empty();
+}
+
+}  // namespace pho
@@ -7,6 +7,7 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 enum AccessType {
@@ -24,10 +25,71 @@ namespace {
 
 namespace pho {
 
+/*
+ * Values of all readable features of a device, see ReadWriteHelper::takeSnapshot().
+ * Features behind a selector (e.g. ComponentEnable behind ComponentSelector) are stored once per selector entry.
+ */
+struct FeatureSnapshot {
+    struct Entry {
+        std::string feature;
+        std::string selector;      // empty if the feature is not selected
+        std::string selectorValue;
+        std::string value;         // value as string, raw bytes for register (array) features
+        bool isRegister = false;
+        bool writable = false;
+
+        /* "Feature" or "Feature[Selector=Value]" */
+        std::string key() const { return selector.empty() ? feature : feature + "[" + selector + "=" + selectorValue + "]"; }
+        /* Value for printing, registers as hex */
+        std::string printable() const;
+    };
+
+    std::vector<Entry> entries; // in restore order: selected features before their selector, tree order otherwise
+    double milliseconds = 0.0;  // time it took to take the snapshot
+
+    const Entry* find(const std::string& key) const;
+};
+
+struct FeatureChange {
+    std::string key;
+    std::string before; // empty if the feature is only in the second snapshot
+    std::string after;  // empty if the feature is only in the first snapshot
+};
+
+struct RestoreReport {
+    size_t writes = 0;
+    std::vector<std::string> failed;     // keys which could not be written even after retrying
+    std::vector<std::string> mismatched; // written keys whose value read back differs, e.g. reset by a later write
+    double milliseconds = 0.0;
+};
+
 class ReadWriteHelper {
 public:
     ReadWriteHelper(ArvCamera* camera) : _camera(camera) {}
 
+    /*
+     * Walks the GenICam node tree from the Root category once and reads every implemented, available and readable
+     * feature. Enumeration selectors are iterated over their available entries and restored afterwards.
+     * Commands are skipped.
+     * The register cache is enabled for the walk, so registers shared by several features (bitfields, availability
+     * and bounds) are read once. That relies on the device description declaring which registers invalidate
+     * others. Every selector entry still costs one write of the selector.
+     */
+    FeatureSnapshot takeSnapshot();
+
+    /* Features whose value differs between the snapshots, in the order of `to` */
+    static std::vector<FeatureChange> diffSnapshots(const FeatureSnapshot& from, const FeatureSnapshot& to);
+
+    /*
+     * Writes the writable features of `target` which differ from the device state, in snapshot order. Writes which
+     * fail (typically because they depend on a feature restored later, e.g. a bound) are retried after the others.
+     * The order does not follow selector or invalidator dependencies, so a later write may still change an earlier
+     * one: the written features are read back afterwards and the differing ones reported in `mismatched`.
+     * `current` avoids reading the device state again when a fresh snapshot is at hand.
+     */
+    bool restoreSnapshot(const FeatureSnapshot& target, RestoreReport* report = nullptr,
+                         const FeatureSnapshot* current = nullptr);
+
     bool testCommandFeature(const std::string& nodeName);
     bool testBooleanFeature(const std::string& nodeName, const AccessType access = RO, bool val = false);
     bool testStringFeature(const std::string& nodeName, const AccessType access = RO, const std::string& val = "");
@@ -81,6 +143,11 @@ private:
     bool handleError(GError* error = nullptr);
     std::vector<uint8_t> getBuffer(const std::string& nodeName);
 
+    void collectFeatures(ArvGc* genicam, const char* categoryName, std::vector<ArvGcFeatureNode*>& features,
+                         std::unordered_set<ArvGcFeatureNode*>& seen);
+    bool readEntry(ArvGcFeatureNode* node, FeatureSnapshot::Entry& entry);
+    bool writeFeature(ArvGc* genicam, const std::string& feature, const std::string& value, bool isRegister);
+
     template<typename T>
     bool setBuffer(const std::vector<T>& buffer, const std::string& nodeName) {
         ArvGc* genicam = getGenicam();
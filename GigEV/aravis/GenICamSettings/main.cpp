@@ -41,6 +41,11 @@ int main (int argc, char **argv) {
 
     pho::ReadWriteHelper rw(camera.get());
 
+    /* The tests below change settings, remember the device state to restore it at the end */
+    const pho::FeatureSnapshot initial = rw.takeSnapshot();
+    std::cout << "Snapshot of " << initial.entries.size() << " features taken in " << initial.milliseconds << " ms"
+              << std::endl;
+
     /* Internal features for device type check */
     rw.testIntegerFeature("IsMotionCam3D_Val");
     rw.testIntegerFeature("IsMotionCam3DColor_Val");
@@ -181,5 +186,24 @@ int main (int argc, char **argv) {
     rw.testArrayFeature("ColorCalibration_RotationMatrix", EMPTY_DOUBLE_VECTOR);
     rw.testArrayFeature("ColorCalibration_TranslationVector", EMPTY_DOUBLE_VECTOR);
 
-    return 0;
+    ///-----------------------------------------------------------------------------------------------------------------
+
+    const pho::FeatureSnapshot modified = rw.takeSnapshot();
+    const auto changes = pho::ReadWriteHelper::diffSnapshots(initial, modified);
+    std::cout << changes.size() << " features changed by the tests:" << std::endl;
+    for (const auto& change : changes) {
+        std::cout << "  " << change.key << ": " << change.before << " -> " << change.after << std::endl;
+    }
+
+    pho::RestoreReport report;
+    const bool restored = rw.restoreSnapshot(initial, &report, &modified);
+    std::cout << "Settings restored in " << report.milliseconds << " ms with " << report.writes << " writes" << std::endl;
+    for (const auto& key : report.failed) {
+        std::cerr << "Error: Failed to restore " << key << std::endl;
+    }
+    for (const auto& key : report.mismatched) {
+        std::cerr << "Error: " << key << " differs from the snapshot after the restore" << std::endl;
+    }
+
+    return restored ? 0 : 1;
 }
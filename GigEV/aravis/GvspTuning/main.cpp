@@ -0,0 +1,312 @@
+/* SPDX-License-Identifier:Unlicense */
+
+#include "common/PhoAravisCommon.h"
+#include "common/StreamStatistics.h"
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iterator>
+#include <string>
+
+using namespace pho;
+
+/* One combination of the swept transport settings */
+struct TransportSettings {
+    gint packetSize;          // GevSCPSPacketSize [bytes]
+    gint64 packetDelay;       // GevSCPD inter-packet delay [ns]
+    guint socketBufferSize;   // 0 = let aravis size the socket buffer (auto)
+    guint packetTimeoutUs;    // wait for a missing packet before requesting a resend
+    guint frameRetentionUs;   // give up on an incomplete frame after this time
+};
+
+struct SweepResult {
+    TransportSettings settings;
+    uint64_t completed = 0;
+    uint64_t failed = 0;
+    uint64_t underruns = 0;
+    uint64_t resentPackets = 0;
+    uint64_t missingPackets = 0;
+    double seconds = 0.0;
+    size_t payload = 0;
+
+    double completion() const { return completed + failed ? double(completed) / double(completed + failed) : 0.0; }
+    double throughputMBs() const { return seconds > 0 ? completed * double(payload) / seconds / 1e6 : 0.0; }
+    /* Resent packets per 1000 packets, the packet count is estimated from the payload and the packet size */
+    double resendRate() const {
+        const double packetPayload = std::max(1, settings.packetSize - 36); // IP + UDP + GVSP headers
+        const double packets = (completed + failed) * double(payload) / packetPayload;
+        return packets > 0 ? 1000.0 * resentPackets / packets : 0.0;
+    }
+};
+
+/*
+ * Ranking: complete frames first (a setting which loses frames is never preferred), then throughput,
+ * then fewer resends.
+ */
+bool isBetter(const SweepResult& a, const SweepResult& b) {
+    const bool aComplete = a.completion() >= 0.999;
+    const bool bComplete = b.completion() >= 0.999;
+    if (aComplete != bComplete) {
+        return aComplete;
+    }
+    if (std::abs(a.throughputMBs() - b.throughputMBs()) > 0.01 * std::max(a.throughputMBs(), b.throughputMBs())) {
+        return a.throughputMBs() > b.throughputMBs();
+    }
+    return a.resendRate() < b.resendRate();
+}
+
+bool applyDeviceSettings(ArvCamera* camera, const TransportSettings& settings) {
+    GError* error = nullptr;
+    arv_camera_gv_set_packet_size(camera, settings.packetSize, &error);
+    if (error) {
+        std::cerr << "Error: Failed to set GevSCPSPacketSize=" << settings.packetSize << ": " << error->message << std::endl;
+        g_clear_error(&error);
+        return false;
+    }
+    arv_camera_gv_set_packet_delay(camera, settings.packetDelay, &error);
+    if (error) {
+        std::cerr << "Error: Failed to set GevSCPD=" << settings.packetDelay << ": " << error->message << std::endl;
+        g_clear_error(&error);
+        return false;
+    }
+    return true;
+}
+
+bool measure(ArvCamera* camera, const TransportSettings& settings, double seconds, int bufferCount, SweepResult& result) {
+    result = SweepResult();
+    result.settings = settings;
+
+    if (!applyDeviceSettings(camera, settings)) {
+        return false;
+    }
+
+    GError* error = nullptr;
+    result.payload = arv_camera_get_payload(camera, &error);
+    if (error) {
+        std::cerr << "Error: Failed to obtain payload size: " << error->message << std::endl;
+        g_clear_error(&error);
+        return false;
+    }
+
+    /* A new stream for every combination, the socket buffer and timeouts are stream properties */
+    auto stream = create_gobject_unique(arv_camera_create_stream(camera, nullptr, nullptr, &error));
+    if (error || !ARV_IS_STREAM(stream.get())) {
+        std::cerr << "Error: Failed to create stream: " << (error ? error->message : "") << std::endl;
+        g_clear_error(&error);
+        return false;
+    }
+
+    g_object_set(stream.get(),
+                 "packet-resend", ARV_GV_STREAM_PACKET_RESEND_ALWAYS,
+                 "packet-timeout", settings.packetTimeoutUs,
+                 "frame-retention", settings.frameRetentionUs,
+                 nullptr);
+    if (settings.socketBufferSize) {
+        g_object_set(stream.get(),
+                     "socket-buffer", ARV_GV_STREAM_SOCKET_BUFFER_FIXED,
+                     "socket-buffer-size", gint(settings.socketBufferSize),
+                     nullptr);
+    } else {
+        g_object_set(stream.get(), "socket-buffer", ARV_GV_STREAM_SOCKET_BUFFER_AUTO, nullptr);
+    }
+
+    for (int i = 0; i < bufferCount; ++i) {
+        arv_stream_push_buffer(stream.get(), arv_buffer_new(result.payload, nullptr));
+    }
+
+    arv_camera_start_acquisition(camera, &error);
+    if (error) {
+        std::cerr << "Error: Failed to start acquisition: " << error->message << std::endl;
+        g_clear_error(&error);
+        return false;
+    }
+
+    /* Skip the first frames, they include the start-up of the device pipeline */
+    const auto warmUpEnd = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+    while (std::chrono::steady_clock::now() < warmUpEnd) {
+        if (auto* buffer = arv_stream_timeout_pop_buffer(stream.get(), 100000)) {
+            arv_stream_push_buffer(stream.get(), buffer);
+        }
+    }
+    const TransportCounters before = StreamStatistics::transport(stream.get());
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto end = start + std::chrono::duration<double>(seconds);
+    while (std::chrono::steady_clock::now() < end) {
+        auto* buffer = arv_stream_timeout_pop_buffer(stream.get(), 100000);
+        if (!buffer) {
+            continue;
+        }
+        if (arv_buffer_get_status(buffer) == ARV_BUFFER_STATUS_SUCCESS) {
+            ++result.completed;
+        } else {
+            ++result.failed;
+        }
+        arv_stream_push_buffer(stream.get(), buffer);
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const TransportCounters after = StreamStatistics::transport(stream.get());
+    result.underruns = after.underruns - before.underruns;
+    result.resentPackets = after.resentPackets - before.resentPackets;
+    result.missingPackets = after.missingPackets - before.missingPackets;
+
+    arv_camera_stop_acquisition(camera, &error);
+    if (error) {
+        std::cerr << "Error: Failed to stop acquisition: " << error->message << std::endl;
+        g_clear_error(&error);
+        return false;
+    }
+    return true;
+}
+
+void printHeader() {
+    std::cout << std::setw(7) << "packet" << std::setw(9) << "delay" << std::setw(10) << "socket"
+              << std::setw(9) << "timeout" << std::setw(10) << "retention"
+              << std::setw(9) << "frames" << std::setw(9) << "failed" << std::setw(10) << "underrun"
+              << std::setw(9) << "MB/s" << std::setw(10) << "resend/1k" << std::setw(9) << "missing" << std::endl;
+    std::cout << std::setw(7) << "[B]" << std::setw(9) << "[ns]" << std::setw(10) << "[KiB]"
+              << std::setw(9) << "[us]" << std::setw(10) << "[us]" << std::endl;
+}
+
+void printResult(const SweepResult& result) {
+    const auto& settings = result.settings;
+    std::cout << std::setw(7) << settings.packetSize << std::setw(9) << settings.packetDelay << std::setw(10)
+              << (settings.socketBufferSize ? std::to_string(settings.socketBufferSize / 1024) : std::string("auto"))
+              << std::setw(9) << settings.packetTimeoutUs << std::setw(10) << settings.frameRetentionUs
+              << std::setw(9) << result.completed << std::setw(9) << result.failed << std::setw(10) << result.underruns
+              << std::fixed << std::setprecision(1) << std::setw(9) << result.throughputMBs()
+              << std::setprecision(2) << std::setw(10) << result.resendRate()
+              << std::setw(9) << result.missingPackets << std::endl;
+}
+
+/*
+ * Sweeps the GigE Vision streaming (GVSP) transport settings: packet size, inter-packet delay, stream socket
+ * buffer size and packet timeout / frame retention. Every combination streams for a few seconds, the sustained
+ * throughput, resend rate and frame completion are printed and the best configuration for this host is reported.
+ * Original packet size and delay are restored at the end.
+ *
+ * Works against the aravis fake GigE Vision camera as well, no sensor needed:
+ *     arv-fake-gv-camera-0.8 -i 127.0.0.1 &
+ *     GvspTuning 127.0.0.1
+ *
+ * Usage: GvspTuning <device IP> [seconds per combination [buffers]]
+ */
+int main (int argc, char **argv)
+{
+    if(argc < 2) {
+        std::cerr << "Provide device IP as a parameter!" << std::endl;
+        return 1;
+    }
+
+    const char* deviceIp = argv[1];
+    const double seconds = argc >= 3 ? std::max(0.5, std::stod(argv[2])) : 2.0;
+    const int bufferCount = argc >= 4 ? std::max(2, std::stoi(argv[3])) : 10;
+
+    GError *error = nullptr;
+
+    /* Connect to the first available camera */
+    auto camera = create_gobject_unique(arv_camera_new (deviceIp, &error));
+    if(error) {
+        std::cerr << "Error: " << error->message << std::endl;
+        return 1;
+    }
+
+    if(!ARV_IS_CAMERA(camera.get()) || !arv_camera_is_gv_device(camera.get())) {
+        std::cerr << "Error: Not a GigE Vision camera instance!";
+        return 1;
+    }
+
+    std::cerr << "Connected to camera: " << arv_camera_get_model_name (camera.get(), nullptr) << std::endl;
+
+    ///-----------------------------------------------------------------------------------------------------------------
+
+    if(!setTriggerMode(camera.get(), TriggerMode::Freerun)) {
+        return 1;
+    }
+
+    /* The sweep sets the packet size explicitly, aravis must not renegotiate it when creating the stream */
+    arv_camera_gv_set_packet_size_adjustment(camera.get(), ARV_GV_PACKET_SIZE_ADJUSTMENT_NEVER);
+
+    const gint originalPacketSize = arv_camera_gv_get_packet_size(camera.get(), &error);
+    if(error) {
+        std::cerr << "Error: Failed to read GevSCPSPacketSize: " << error->message << std::endl;
+        return 1;
+    }
+    const gint64 originalPacketDelay = arv_camera_gv_get_packet_delay(camera.get(), &error);
+    if(error) {
+        std::cerr << "Error: Failed to read GevSCPD: " << error->message << std::endl;
+        return 1;
+    }
+
+    gint64 minPacketSize = 0, maxPacketSize = 0;
+    arv_camera_get_integer_bounds(camera.get(), "GevSCPSPacketSize", &minPacketSize, &maxPacketSize, &error);
+    if(error) {
+        std::cerr << "Error: Failed to read GevSCPSPacketSize bounds: " << error->message << std::endl;
+        return 1;
+    }
+
+    /* Standard MTU, common jumbo sizes and the device maximum. Sizes above the NIC MTU simply fail to stream. */
+    std::vector<gint> packetSizes;
+    for(gint64 size : {gint64(1500), gint64(4000), gint64(8192), gint64(9000), maxPacketSize}) {
+        size = std::min(std::max(size, minPacketSize), maxPacketSize);
+        if(std::find(packetSizes.begin(), packetSizes.end(), gint(size)) == packetSizes.end()) {
+            packetSizes.push_back(gint(size));
+        }
+    }
+    const gint64 packetDelays[] = {0, 2000, 10000};
+    const guint socketBufferSizes[] = {0, 4u << 20, 16u << 20};
+    const std::pair<guint, guint> timeouts[] = {{20000, 100000}, {40000, 200000}};
+
+    const size_t combinations = packetSizes.size() * std::size(packetDelays) * std::size(socketBufferSizes)
+                                * std::size(timeouts);
+    std::cout << "Sweeping " << combinations << " combinations, " << seconds << " s each..." << std::endl;
+    printHeader();
+
+    bool hasBest = false;
+    SweepResult best;
+    for(gint packetSize : packetSizes) {
+        for(gint64 packetDelay : packetDelays) {
+            for(guint socketBufferSize : socketBufferSizes) {
+                for(const auto& timeout : timeouts) {
+                    const TransportSettings settings{packetSize, packetDelay, socketBufferSize, timeout.first, timeout.second};
+                    SweepResult result;
+                    if(!measure(camera.get(), settings, seconds, bufferCount, result)) {
+                        continue;
+                    }
+                    printResult(result);
+                    if(!hasBest || isBetter(result, best)) {
+                        best = result;
+                        hasBest = true;
+                    }
+                }
+            }
+        }
+    }
+
+    applyDeviceSettings(camera.get(), {originalPacketSize, originalPacketDelay, 0, 0, 0});
+
+    if(!hasBest) {
+        std::cerr << "Error: No combination could be measured!" << std::endl;
+        return 1;
+    }
+
+    std::cout << std::endl << "Best configuration for this host:" << std::endl;
+    printHeader();
+    printResult(best);
+    std::cout << std::endl
+              << "  arv_camera_gv_set_packet_size(camera, " << best.settings.packetSize << ", &error);" << std::endl
+              << "  arv_camera_gv_set_packet_delay(camera, " << best.settings.packetDelay << ", &error);" << std::endl
+              << "  g_object_set(stream, \"packet-timeout\", " << best.settings.packetTimeoutUs
+              << ", \"frame-retention\", " << best.settings.frameRetentionUs << ", nullptr);" << std::endl;
+    if(best.settings.socketBufferSize) {
+        std::cout << "  g_object_set(stream, \"socket-buffer\", ARV_GV_STREAM_SOCKET_BUFFER_FIXED, \"socket-buffer-size\", "
+                  << best.settings.socketBufferSize << ", nullptr);" << std::endl;
+    }
+    if(best.completion() < 0.999) {
+        std::cout << "Warning: no combination delivered all frames, check the NIC MTU and the link load." << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,583 @@
+/* SPDX-License-Identifier:Unlicense */
+
+#include "common/CalculateNormals.h"
+#include "common/CompactPoints.h"
+#include "common/MotionCompensation.h"
+#include "common/ProjectedC.h"
+#if defined(PHO_HAVE_OPENCV)
+#include "common/YCoCg.h"
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+
+using namespace pho;
+
+/* Counted replacements of the global allocation functions, see Measurement::allocations */
+std::atomic<uint64_t> allocationCount{0};
+
+#if defined(__GNUC__) && !defined(__clang__)
+/* GCC does not see that the deletes below pair with the replaced operator new */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+struct BenchmarkConfig {
+    uint32_t width = 2064;
+    uint32_t height = 1544;
+    int iterations = 50;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+};
+
+struct Measurement {
+    double ns = 0.0;          // average time per call
+    double allocations = 0.0; // operator new calls of the whole process per call, 0 for kernels reusing the
+                              // caller's buffers (C allocations, e.g. of cv::Mat data, are not counted)
+};
+
+/* Runs `func` once to warm up, then `iterations` times and returns the averages per call */
+template <typename Func>
+Measurement measure(int iterations, Func&& func) {
+    func();
+    const uint64_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        func();
+    }
+    const auto end = std::chrono::steady_clock::now();
+    Measurement measurement;
+    measurement.ns = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+    measurement.allocations = double(allocationCount.load(std::memory_order_relaxed) - allocationsBefore) / iterations;
+    return measurement;
+}
+
+void printHeader() {
+    std::cout << "  " << std::left << std::setw(40) << "" << std::right << std::setw(13) << "time" << std::setw(16)
+              << "per pixel" << std::setw(12) << "memory" << std::setw(12) << "allocs/call" << std::setw(9)
+              << "speedup" << std::endl;
+}
+
+/* `bytes`: read and written by one call, for the memory throughput */
+void printResult(const std::string& name, const Measurement& measurement, size_t pixels, size_t bytes,
+                 double baselineNs) {
+    const double ns = measurement.ns;
+    std::cout << "  " << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(10) << ns / 1e6 << " ms" << std::setw(10) << ns / pixels << " ns/px"
+              << std::setw(7) << std::setprecision(2) << bytes / ns << " GB/s"
+              << std::setw(12) << std::setprecision(1) << measurement.allocations << std::setw(8) << std::setprecision(2)
+              << baselineNs / ns << "x" << std::endl;
+}
+
+void benchmarkNormals(const BenchmarkConfig& config) {
+    const size_t pixels = size_t(config.width) * config.height;
+    std::vector<NormalsAngles> angles(pixels);
+    std::mt19937 generator(42);
+    for (auto& angle : angles) {
+        angle.x = static_cast<uint8_t>(generator());
+        angle.y = static_cast<uint8_t>(generator());
+    }
+
+    std::vector<Vec3D> normals(pixels);
+    std::vector<float> normalsX(pixels), normalsY(pixels), normalsZ(pixels);
+
+    /* Check the fast paths against the reference implementation */
+    const auto reference = calculateNormals(angles.data(), config.width, config.height);
+    calculateNormals(angles.data(), config.width, config.height, normals.data(), config.threads);
+    calculateNormals(angles.data(), config.width, config.height,
+                     normalsX.data(), normalsY.data(), normalsZ.data(), config.threads);
+    for (size_t i = 0; i < pixels; ++i) {
+        if (reference[i].x != normals[i].x || reference[i].y != normals[i].y || reference[i].z != normals[i].z
+            || reference[i].x != normalsX[i] || reference[i].y != normalsY[i] || reference[i].z != normalsZ[i]) {
+            std::cerr << "Error: calculateNormals mismatch at pixel " << i << std::endl;
+            std::exit(1);
+        }
+    }
+
+    /* 2 bytes of angles in, 12 bytes of normal out per pixel */
+    const size_t bytes = pixels * (sizeof(NormalsAngles) + sizeof(Vec3D));
+    std::cout << "calculateNormals (Coord3D_AC8 -> Vec3D):" << std::endl;
+    printHeader();
+    const Measurement baseline = measure(config.iterations, [&]() {
+        auto result = calculateNormals(angles.data(), config.width, config.height);
+    });
+    printResult("reference (allocating, 768 KB table)", baseline, pixels, bytes, baseline.ns);
+    printResult("into buffer, 1 thread", measure(config.iterations, [&]() {
+        calculateNormals(angles.data(), config.width, config.height, normals.data());
+    }), pixels, bytes, baseline.ns);
+    printResult("into x/y/z planes, 1 thread", measure(config.iterations, [&]() {
+        calculateNormals(angles.data(), config.width, config.height,
+                         normalsX.data(), normalsY.data(), normalsZ.data());
+    }), pixels, bytes, baseline.ns);
+    if (config.threads > 1) {
+        printResult("into buffer, " + std::to_string(config.threads) + " threads", measure(config.iterations, [&]() {
+            calculateNormals(angles.data(), config.width, config.height, normals.data(), config.threads);
+        }), pixels, bytes, baseline.ns);
+        printResult("into x/y/z planes, " + std::to_string(config.threads) + " threads", measure(config.iterations, [&]() {
+            calculateNormals(angles.data(), config.width, config.height,
+                             normalsX.data(), normalsY.data(), normalsZ.data(), config.threads);
+        }), pixels, bytes, baseline.ns);
+    }
+}
+
+void benchmarkNormalsEncoder(const BenchmarkConfig& config) {
+    const size_t pixels = size_t(config.width) * config.height;
+
+    /* Uniformly distributed unit normals */
+    std::vector<Vec3D> normals(pixels);
+    std::mt19937 generator(42);
+    std::normal_distribution<float> distribution;
+    for (auto& normal : normals) {
+        float length = 0.0f;
+        while (length < 1e-3f) {
+            normal = {distribution(generator), distribution(generator), distribution(generator)};
+            length = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+        }
+        normal = {normal.x / length, normal.y / length, normal.z / length};
+    }
+    std::vector<NormalsAngles> angles(pixels);
+    std::vector<Vec3D> decoded(pixels);
+
+    /* Every decode table entry encodes back to itself (at the pole, polar 0, the azimuth is undefined) */
+    std::vector<NormalsAngles> table(256 * 256);
+    for (size_t i = 0; i < table.size(); ++i) {
+        table[i] = {uint8_t(i % 256), uint8_t(i / 256)};
+    }
+    std::vector<Vec3D> tableNormals(table.size());
+    std::vector<NormalsAngles> tableAngles(table.size());
+    calculateNormals(table.data(), 256, 256, tableNormals.data());
+    encodeNormals(tableNormals.data(), 256, 256, tableAngles.data());
+    for (size_t i = 0; i < table.size(); ++i) {
+        if (tableAngles[i].y != table[i].y || (table[i].y != 0 && tableAngles[i].x != table[i].x)) {
+            std::cerr << "Error: encodeNormals table round trip mismatch at entry " << i << std::endl;
+            std::exit(1);
+        }
+    }
+
+    /* Error bound: half a step in both angles, pi / 512 polar and pi / 256 azimuthal (scaled by sin(polar)) */
+    const double maxErrorRad = std::sqrt(1.25) * 3.14159265359 / 256.0 + 1e-5;
+    double maxError = 0.0;
+    encodeNormals(normals.data(), config.width, config.height, angles.data(), config.threads);
+    calculateNormals(angles.data(), config.width, config.height, decoded.data(), config.threads);
+    for (size_t i = 0; i < pixels; ++i) {
+        const double dot = double(normals[i].x) * decoded[i].x + double(normals[i].y) * decoded[i].y
+                           + double(normals[i].z) * decoded[i].z;
+        const double error = std::acos(std::min(1.0, dot));
+        const NormalsAngles scalar = detail::encodeNormal(normals[i].x, normals[i].y, normals[i].z);
+        if (error > maxErrorRad || scalar.x != angles[i].x || scalar.y != angles[i].y) {
+            std::cerr << "Error: encodeNormals mismatch at pixel " << i << ", error " << error << " rad" << std::endl;
+            std::exit(1);
+        }
+        maxError = std::max(maxError, error);
+    }
+
+    std::cout << "encodeNormals (Vec3D -> Coord3D_AC8), relative to the decoder, max error "
+              << std::setprecision(3) << maxError * 180.0 / 3.14159265359 << " deg:" << std::endl;
+    printHeader();
+    const size_t bytes = pixels * (sizeof(Vec3D) + sizeof(NormalsAngles));
+    const Measurement baseline = measure(config.iterations, [&]() {
+        calculateNormals(angles.data(), config.width, config.height, decoded.data());
+    });
+    printResult("decoder, 1 thread", baseline, pixels, bytes, baseline.ns);
+    printResult("encoder, 1 thread", measure(config.iterations, [&]() {
+        encodeNormals(normals.data(), config.width, config.height, angles.data());
+    }), pixels, bytes, baseline.ns);
+    if (config.threads > 1) {
+        printResult("encoder, " + std::to_string(config.threads) + " threads", measure(config.iterations, [&]() {
+            encodeNormals(normals.data(), config.width, config.height, angles.data(), config.threads);
+        }), pixels, bytes, baseline.ns);
+    }
+}
+
+void benchmarkCompaction(const BenchmarkConfig& config) {
+    const size_t pixels = size_t(config.width) * config.height;
+
+    /* PFNC pixel formats of the synthetic frame: Range and Normal Coord3D_ABC32f, Intensity Mono16, Confidence8 */
+    const ArvPixelFormat coord3dAbc32f = 0x026000C0, mono16 = 0x01100007, confidence8 = 0x010800C6;
+    std::vector<Vec3D> range(pixels), normals(pixels);
+    std::vector<uint16_t> intensity(pixels);
+    std::vector<uint8_t> confidence(pixels);
+    std::mt19937 generator(42);
+    for (size_t i = 0; i < pixels; ++i) {
+        range[i] = {float(i % config.width), float(i / config.width), 500.0f + float(generator() % 1000)};
+        normals[i] = {0.0f, 0.0f, 1.0f};
+        intensity[i] = static_cast<uint16_t>(generator());
+    }
+
+    MultipartViews views;
+    views.configure({{Intensity, 1}, {Range, 2}, {Confidence, 3}, {Normal, 4}});
+    const auto partView = [&](const void* data, size_t elementSize, ArvPixelFormat pixelFormat) {
+        PartView view;
+        view.data = data;
+        view.size = pixels * elementSize;
+        view.width = config.width;
+        view.height = config.height;
+        view.stride = config.width * elementSize;
+        view.pixelFormat = pixelFormat;
+        return view;
+    };
+    views.setView(1, partView(intensity.data(), sizeof(uint16_t), mono16));
+    views.setView(2, partView(range.data(), sizeof(Vec3D), coord3dAbc32f));
+    views.setView(3, partView(confidence.data(), sizeof(uint8_t), confidence8));
+    views.setView(4, partView(normals.data(), sizeof(Vec3D), coord3dAbc32f));
+    const size_t frameBytes = pixels * (2 * sizeof(Vec3D) + sizeof(uint16_t) + sizeof(uint8_t));
+
+    std::cout << "compactPoints (Range, Normal, Intensity, Confidence by Confidence8), relative to copying the frame:"
+              << std::endl;
+    printHeader();
+    std::vector<uint8_t> copy(frameBytes);
+    const Measurement baseline = measure(config.iterations, [&]() {
+        uint8_t* out = copy.data();
+        for (const PartView* view : {&views.intensity(), &views.range(), &views.confidence(), &views.normal()}) {
+            std::memcpy(out, view->data, view->size);
+            out += view->size;
+        }
+    });
+    printResult("copy of all parts", baseline, pixels, 2 * frameBytes, baseline.ns);
+
+    CompactedPoints points;
+    for (const int invalidPercent : {0, 10, 50, 90}) {
+        /* Invalid pixels in runs, as at object edges and in shadows */
+        size_t expected = 0;
+        for (size_t i = 0; i < pixels;) {
+            const size_t run = 1 + generator() % 32;
+            const bool invalid = int(generator() % 100) < invalidPercent;
+            for (size_t end = std::min(pixels, i + run); i < end; ++i) {
+                confidence[i] = invalid ? 0 : static_cast<uint8_t>(1 + generator() % 255);
+                expected += invalid ? 0 : 1;
+            }
+        }
+
+        /* Check against the per-pixel reference, then the Range validity mask (every Z is valid here) */
+        if (!compactPoints(views, points) || points.size() != expected) {
+            std::cerr << "Error: compactPoints returned " << points.size() << " points, expected " << expected
+                      << std::endl;
+            std::exit(1);
+        }
+        for (size_t i = 0, j = 0; i < pixels; ++i) {
+            if (confidence[i] == 0) {
+                continue;
+            }
+            if (points.indices()[j] != i || points.as<Vec3D>(Range)[j].z != range[i].z
+                || points.as<uint16_t>(Intensity)[j] != intensity[i]
+                || points.as<uint8_t>(Confidence)[j] != confidence[i] || points.as<Vec3D>(Normal)[j].z != 1.0f) {
+                std::cerr << "Error: compactPoints mismatch at pixel " << i << std::endl;
+                std::exit(1);
+            }
+            ++j;
+        }
+        if (!compactPoints(views, points, CompactionMask::RangeValid) || points.size() != pixels) {
+            std::cerr << "Error: compactPoints by Range validity returned " << points.size() << " points" << std::endl;
+            std::exit(1);
+        }
+
+        /* The confidence is read, the valid elements of every part copied */
+        const Measurement measurement = measure(config.iterations, [&]() { compactPoints(views, points); });
+        printResult(std::to_string(invalidPercent) + "% invalid, "
+                            + std::to_string(100 * points.bytes() / frameBytes) + "% of the frame bytes",
+                    measurement, pixels, pixels * sizeof(uint8_t) + 2 * points.bytes(), baseline.ns);
+    }
+}
+
+void benchmarkMotionCompensation(const BenchmarkConfig& config) {
+    const size_t pixels = size_t(config.width) * config.height;
+    std::vector<Vec3D> points(pixels);
+    std::vector<float> times(pixels);
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> coordinate(-500.0f, 500.0f), time(0.0f, 20.0f);
+    for (size_t i = 0; i < pixels; ++i) {
+        /* Every 10th point invalid */
+        const Vec3D point{coordinate(generator), coordinate(generator), 1000.0f + coordinate(generator)};
+        points[i] = generator() % 10 == 0 ? Vec3D{0.0f, 0.0f, 0.0f} : point;
+        times[i] = time(generator);
+    }
+    const Vec3D velocity{0.5f, -0.25f, 0.05f}; // mm/ms
+
+    /* Check against the per-point reference, invalid points must stay at (0, 0, 0) */
+    std::vector<Vec3D> compensated = points;
+    compensateMotion(compensated.data(), times.data(), config.width, config.height, velocity, config.threads);
+    for (size_t i = 0; i < pixels; ++i) {
+        const Vec3D& p = points[i];
+        const Vec3D expected = p.z == 0.0f ? p : Vec3D{p.x - velocity.x * times[i], p.y - velocity.y * times[i],
+                                                       p.z - velocity.z * times[i]};
+        const Vec3D& c = compensated[i];
+        if (std::abs(c.x - expected.x) > 1e-3f || std::abs(c.y - expected.y) > 1e-3f
+            || std::abs(c.z - expected.z) > 1e-3f || (p.z == 0.0f && (c.x != 0.0f || c.y != 0.0f || c.z != 0.0f))) {
+            std::cerr << "Error: compensateMotion mismatch at pixel " << i << std::endl;
+            std::exit(1);
+        }
+    }
+
+    /* Points and event times read, points written */
+    const size_t bytes = pixels * (2 * sizeof(Vec3D) + sizeof(float));
+    std::cout << "compensateMotion (Coord3D_ABC32f Range + Event, in place):" << std::endl;
+    printHeader();
+    const Measurement baseline = measure(config.iterations, [&]() {
+        for (size_t i = 0; i < pixels; ++i) {
+            if (compensated[i].z != 0.0f) {
+                compensated[i].x -= velocity.x * times[i];
+                compensated[i].y -= velocity.y * times[i];
+                compensated[i].z -= velocity.z * times[i];
+            }
+        }
+    });
+    printResult("per-point loop", baseline, pixels, bytes, baseline.ns);
+    printResult("compensateMotion, 1 thread", measure(config.iterations, [&]() {
+        compensateMotion(compensated.data(), times.data(), config.width, config.height, velocity);
+    }), pixels, bytes, baseline.ns);
+    if (config.threads > 1) {
+        printResult("compensateMotion, " + std::to_string(config.threads) + " threads",
+                    measure(config.iterations, [&]() {
+                        compensateMotion(compensated.data(), times.data(), config.width, config.height, velocity,
+                                         config.threads);
+                    }), pixels, bytes, baseline.ns);
+    }
+}
+
+void benchmarkRangeReconstruction(const BenchmarkConfig& config) {
+    const size_t pixels = size_t(config.width) * config.height;
+
+    /* Pinhole factors of a 60 x 45 degree field of view, Range with invalid (0) runs as in shadows */
+    std::vector<float> range(pixels), factorX(pixels), factorY(pixels);
+    std::mt19937 generator(42);
+    for (size_t i = 0; i < pixels;) {
+        const size_t run = 1 + generator() % 64;
+        const bool invalid = generator() % 100 < 20;
+        for (size_t end = std::min(pixels, i + run); i < end; ++i) {
+            range[i] = invalid ? 0.0f : 500.0f + float(generator() % 1000);
+        }
+    }
+    for (size_t i = 0; i < pixels; ++i) {
+        factorX[i] = (float(i % config.width) / config.width - 0.5f) * 1.15f;
+        factorY[i] = (float(i / config.width) / config.height - 0.5f) * 0.83f;
+    }
+    std::vector<Vec3D> points(pixels);
+
+    /* The loop of ProjectedCReconstructor::reconstruct(), whose maps can only be prepared from a device */
+    const auto reconstruct = [&](unsigned threads) {
+        parallelRows(config.height, threads, [&](uint32_t firstRow, uint32_t endRow) {
+            const size_t offset = size_t(firstRow) * config.width;
+            detail::reconstructPoints(range.data() + offset, factorX.data() + offset, factorY.data() + offset,
+                                      size_t(endRow - firstRow) * config.width, points.data() + offset);
+        });
+    };
+
+    /* Check against the per-point reference, invalid points must end up at (0, 0, 0) */
+    reconstruct(config.threads);
+    for (size_t i = 0; i < pixels; ++i) {
+        if (points[i].x != range[i] * factorX[i] || points[i].y != range[i] * factorY[i] || points[i].z != range[i]
+            || (range[i] == 0.0f && (points[i].x != 0.0f || points[i].y != 0.0f))) {
+            std::cerr << "Error: ProjectedC reconstruction mismatch at pixel " << i << std::endl;
+            std::exit(1);
+        }
+    }
+
+    /* Range and both factors read, points written */
+    const size_t bytes = pixels * (3 * sizeof(float) + sizeof(Vec3D));
+    std::cout << "ProjectedC reconstruction (Coord3D_C32f Range -> Vec3D, 20% invalid):" << std::endl;
+    printHeader();
+    const Measurement baseline = measure(config.iterations, [&]() {
+        for (size_t i = 0; i < pixels; ++i) {
+            points[i] = {range[i] * factorX[i], range[i] * factorY[i], range[i]};
+        }
+    });
+    printResult("per-point loop", baseline, pixels, bytes, baseline.ns);
+    printResult("reconstruct, 1 thread", measure(config.iterations, [&]() { reconstruct(1); }), pixels, bytes,
+                baseline.ns);
+    if (config.threads > 1) {
+        printResult("reconstruct, " + std::to_string(config.threads) + " threads",
+                    measure(config.iterations, [&]() { reconstruct(config.threads); }), pixels, bytes, baseline.ns);
+    }
+}
+
+#if defined(PHO_HAVE_OPENCV)
+void benchmarkYCoCg(const BenchmarkConfig& config) {
+    const size_t pixels = size_t(config.width) * config.height;
+    cv::Mat_<YCoCg::YCoCgType> ycocg(config.height, config.width);
+    std::mt19937 generator(42);
+    for (int row = 0; row < ycocg.rows; ++row) {
+        for (int col = 0; col < ycocg.cols; ++col) {
+            /* Every 8th pixel black (Y = 0) to exercise the special case */
+            const auto value = static_cast<YCoCg::YCoCgType>(generator());
+            ycocg(row, col) = generator() % 8 == 0 ? value & 0x3F : value;
+        }
+    }
+
+    cv::Mat_<YCoCg::RGBType> rgb;
+    cv::Mat_<YCoCg::RGB8Type> rgb8;
+
+    /* Check the fast paths against the reference implementation */
+    const auto reference = YCoCg::convertToRGB(ycocg);
+    YCoCg::convertToRGB(ycocg, rgb, config.threads);
+    YCoCg::convertToRGB8(ycocg, rgb8, YCoCg::ChannelOrder::RGB, config.threads);
+    for (int row = 0; row < ycocg.rows; ++row) {
+        for (int col = 0; col < ycocg.cols; ++col) {
+            for (int ch = 0; ch < 3; ++ch) {
+                if (reference(row, col)[ch] != rgb(row, col)[ch]
+                    || (reference(row, col)[ch] >> (YCoCg::pixelDepth - 8)) != rgb8(row, col)[ch]) {
+                    std::cerr << "Error: YCoCg::convertToRGB mismatch at pixel " << row << ", " << col << std::endl;
+                    std::exit(1);
+                }
+            }
+        }
+    }
+
+    /* 2 bytes in, 6 (RGB16) or 3 (RGB8) bytes out per pixel */
+    const size_t bytes16 = pixels * (sizeof(YCoCg::YCoCgType) + sizeof(YCoCg::RGBType));
+    const size_t bytes8 = pixels * (sizeof(YCoCg::YCoCgType) + sizeof(YCoCg::RGB8Type));
+    std::cout << "YCoCg::convertToRGB (Mono16 YCoCg -> RGB):" << std::endl;
+    printHeader();
+    const Measurement baseline = measure(config.iterations, [&]() {
+        auto result = YCoCg::convertToRGB(ycocg);
+    });
+    printResult("reference (allocating, RGB16)", baseline, pixels, bytes16, baseline.ns);
+    printResult("into buffer, RGB16, 1 thread", measure(config.iterations, [&]() {
+        YCoCg::convertToRGB(ycocg, rgb);
+    }), pixels, bytes16, baseline.ns);
+    printResult("into buffer, BGR8, 1 thread", measure(config.iterations, [&]() {
+        YCoCg::convertToRGB8(ycocg, rgb8, YCoCg::ChannelOrder::BGR);
+    }), pixels, bytes8, baseline.ns);
+    if (config.threads > 1) {
+        printResult("into buffer, RGB16, " + std::to_string(config.threads) + " threads", measure(config.iterations, [&]() {
+            YCoCg::convertToRGB(ycocg, rgb, config.threads);
+        }), pixels, bytes16, baseline.ns);
+        printResult("into buffer, BGR8, " + std::to_string(config.threads) + " threads", measure(config.iterations, [&]() {
+            YCoCg::convertToRGB8(ycocg, rgb8, YCoCg::ChannelOrder::BGR, config.threads);
+        }), pixels, bytes8, baseline.ns);
+    }
+}
+
+void benchmarkYCoCgEncoder(const BenchmarkConfig& config) {
+    const size_t pixels = size_t(config.width) * config.height;
+    const int maxValue = (1 << YCoCg::pixelDepth) - 1;
+
+    /* Uniformly colored plaquettes (the only case reconstructed exactly by 4:2:0), some fully or partially black */
+    cv::Mat_<YCoCg::RGBType> rgb(config.height, config.width);
+    std::mt19937 generator(42);
+    for (int row = 0; row < rgb.rows; row += 2) {
+        for (int col = 0; col < rgb.cols; col += 2) {
+            const YCoCg::RGBType color(generator() % (maxValue + 1), generator() % (maxValue + 1), generator() % (maxValue + 1));
+            const auto blackPattern = generator() % 8;
+            for (int i = 0; i < 4; ++i) {
+                rgb(row + i / 2, col + i % 2) = blackPattern & (1 << i) ? YCoCg::RGBType(0, 0, 0) : color;
+            }
+        }
+    }
+
+    cv::Mat_<YCoCg::YCoCgType> ycocg;
+    cv::Mat_<YCoCg::RGBType> decoded;
+
+    /* Round trip: only rounding errors allowed and black pixels (only those) must stay black */
+    YCoCg::convertFromRGB(rgb, ycocg, YCoCg::ChannelOrder::RGB, config.threads);
+    YCoCg::convertToRGB(ycocg, decoded, config.threads);
+    const int yShift = 16 - YCoCg::pixelDepth;
+    for (int row = 0; row < rgb.rows; ++row) {
+        for (int col = 0; col < rgb.cols; ++col) {
+            const bool black = rgb(row, col) == YCoCg::RGBType(0, 0, 0);
+            bool ok = black == ((ycocg(row, col) >> yShift) == 0);
+            for (int ch = 0; ch < 3; ++ch) {
+                ok = ok && std::abs(int(rgb(row, col)[ch]) - int(decoded(row, col)[ch])) <= 1;
+            }
+            if (!ok) {
+                std::cerr << "Error: YCoCg round trip mismatch at pixel " << row << ", " << col << std::endl;
+                std::exit(1);
+            }
+        }
+    }
+
+    const size_t bytes = pixels * (sizeof(YCoCg::RGBType) + sizeof(YCoCg::YCoCgType));
+    std::cout << "YCoCg::convertFromRGB (RGB -> Mono16 YCoCg), relative to the decoder:" << std::endl;
+    printHeader();
+    const Measurement baseline = measure(config.iterations, [&]() {
+        YCoCg::convertToRGB(ycocg, decoded);
+    });
+    printResult("decoder, RGB16, 1 thread", baseline, pixels, bytes, baseline.ns);
+    printResult("encoder, RGB16, 1 thread", measure(config.iterations, [&]() {
+        YCoCg::convertFromRGB(rgb, ycocg);
+    }), pixels, bytes, baseline.ns);
+    if (config.threads > 1) {
+        printResult("encoder, RGB16, " + std::to_string(config.threads) + " threads", measure(config.iterations, [&]() {
+            YCoCg::convertFromRGB(rgb, ycocg, YCoCg::ChannelOrder::RGB, config.threads);
+        }), pixels, bytes, baseline.ns);
+    }
+}
+#endif
+
+/*
+ * Measures the host-side decoding and encoding kernels from `common/` on synthetic data, no device needed. Every
+ * kernel is checked against a reference first, then timed: time per call and per pixel, memory throughput (bytes
+ * read and written per call) and heap allocations per call, relative to a baseline of the same section.
+ *
+ * Usage: KernelBenchmark [width height [iterations [threads]]]
+ */
+int main (int argc, char **argv)
+{
+    BenchmarkConfig config;
+    if (argc >= 3) {
+        config.width = std::stoul(argv[1]);
+        config.height = std::stoul(argv[2]);
+    }
+    if (argc >= 4) {
+        config.iterations = std::max(1, std::stoi(argv[3]));
+    }
+    if (argc >= 5) {
+        config.threads = std::max(1, std::stoi(argv[4]));
+    }
+
+    std::cout << "Resolution: " << config.width << "x" << config.height << ", iterations: " << config.iterations
+#if defined(__AVX2__)
+              << ", AVX2: on"
+#else
+              << ", AVX2: off"
+#endif
+              << std::endl;
+
+    benchmarkNormals(config);
+    benchmarkNormalsEncoder(config);
+    benchmarkCompaction(config);
+    benchmarkMotionCompensation(config);
+    benchmarkRangeReconstruction(config);
+#if defined(PHO_HAVE_OPENCV)
+    benchmarkYCoCg(config);
+    benchmarkYCoCgEncoder(config);
+#endif
+
+    return 0;
+}
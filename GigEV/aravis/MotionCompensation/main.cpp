@@ -0,0 +1,133 @@
+/* SPDX-License-Identifier:Unlicense */
+
+#include "common/PhoAravisCommon.h"
+#include "common/BufferArena.h"
+#include "common/DeviceConfig.h"
+#include "common/MotionCompensation.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+using namespace pho;
+
+/*
+ * Streams Range (XYZ) and Event (per-pixel time) from a MotionCam-3D in Camera mode and compensates the motion of
+ * the scene, e.g. on a conveyor, directly in the received buffers: every valid point is shifted back by the
+ * velocity times its event time. The same as the PhoXiAPI MovementCompensation example without PhoXi Control.
+ *
+ * Usage: MotionCompensation <device IP> <velocity x> <velocity y> <velocity z> [frames]
+ *        velocity in mm/ms (= m/s), in the camera coordinate space
+ */
+int main (int argc, char **argv)
+{
+    if(argc < 5) {
+        std::cerr << "Provide device IP and velocity vector as parameters!" << std::endl;
+        return 1;
+    }
+
+    const char* deviceIp = argv[1];
+    const Vec3D velocity{std::stof(argv[2]), std::stof(argv[3]), std::stof(argv[4])};
+    const int frames = argc >= 6 ? std::max(1, std::stoi(argv[5])) : 10;
+
+    GError *error = nullptr;
+
+    /* Connect to the first available camera */
+    auto camera = create_gobject_unique(arv_camera_new (deviceIp, &error));
+    if(error) {
+        std::cerr << "Error: " << error->message << std::endl;
+        return 1;
+    }
+
+    if(!ARV_IS_CAMERA(camera.get())) {
+        std::cerr << "Error: Not a camera instance!";
+        return 1;
+    }
+
+    std::cerr << "Connected to camera: " << arv_camera_get_model_name (camera.get(), nullptr) << std::endl;
+
+    ///-----------------------------------------------------------------------------------------------------------------
+
+    arv_camera_gv_set_packet_size_adjustment (camera.get(), ARV_GV_PACKET_SIZE_ADJUSTMENT_ALWAYS);
+
+    /* The event map is measured in Camera mode, the points must be XYZ (CalibratedABC_Grid) to be shifted */
+    DeviceConfig config;
+    config.triggerMode = TriggerMode::Freerun;
+    config.components = {{Intensity, false}, {Range, true}, {Normal, false}, {Confidence, false}, {Event, true},
+                         {ColorCameraImage, false}, {CoordinateMapA, false}, {CoordinateMapB, false}};
+    config.scan3dOutputMode = "CalibratedABC_Grid";
+    config.outputFormat = StreamOutputFormat::MultipartData;
+    config.features = {{"OperationMode", "Camera"}};
+
+    if(!DeviceConfigurator(camera.get()).apply(config)) {
+        std::cerr << "Error: Failed to configure the device!" << std::endl;
+        return 1;
+    }
+
+    MultipartViews views;
+    if(!views.configure(camera.get()) || !views.isEnabled(Event)) {
+        std::cerr << "Error: The device does not provide the Event component!" << std::endl;
+        return 1;
+    }
+
+    size_t payload = arv_camera_get_payload (camera.get(), &error);
+    if(error) {
+        std::cerr << "Error: Failed to obtain payload size!" << std::endl;
+        return 1;
+    }
+
+    BufferArena arena;
+    auto stream = create_gobject_unique(arv_camera_create_stream (camera.get(), nullptr, nullptr, &error));
+    if(error || !ARV_IS_STREAM(stream.get())) {
+        std::cerr << "Error: Failed to create stream!" << std::endl;
+        return 1;
+    }
+    if(!arena.allocate(payload, 10)) {
+        return 1;
+    }
+    arena.pushBuffers(stream.get());
+
+    arv_camera_start_acquisition(camera.get(), &error);
+    if(error) {
+        std::cerr << "Error: Failed to start acquisition!" << std::endl;
+        return 1;
+    }
+    std::cout << "Acquisition started..." << std::endl;
+
+    const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 0; i < frames; i++) {
+        auto* buffer = arv_stream_timeout_pop_buffer(stream.get(), 5000000);
+        if (!ARV_IS_BUFFER (buffer)) {
+            std::cerr << "Error: No buffer received!" << std::endl;
+            break;
+        }
+
+        if (arv_buffer_get_status(buffer) == ARV_BUFFER_STATUS_SUCCESS && views.map(buffer)) {
+            const PartView& range = views.range();
+            const uint32_t centerRow = range.height / 2, centerColumn = range.width / 2;
+            const Vec3D before = range.row<Vec3D>(centerRow)[centerColumn];
+
+            const auto start = std::chrono::steady_clock::now();
+            if (compensateMotion(range, views.event(), velocity, threads)) {
+                const double ms =
+                        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                const Vec3D& after = range.row<Vec3D>(centerRow)[centerColumn];
+                std::cout << "Frame " << i << " center point [" << before.x << ", " << before.y << ", " << before.z
+                          << "] -> [" << after.x << ", " << after.y << ", " << after.z << "], event time "
+                          << views.event().row<float>(centerRow)[centerColumn] << " ms, compensated in " << ms
+                          << " ms" << std::endl;
+            }
+        }
+
+        arv_stream_push_buffer (stream.get(), buffer);
+    }
+
+    arv_camera_stop_acquisition(camera.get(), &error);
+    if(error) {
+        std::cerr << "Error: " << error->message << std::endl;
+        return 1;
+    }
+    std::cout << "Acquisition stopped..." << std::endl;
+
+    return 0;
+}
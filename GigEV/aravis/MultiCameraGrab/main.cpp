@@ -0,0 +1,99 @@
+/* SPDX-License-Identifier:Unlicense */
+
+#include "common/PhoAravisCommon.h"
+#include "common/MultiCameraGrabber.h"
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using namespace pho;
+
+/* Shared consumer of the tagged frames of all cameras, called concurrently from the receive threads */
+class FrameConsumer {
+public:
+    explicit FrameConsumer(size_t cameras) : _lastFrameId(cameras, 0), _frames(cameras, 0) {}
+
+    void onFrame(unsigned camera, ArvBuffer* buffer) {
+        const guint64 frameId = arv_buffer_get_frame_id(buffer);
+        std::lock_guard<std::mutex> lock(_mutex);
+        _lastFrameId[camera] = frameId;
+        ++_frames[camera];
+    }
+
+    void print(std::ostream& out) const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        out << "  Consumed:";
+        for (size_t i = 0; i < _frames.size(); ++i) {
+            out << " [" << i << "] " << _frames[i] << " frames (last ID " << _lastFrameId[i] << ")";
+        }
+        out << std::endl;
+    }
+
+private:
+    mutable std::mutex _mutex;
+    std::vector<guint64> _lastFrameId;
+    std::vector<uint64_t> _frames;
+};
+
+/*
+ * Connects to several cameras and acquires in freerun from all of them at once. Each camera has its own stream,
+ * buffer pool and receive thread, optionally pinned to a CPU ("<device IP>@<cpu>"). The frames of all cameras go to
+ * one consumer, per-camera and aggregate throughput and drops are printed every second.
+ *
+ * Works against several aravis fake GigE Vision cameras as well, no sensor needed:
+ *     arv-fake-gv-camera-0.8 -i 127.0.0.2 & arv-fake-gv-camera-0.8 -i 127.0.0.3 &
+ *     MultiCameraGrab 127.0.0.2@1 127.0.0.3@2
+ *
+ * Usage: MultiCameraGrab <device IP>[@cpu] [<device IP>[@cpu] ...] [seconds]
+ */
+int main (int argc, char **argv)
+{
+    if(argc < 2) {
+        std::cerr << "Provide device IPs as parameters!" << std::endl;
+        return 1;
+    }
+
+    std::vector<CameraSource> sources;
+    int seconds = 10;
+    for(int i = 1; i < argc; ++i) {
+        const std::string argument = argv[i];
+        if(argument.find('.') == std::string::npos && argument.find('@') == std::string::npos) {
+            seconds = std::max(1, std::stoi(argument));
+            continue;
+        }
+        const size_t at = argument.find('@');
+        sources.push_back({argument.substr(0, at), at == std::string::npos ? -1 : std::stoi(argument.substr(at + 1))});
+    }
+
+    MultiCameraGrabber grabber;
+    if(!grabber.open(sources)) {
+        return 1;
+    }
+
+    for(unsigned i = 0; i < grabber.size(); ++i) {
+        std::cout << "Connected to camera [" << i << "]: " << arv_camera_get_model_name (grabber.camera(i), nullptr)
+                  << " at " << sources[i].deviceIp << std::endl;
+        if(!setTriggerMode(grabber.camera(i), TriggerMode::Freerun)) {
+            return 1;
+        }
+    }
+
+    ///-----------------------------------------------------------------------------------------------------------------
+
+    FrameConsumer consumer(grabber.size());
+    if(!grabber.start([&consumer](unsigned camera, ArvBuffer* buffer) { consumer.onFrame(camera, buffer); })) {
+        return 1;
+    }
+
+    for(int i = 0; i < seconds; ++i) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        std::cout << "After " << i + 1 << " s:" << std::endl;
+        grabber.print(std::cout);
+    }
+
+    grabber.stop();
+    consumer.print(std::cout);
+    return 0;
+}
@@ -0,0 +1,179 @@
+/* SPDX-License-Identifier:Unlicense */
+
+#include "common/PhoAravisCommon.h"
+#include "common/RecipeSwitcher.h"
+#include "common/StreamStatistics.h"
+
+#include <functional>
+#include <string>
+
+using namespace pho;
+
+using Clock = std::chrono::steady_clock;
+
+static uint64_t elapsedUs(Clock::time_point since) {
+    return uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - since).count());
+}
+
+/* Triggers a frame and waits for the first complete buffer, the failed ones are returned to the stream */
+bool waitForValidFrame(ArvCamera* camera, ArvStream* stream, size_t& failed) {
+    if (!triggerFrame(camera)) {
+        return false;
+    }
+    while (auto* buffer = arv_stream_timeout_pop_buffer(stream, 5000000)) {
+        const bool success = arv_buffer_get_status(buffer) == ARV_BUFFER_STATUS_SUCCESS;
+        arv_stream_push_buffer(stream, buffer);
+        if (success) {
+            return true;
+        }
+        ++failed;
+    }
+    std::cerr << "Error: No buffer received!" << std::endl;
+    return false;
+}
+
+struct Measurement {
+    LatencyHistogram switchUs;
+    LatencyHistogram firstFrameUs;
+    size_t failedFrames = 0;
+
+    void print(const char* name) const {
+        std::cout << std::left << std::setw(24) << name << std::right
+                  << " switch p50 " << std::setw(8) << switchUs.percentile(50) / 1000.0 << " ms, p95 "
+                  << std::setw(8) << switchUs.percentile(95) / 1000.0 << " ms | first valid frame p50 "
+                  << std::setw(8) << firstFrameUs.percentile(50) / 1000.0 << " ms, p95 "
+                  << std::setw(8) << firstFrameUs.percentile(95) / 1000.0 << " ms | " << failedFrames
+                  << " failed frames" << std::endl;
+    }
+};
+
+/* `doSwitch(i)` changes the recipe of the running acquisition, the latency ends with the first valid frame */
+bool measure(ArvCamera* camera, ArvStream* stream, int cycles, const std::function<bool(int)>& doSwitch,
+             Measurement& measurement) {
+    for (int i = 0; i < cycles; ++i) {
+        const auto start = Clock::now();
+        if (!doSwitch(i)) {
+            return false;
+        }
+        measurement.switchUs.record(elapsedUs(start));
+        if (!waitForValidFrame(camera, stream, measurement.failedFrames)) {
+            return false;
+        }
+        measurement.firstFrameUs.record(elapsedUs(start));
+    }
+    return true;
+}
+
+/*
+ * Stores a Camera mode and a Scanner mode recipe in UserSet0 and UserSet1, then alternates between them while
+ * the stream stays configured and reports the switch-to-first-valid-frame latency of:
+ *   - no switch (the frame time alone, for reference),
+ *   - writing the recipe features one by one (DeviceConfigurator, only the differences are written),
+ *   - loading the pre-stored UserSet (RecipeSwitcher).
+ * The UserSets are overwritten.
+ *
+ * Usage: RecipeSwitching <device IP> [cycles]
+ */
+int main (int argc, char **argv)
+{
+    if(argc < 2) {
+        std::cerr << "Provide device IP as a parameter!" << std::endl;
+        return 1;
+    }
+
+    const char* deviceIp = argv[1];
+    const int cycles = argc >= 3 ? std::max(1, std::stoi(argv[2])) : 20;
+
+    GError *error = nullptr;
+
+    /* Connect to the camera */
+    auto camera = create_gobject_unique(arv_camera_new (deviceIp, &error));
+    if(error) {
+        std::cerr << "Error: " << error->message << std::endl;
+        return 1;
+    }
+
+    if(!ARV_IS_CAMERA(camera.get())) {
+        std::cerr << "Error: Not a camera instance!";
+        return 1;
+    }
+
+    std::cout << "Connected to camera: " << arv_camera_get_model_name (camera.get(), nullptr) << std::endl;
+
+    auto stream = create_gobject_unique(arv_camera_create_stream (camera.get(), nullptr, nullptr, &error));
+    if(error || !ARV_IS_STREAM(stream.get())) {
+        std::cerr << "Error: Failed to create stream!" << std::endl;
+        return 1;
+    }
+
+    arv_camera_gv_set_packet_size_adjustment (camera.get(), ARV_GV_PACKET_SIZE_ADJUSTMENT_ALWAYS);
+
+    /* Both recipes share the stream setup and differ in the capturing settings */
+    DeviceConfig common;
+    common.triggerMode = TriggerMode::SWTrigger;
+    common.components = {{Intensity, true}, {Range, true}, {Normal, false}, {Confidence, false}, {Event, false},
+                         {ColorCameraImage, false}, {CoordinateMapA, false}, {CoordinateMapB, false}};
+    common.outputFormat = StreamOutputFormat::MultipartData;
+
+    Recipe recipes[2] = {{"UserSet0", "Camera mode recipe", common}, {"UserSet1", "Scanner mode recipe", common}};
+    recipes[0].config.features = {{"OperationMode", "Camera"}, {"CameraExposure", "30.72"}};
+    recipes[1].config.features = {{"OperationMode", "Scanner"}, {"CameraExposure", "40.96"}};
+
+    RecipeSwitcher switcher(camera.get(), stream.get());
+    guint largestPayload = 0;
+    for (const auto& recipe : recipes) {
+        if(!switcher.store(recipe)) {
+            std::cerr << "Error: Failed to store " << recipe.description << " in " << recipe.userSet << std::endl;
+            return 1;
+        }
+        largestPayload = std::max(largestPayload, switcher.payload());
+        std::cout << "Stored " << recipe.description << " in " << recipe.userSet << ", payload "
+                  << switcher.payload() << " bytes" << std::endl;
+    }
+
+    /* Buffers for the largest recipe, no recipe ever needs new ones */
+    switcher.setBufferSize(largestPayload);
+    for (int i = 0; i < 4; i++) {
+        arv_stream_push_buffer(stream.get(), arv_buffer_new(largestPayload, nullptr));
+    }
+
+    arv_camera_start_acquisition(camera.get(), &error);
+    if(error) {
+        std::cerr << "Error: Failed to start acquisition!" << std::endl;
+        return 1;
+    }
+
+    Measurement reference;
+    Measurement featureWrites;
+    Measurement userSetLoad;
+    DeviceConfigurator configurator(camera.get());
+    SwitchReport report;
+    double loadMs = 0.0;
+
+    const bool ok =
+            measure(camera.get(), stream.get(), cycles, [](int) { return true; }, reference)
+            && measure(camera.get(), stream.get(), cycles, [&](int i) {
+                   /* Capturing settings cannot change while acquiring either */
+                   arv_camera_stop_acquisition(camera.get(), nullptr);
+                   const bool applied = configurator.apply(recipes[(i + 1) % 2].config);
+                   arv_camera_start_acquisition(camera.get(), nullptr);
+                   return applied;
+               }, featureWrites)
+            && measure(camera.get(), stream.get(), cycles, [&](int i) {
+                   const bool switched = switcher.switchTo(recipes[i % 2].userSet, true, &report);
+                   loadMs += report.loadMs;
+                   return switched && !report.buffersTooSmall;
+               }, userSetLoad);
+
+    arv_camera_stop_acquisition(camera.get(), nullptr);
+    if (!ok) {
+        return 1;
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    reference.print("No switch");
+    featureWrites.print("Feature writes");
+    userSetLoad.print("UserSetLoad");
+    std::cout << "Average UserSetLoad: " << loadMs / cycles << " ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,191 @@
+/* SPDX-License-Identifier:Unlicense */
+
+#include "common/PhoAravisCommon.h"
+#include "common/CalculateNormals.h"
+#include "common/MultipartRecording.h"
+
+#include <chrono>
+#include <string>
+
+using namespace pho;
+
+/* The processing, identical for live and replayed frames */
+class FrameProcessor {
+public:
+    void operator()(const MultipartViews& views, const FrameInfo& info) {
+        const PartView& normal = views.normal();
+        /* Coord3D_AC8 is two bytes per pixel */
+        if (normal && ARV_PIXEL_FORMAT_BIT_PER_PIXEL(normal.pixelFormat) == 16) {
+            _normals.resize(size_t(normal.width) * normal.height);
+            calculateNormals(normal.as<NormalsAngles>(), normal.width, normal.height, _normals.data());
+        }
+
+        for (OutputMat component : MultipartViews::components) {
+            _bytes += views.view(component).size;
+        }
+        ++_frames;
+
+        if (_verbose) {
+            std::cout << "Frame " << info.frameId << " timestamp: " << info.timestampNs << " ns, intensity: "
+                      << views.intensity().width << "x" << views.intensity().height << ", range: "
+                      << views.range().width << "x" << views.range().height << std::endl;
+        }
+    }
+
+    void setVerbose(bool verbose) { _verbose = verbose; }
+    uint64_t frames() const { return _frames; }
+    uint64_t bytes() const { return _bytes; }
+
+private:
+    std::vector<Vec3D> _normals;
+    uint64_t _frames = 0;
+    uint64_t _bytes = 0;
+    bool _verbose = true;
+};
+
+int record(const char* deviceIp, const std::string& path, int frameCount) {
+    GError *error = nullptr;
+
+    /* Connect to the first available camera */
+    auto camera = create_gobject_unique(arv_camera_new (deviceIp, &error));
+    if(error) {
+        std::cerr << "Error: " << error->message << std::endl;
+        return 1;
+    }
+
+    if(!ARV_IS_CAMERA(camera.get())) {
+        std::cerr << "Error: Not a camera instance!";
+        return 1;
+    }
+
+    std::cerr << "Connected to camera: " << arv_camera_get_model_name (camera.get(), nullptr) << std::endl;
+
+    if(!setTriggerMode(camera.get(), TriggerMode::Freerun)) {
+        return 1;
+    }
+
+    arv_camera_gv_set_packet_size_adjustment (camera.get(), ARV_GV_PACKET_SIZE_ADJUSTMENT_ALWAYS);
+
+    /* The components are recorded as the device sends them, keep the device configuration */
+    if(!setStreamOutputFormat(camera.get(), StreamOutputFormat::MultipartData)) {
+        return 1;
+    }
+
+    MultipartViews views;
+    if(!views.configure(camera.get())) {
+        std::cerr << "Error: Failed to read enabled components!" << std::endl;
+        return 1;
+    }
+
+    MultipartRecorder recorder;
+    if(!recorder.open(path, views)) {
+        return 1;
+    }
+
+    auto stream = create_gobject_unique(arv_camera_create_stream (camera.get(), nullptr, nullptr, &error));
+    if(error || !ARV_IS_STREAM(stream.get())) {
+        std::cerr << "Error: Failed to create stream!" << std::endl;
+        return 1;
+    }
+
+    size_t payload = arv_camera_get_payload (camera.get(), &error);
+    if(error) {
+        std::cerr << "Error: Failed to obtain payload size!" << std::endl;
+        return 1;
+    }
+
+    for (int i = 0; i < 10; i++) {
+        arv_stream_push_buffer(stream.get(), arv_buffer_new(payload, nullptr));
+    }
+
+    arv_camera_start_acquisition(camera.get(), &error);
+    if(error) {
+        std::cerr << "Error: Failed to start acquisition!" << std::endl;
+        return 1;
+    }
+    std::cout << "Recording " << frameCount << " frames to " << path << "..." << std::endl;
+
+    /* The live path runs the same processing as the replay */
+    FrameProcessor processor;
+    bool failed = false;
+    while (recorder.frameCount() < size_t(frameCount)) {
+        auto* buffer = arv_stream_timeout_pop_buffer(stream.get(), 5000000);
+        if (!ARV_IS_BUFFER (buffer)) {
+            std::cerr << "Error: No buffer received!" << std::endl;
+            break;
+        }
+
+        if (recorder.append(buffer) && views.map(buffer)) {
+            processor(views, frameInfo(buffer));
+        }
+        arv_stream_push_buffer (stream.get(), buffer);
+
+        /* Closed by a write error */
+        if (!recorder.isOpen()) {
+            failed = true;
+            break;
+        }
+    }
+
+    arv_camera_stop_acquisition(camera.get(), &error);
+    if(error) {
+        std::cerr << "Error: " << error->message << std::endl;
+        return 1;
+    }
+    failed = !recorder.close() || failed;
+
+    std::cout << "Recorded " << recorder.frameCount() << " frames, " << recorder.bytesWritten() / (1024 * 1024)
+              << " MiB" << std::endl;
+    return failed ? 1 : 0;
+}
+
+int replay(const std::string& path, MultipartReplayer::Speed speed, size_t loops) {
+    MultipartReplayer replayer;
+    if (!replayer.open(path)) {
+        return 1;
+    }
+    std::cout << "Replaying " << replayer.frameCount() << " frames from " << path << "..." << std::endl;
+
+    FrameProcessor processor;
+    processor.setVerbose(loops == 1);
+
+    const auto start = std::chrono::steady_clock::now();
+    replayer.play(std::ref(processor), speed, loops);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Replayed " << processor.frames() << " frames in " << seconds << " s ("
+              << processor.frames() / seconds << " fps, " << processor.bytes() / seconds / 1e6 << " MB/s)" << std::endl;
+    return 0;
+}
+
+/*
+ * Records the multipart buffers sent by a device into a file and replays them later without the device, through
+ * the same frame handler used for live buffers. Replay is either real-time (device timestamp spacing) or as fast
+ * as possible, which makes recordings usable for processing benchmarks.
+ *
+ * Usage: RecordAndReplay record <device IP> <file> [frames]
+ *        RecordAndReplay replay <file> [--realtime] [loops]
+ */
+int main (int argc, char **argv)
+{
+    const std::string mode = argc >= 2 ? argv[1] : "";
+    if (mode == "record" && argc >= 4) {
+        return record(argv[2], argv[3], argc >= 5 ? std::max(1, std::stoi(argv[4])) : 10);
+    }
+    if (mode == "replay" && argc >= 3) {
+        auto speed = MultipartReplayer::Speed::Maximum;
+        size_t loops = 1;
+        for (int i = 3; i < argc; ++i) {
+            if (std::string(argv[i]) == "--realtime") {
+                speed = MultipartReplayer::Speed::RealTime;
+            } else {
+                loops = std::max(1, std::stoi(argv[i]));
+            }
+        }
+        return replay(argv[2], speed, loops);
+    }
+
+    std::cerr << "Usage: " << argv[0] << " record <device IP> <file> [frames]" << std::endl
+              << "       " << argv[0] << " replay <file> [--realtime] [loops]" << std::endl;
+    return 1;
+}
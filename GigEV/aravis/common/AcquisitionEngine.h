@@ -0,0 +1,311 @@
+#ifndef PHOTONEOMAIN_ACQUISITIONENGINE_H
+#define PHOTONEOMAIN_ACQUISITIONENGINE_H
+
+#include "BufferArena.h"
+#include "PhoAravisCommon.h"
+#include "SpscRing.h"
+#include "StreamStatistics.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace pho {
+
+/**
+ * Callback driven acquisition: receives buffers in the stream's `new-buffer` signal and hands them to a pool of
+ * worker threads, so processing never delays buffer reception.
+ *
+ * The stream thread is the only producer. Each worker has its own bounded single-producer / single-consumer ring
+ * and buffers are distributed round robin. When all rings are full, the buffer is returned to the stream right
+ * away and counted as dropped, the same happens to incomplete buffers. A worker returns each buffer to the stream
+ * as soon as the handler returns, so the handler must not keep pointers into the buffer.
+ *
+ *     AcquisitionEngine engine(4);
+ *     engine.start(camera, 16, [](ArvBuffer* buffer, unsigned worker) { ... });
+ *     ...
+ *     engine.stop();
+ */
+class AcquisitionEngine {
+public:
+    using Handler = std::function<void(ArvBuffer* buffer, unsigned worker)>;
+
+    struct Statistics {
+        uint64_t received = 0;  // buffers delivered by the stream
+        uint64_t processed = 0; // buffers handled by a worker and returned to the stream
+        uint64_t dropped = 0;   // returned unprocessed because all worker queues were full
+        uint64_t failed = 0;    // returned unprocessed because the buffer status was not success
+        size_t queueDepth = 0;  // buffers currently waiting in the worker queues
+        size_t maxQueueDepth = 0;
+    };
+
+    explicit AcquisitionEngine(unsigned workers = 1, size_t queueCapacity = 4)
+            : _workerCount(std::max(1u, workers)), _queueCapacity(std::max<size_t>(1, queueCapacity)) {}
+
+    ~AcquisitionEngine() { stop(); }
+
+    AcquisitionEngine(const AcquisitionEngine&) = delete;
+    AcquisitionEngine& operator=(const AcquisitionEngine&) = delete;
+
+    /*
+     * Creates the stream with `bufferCount` buffers of the current payload size (in one pre-faulted BufferArena),
+     * starts the workers and the acquisition. Configure the device (components, pixel formats, trigger) before
+     * calling this.
+     */
+    bool start(ArvCamera* camera, size_t bufferCount, Handler handler);
+
+    /* Stops the acquisition, lets the workers finish the queued buffers and destroys the stream */
+    void stop();
+
+    Statistics statistics() const;
+
+    /*
+     * Optional per-frame instrumentation: every received buffer is reported as dequeued in the stream callback
+     * and as released when it goes back to the stream. Set before start(), `streamStatistics` must outlive the
+     * acquisition.
+     */
+    void setStreamStatistics(StreamStatistics* streamStatistics) { _streamStatistics = streamStatistics; }
+
+    ArvStream* stream() const { return _stream.get(); }
+    const BufferArena& bufferArena() const { return _arena; }
+
+private:
+    struct Worker {
+        explicit Worker(size_t queueCapacity) : queue(queueCapacity) {}
+
+        SpscRing<ArvBuffer*> queue;
+        std::thread thread;
+        std::mutex mutex; // only used to sleep / wake up, the hand-off itself is lock-free
+        std::condition_variable wakeUp;
+        std::atomic<bool> sleeping{false};
+    };
+
+    static void onNewBuffer(ArvStream* stream, gpointer userData);
+    void dispatch(ArvBuffer* buffer);
+    void workerLoop(unsigned index);
+    void release(ArvBuffer* buffer);
+    size_t queueDepth() const;
+
+    unsigned _workerCount;
+    size_t _queueCapacity;
+    Handler _handler;
+    StreamStatistics* _streamStatistics = nullptr;
+    ArvCamera* _camera = nullptr;
+    BufferArena _arena; // outlives the stream
+    std::unique_ptr<ArvStream, void (*)(ArvStream*)> _stream{nullptr, gobject_destroyer<ArvStream>};
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::atomic<bool> _running{false};
+    std::atomic<bool> _dispatching{false};        // stream callbacks may hand buffers to the workers
+    std::atomic<unsigned> _callbacksInFlight{0};
+    unsigned _nextWorker = 0; // producer only
+
+    std::atomic<uint64_t> _received{0};
+    std::atomic<uint64_t> _processed{0};
+    std::atomic<uint64_t> _dropped{0};
+    std::atomic<uint64_t> _failed{0};
+    std::atomic<size_t> _maxQueueDepth{0};
+};
+
+inline bool AcquisitionEngine::start(ArvCamera* camera, size_t bufferCount, Handler handler) {
+    if (!camera || _running) {
+        return false;
+    }
+
+    GError* error = nullptr;
+    const size_t payload = arv_camera_get_payload(camera, &error);
+    if (error) {
+        std::cerr << "Error: Failed to obtain payload size: " << error->message << std::endl;
+        g_clear_error(&error);
+        return false;
+    }
+
+    _stream.reset(arv_camera_create_stream(camera, nullptr, nullptr, &error));
+    if (error || !ARV_IS_STREAM(_stream.get())) {
+        std::cerr << "Error: Failed to create stream: " << (error ? error->message : "") << std::endl;
+        g_clear_error(&error);
+        _stream.reset();
+        return false;
+    }
+
+    if (!_arena.allocate(payload, bufferCount)) {
+        _stream.reset();
+        return false;
+    }
+    _arena.pushBuffers(_stream.get());
+
+    _camera = camera;
+    _handler = std::move(handler);
+    _received = _processed = _dropped = _failed = 0;
+    _maxQueueDepth = 0;
+    _nextWorker = 0;
+    _running = true;
+    _workers.clear();
+    for (unsigned i = 0; i < _workerCount; ++i) {
+        _workers.push_back(std::make_unique<Worker>(_queueCapacity));
+    }
+    for (unsigned i = 0; i < _workerCount; ++i) {
+        _workers[i]->thread = std::thread(&AcquisitionEngine::workerLoop, this, i);
+    }
+
+    _dispatching = true;
+    g_signal_connect(_stream.get(), "new-buffer", G_CALLBACK(&AcquisitionEngine::onNewBuffer), this);
+    arv_stream_set_emit_signals(_stream.get(), TRUE);
+
+    arv_camera_start_acquisition(camera, &error);
+    if (error) {
+        std::cerr << "Error: Failed to start acquisition: " << error->message << std::endl;
+        g_clear_error(&error);
+        stop();
+        return false;
+    }
+
+    return true;
+}
+
+inline void AcquisitionEngine::stop() {
+    if (!_stream) {
+        return;
+    }
+
+    arv_stream_set_emit_signals(_stream.get(), FALSE);
+    arv_camera_stop_acquisition(_camera, nullptr);
+    g_signal_handlers_disconnect_by_data(_stream.get(), this);
+
+    /*
+     * Disconnecting does not wait for a callback already running on the stream thread. Stop the dispatching and
+     * wait for such a callback before the workers go away.
+     */
+    _dispatching = false;
+    while (_callbacksInFlight.load() != 0) {
+        std::this_thread::yield();
+    }
+
+    _running = false;
+    for (auto& worker : _workers) {
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+        }
+        worker->wakeUp.notify_one();
+    }
+    for (auto& worker : _workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+
+    _workers.clear();
+    /* Joins the stream thread, a callback entered after the wait above finds _dispatching false */
+    _stream.reset();
+    _camera = nullptr;
+}
+
+inline AcquisitionEngine::Statistics AcquisitionEngine::statistics() const {
+    Statistics statistics;
+    statistics.received = _received;
+    statistics.processed = _processed;
+    statistics.dropped = _dropped;
+    statistics.failed = _failed;
+    statistics.queueDepth = queueDepth();
+    statistics.maxQueueDepth = _maxQueueDepth;
+    return statistics;
+}
+
+inline void AcquisitionEngine::onNewBuffer(ArvStream* stream, gpointer userData) {
+    auto* engine = static_cast<AcquisitionEngine*>(userData);
+    engine->_callbacksInFlight.fetch_add(1);
+    ArvBuffer* buffer = arv_stream_try_pop_buffer(stream);
+    if (buffer) {
+        if (engine->_dispatching.load()) {
+            engine->dispatch(buffer);
+        } else {
+            /* Stopping, the workers may be gone */
+            arv_stream_push_buffer(stream, buffer);
+        }
+    }
+    engine->_callbacksInFlight.fetch_sub(1);
+}
+
+inline void AcquisitionEngine::dispatch(ArvBuffer* buffer) {
+    _received.fetch_add(1, std::memory_order_relaxed);
+    if (_streamStatistics) {
+        _streamStatistics->onDequeued(buffer);
+    }
+
+    if (arv_buffer_get_status(buffer) != ARV_BUFFER_STATUS_SUCCESS) {
+        _failed.fetch_add(1, std::memory_order_relaxed);
+        release(buffer);
+        return;
+    }
+
+    for (unsigned attempt = 0; attempt < _workerCount; ++attempt) {
+        Worker& worker = *_workers[_nextWorker];
+        _nextWorker = (_nextWorker + 1) % _workerCount;
+        if (!worker.queue.tryPush(buffer)) {
+            continue;
+        }
+
+        const size_t depth = queueDepth();
+        if (depth > _maxQueueDepth.load(std::memory_order_relaxed)) {
+            _maxQueueDepth.store(depth, std::memory_order_relaxed);
+        }
+
+        // Pairs with the fence in workerLoop: either the worker sees the buffer or we see it sleeping
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (worker.sleeping.load(std::memory_order_relaxed)) {
+            {
+                std::lock_guard<std::mutex> lock(worker.mutex);
+            }
+            worker.wakeUp.notify_one();
+        }
+        return;
+    }
+
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+    release(buffer);
+}
+
+inline void AcquisitionEngine::workerLoop(unsigned index) {
+    Worker& worker = *_workers[index];
+    while (true) {
+        ArvBuffer* buffer = nullptr;
+        if (worker.queue.tryPop(buffer)) {
+            if (_handler) {
+                _handler(buffer, index);
+            }
+            release(buffer);
+            _processed.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        if (!_running) {
+            break;
+        }
+
+        std::unique_lock<std::mutex> lock(worker.mutex);
+        worker.sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        worker.wakeUp.wait(lock, [&]() { return !worker.queue.empty() || !_running; });
+        worker.sleeping.store(false, std::memory_order_relaxed);
+    }
+}
+
+inline void AcquisitionEngine::release(ArvBuffer* buffer) {
+    if (_streamStatistics) {
+        _streamStatistics->onReleased(buffer);
+    }
+    arv_stream_push_buffer(_stream.get(), buffer);
+}
+
+inline size_t AcquisitionEngine::queueDepth() const {
+    size_t depth = 0;
+    for (const auto& worker : _workers) {
+        depth += worker->queue.size();
+    }
+    return depth;
+}
+
+}  // namespace pho
+
+#endif  // PHOTONEOMAIN_ACQUISITIONENGINE_H
@@ -0,0 +1,268 @@
+#ifndef PHOTONEOMAIN_ADAPTIVEBUFFERPOOL_H
+#define PHOTONEOMAIN_ADAPTIVEBUFFERPOOL_H
+
+#include "PhoAravisCommon.h"
+#include "StreamStatistics.h"
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <mutex>
+
+namespace pho {
+
+/**
+ * Stream buffer pool sized from the observed traffic instead of a fixed buffer count: enough buffers to absorb
+ * the processing jitter, no more than the memory budget allows.
+ *
+ * A buffer is unavailable to aravis from the first packet of its frame (aravis takes the buffer and the system
+ * timestamp when the leader arrives) until the application pushes it back, so the pool needs about
+ * `frame rate * p99 occupancy` buffers plus one for the next frame (Little's law). The occupancy includes the
+ * transfer of the frame. Every
+ * `evaluationPeriod` the pool compares this estimate and the stream's underrun counter (frames dropped because no
+ * buffer was free) with its current size:
+ *  - underruns:  grows by half at once, at least to the estimate,
+ *  - estimate above the size: grows to the estimate,
+ *  - estimate at least two below the size for `shrinkAfter` periods in a row: shrinks by one buffer.
+ * The size stays between `minBuffers` and memoryBudget / payload. Every change is logged as a Decision.
+ *
+ * New buffers are pushed to the stream right away, surplus buffers are destroyed when they are released, so the
+ * memory is returned to the system. Buffers are heap allocated one by one for that reason, a fixed size pool can
+ * use a pre-faulted BufferArena instead.
+ *
+ *     AdaptiveBufferPool pool;
+ *     pool.start(stream, payload);
+ *     ...
+ *     buffer = arv_stream_pop_buffer(stream);
+ *     ...
+ *     pool.release(buffer);       // instead of arv_stream_push_buffer()
+ *
+ * release() is thread-safe. The pool must not outlive the stream.
+ */
+class AdaptiveBufferPool {
+public:
+    struct Config {
+        size_t memoryBudget = size_t(512) << 20; // bytes for all buffers of the stream
+        size_t minBuffers = 2;
+        size_t initialBuffers = 4;
+        size_t spareBuffers = 1;                 // on top of the estimate
+        double occupancyPercentile = 99.0;
+        std::chrono::milliseconds evaluationPeriod{1000};
+        unsigned shrinkAfter = 5;                // periods with a lower estimate before dropping a buffer
+        size_t window = 256;                     // occupancy samples
+    };
+
+    enum class Reason { Initial, Underruns, Latency, Idle };
+
+    struct Decision {
+        double timeS = 0.0;           // since start()
+        size_t from = 0;
+        size_t to = 0;
+        Reason reason = Reason::Initial;
+        double frameRate = 0.0;       // frames per second arriving at the host, including the dropped ones
+        uint64_t occupancyUs = 0;     // percentile of first packet to release
+        uint64_t underruns = 0;       // in the evaluated period
+        bool budgetLimited = false;   // the wanted size did not fit the memory budget
+    };
+
+    AdaptiveBufferPool() : AdaptiveBufferPool(Config()) {}
+    explicit AdaptiveBufferPool(const Config& config) : _config(config), _occupancy(config.window) {}
+
+    AdaptiveBufferPool(const AdaptiveBufferPool&) = delete;
+    AdaptiveBufferPool& operator=(const AdaptiveBufferPool&) = delete;
+
+    /* Pushes the initial buffers of `payload` bytes, returns false if not even minBuffers fit the budget */
+    bool start(ArvStream* stream, size_t payload);
+
+    /* Returns a popped buffer to the stream, or destroys it if the pool is shrinking. Evaluates periodically. */
+    void release(ArvBuffer* buffer);
+
+    /* Wanted number of buffers */
+    size_t target() const;
+    /* Buffers currently existing (in the stream or held by the application) */
+    size_t allocated() const;
+    size_t maxBuffers() const { return _maxBuffers; }
+    size_t bytes() const { return allocated() * _payload; }
+
+    std::vector<Decision> decisions() const;
+
+    void print(std::ostream& out) const;
+
+    static const char* reasonName(Reason reason);
+
+private:
+    void evaluate(std::chrono::steady_clock::time_point now);
+    void grow();
+
+    Config _config;
+    ArvStream* _stream = nullptr;
+    size_t _payload = 0;
+    size_t _maxBuffers = 0;
+
+    mutable std::mutex _mutex;
+    size_t _target = 0;
+    size_t _allocated = 0;
+    LatencyHistogram _occupancy;
+    uint64_t _released = 0;       // in the current period
+    uint64_t _lastUnderruns = 0;
+    unsigned _quietPeriods = 0;
+    std::chrono::steady_clock::time_point _startTime;
+    std::chrono::steady_clock::time_point _periodStart;
+    std::vector<Decision> _decisions;
+};
+
+inline bool AdaptiveBufferPool::start(ArvStream* stream, size_t payload) {
+    if (!stream || payload == 0) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _maxBuffers = _config.memoryBudget / payload;
+    if (_maxBuffers < std::max<size_t>(1, _config.minBuffers)) {
+        std::cerr << "Error: A memory budget of " << _config.memoryBudget << " bytes does not fit "
+                  << _config.minBuffers << " buffers of " << payload << " bytes!" << std::endl;
+        return false;
+    }
+
+    _stream = stream;
+    _payload = payload;
+    _allocated = 0;
+    _target = std::min(std::max(_config.initialBuffers, _config.minBuffers), _maxBuffers);
+    _occupancy.clear();
+    _released = 0;
+    _quietPeriods = 0;
+    _startTime = _periodStart = std::chrono::steady_clock::now();
+    _lastUnderruns = StreamStatistics::transport(stream).underruns;
+
+    Decision decision;
+    decision.to = _target;
+    decision.budgetLimited = _target < _config.initialBuffers;
+    _decisions.assign(1, decision);
+    grow();
+    return true;
+}
+
+inline void AdaptiveBufferPool::release(ArvBuffer* buffer) {
+    if (!buffer) {
+        return;
+    }
+
+    /* Occupancy: from the first packet of the frame (aravis system timestamp) until now */
+    const guint64 firstPacketNs = arv_buffer_get_system_timestamp(buffer);
+    const int64_t nowNs = g_get_real_time() * 1000;
+    const auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (firstPacketNs != 0) {
+        _occupancy.record(uint64_t(std::max<int64_t>(0, nowNs - int64_t(firstPacketNs))) / 1000);
+    }
+    ++_released;
+
+    if (_allocated > _target) {
+        --_allocated;
+        g_object_unref(buffer);
+    } else {
+        arv_stream_push_buffer(_stream, buffer);
+    }
+
+    if (now - _periodStart >= _config.evaluationPeriod) {
+        evaluate(now);
+    }
+}
+
+inline size_t AdaptiveBufferPool::target() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _target;
+}
+
+inline size_t AdaptiveBufferPool::allocated() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _allocated;
+}
+
+inline std::vector<AdaptiveBufferPool::Decision> AdaptiveBufferPool::decisions() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _decisions;
+}
+
+inline void AdaptiveBufferPool::evaluate(std::chrono::steady_clock::time_point now) {
+    const double periodS = std::chrono::duration<double>(now - _periodStart).count();
+    const uint64_t underruns = StreamStatistics::transport(_stream).underruns;
+    const uint64_t newUnderruns = underruns - std::min(underruns, _lastUnderruns);
+
+    Decision decision;
+    decision.timeS = std::chrono::duration<double>(now - _startTime).count();
+    decision.from = _target;
+    decision.frameRate = double(_released + newUnderruns) / periodS;
+    decision.occupancyUs = _occupancy.percentile(_config.occupancyPercentile);
+    decision.underruns = newUnderruns;
+
+    const size_t estimate = std::max(_config.minBuffers,
+                                     size_t(std::ceil(decision.frameRate * double(decision.occupancyUs) / 1e6)) + 1
+                                             + _config.spareBuffers);
+    size_t wanted = _target;
+    if (newUnderruns > 0) {
+        decision.reason = Reason::Underruns;
+        wanted = std::max(_target + std::max<size_t>(1, _target / 2), estimate);
+        _quietPeriods = 0;
+    } else if (estimate > _target) {
+        decision.reason = Reason::Latency;
+        wanted = estimate;
+        _quietPeriods = 0;
+    } else if (estimate + 1 < _target) {
+        /* One buffer of hysteresis, the frame rate of a short period is noisy */
+        if (++_quietPeriods >= _config.shrinkAfter) {
+            decision.reason = Reason::Idle;
+            wanted = _target - 1;
+            _quietPeriods = 0;
+        }
+    } else {
+        _quietPeriods = 0;
+    }
+
+    decision.to = std::min(std::max(wanted, _config.minBuffers), _maxBuffers);
+    decision.budgetLimited = wanted > _maxBuffers;
+    if (decision.to != _target) {
+        _target = decision.to;
+        _decisions.push_back(decision);
+        grow();
+    }
+
+    _released = 0;
+    _lastUnderruns = underruns;
+    _periodStart = now;
+}
+
+inline void AdaptiveBufferPool::grow() {
+    for (; _allocated < _target; ++_allocated) {
+        arv_stream_push_buffer(_stream, arv_buffer_new(_payload, nullptr));
+    }
+}
+
+inline void AdaptiveBufferPool::print(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    out << "Buffer pool: " << _allocated << " buffers (target " << _target << ", budget " << _maxBuffers << "), "
+        << _allocated * _payload / 1024 / 1024 << " MiB" << std::endl;
+    for (const Decision& decision : _decisions) {
+        out << "  " << std::fixed << std::setprecision(1) << std::setw(7) << decision.timeS << " s  " << std::setw(3)
+            << decision.from << " -> " << std::setw(3) << decision.to << "  " << std::left << std::setw(9)
+            << reasonName(decision.reason) << std::right << " " << decision.frameRate << " fps, occupancy "
+            << decision.occupancyUs << " us, " << decision.underruns << " underruns"
+            << (decision.budgetLimited ? ", limited by budget" : "") << std::endl;
+    }
+    out << std::defaultfloat;
+}
+
+inline const char* AdaptiveBufferPool::reasonName(Reason reason) {
+    switch (reason) {
+    case Reason::Initial: return "initial";
+    case Reason::Underruns: return "underruns";
+    case Reason::Latency: return "latency";
+    case Reason::Idle: return "idle";
+    default: return "unknown";
+    }
+}
+
+}  // namespace pho
+
+#endif  // PHOTONEOMAIN_ADAPTIVEBUFFERPOOL_H
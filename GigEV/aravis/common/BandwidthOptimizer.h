@@ -0,0 +1,298 @@
+#ifndef PHOTONEOMAIN_BANDWIDTHOPTIMIZER_H
+#define PHOTONEOMAIN_BANDWIDTHOPTIMIZER_H
+
+#include "CalculateNormals.h"
+#include "DeviceConfig.h"
+#include "PhoAravisCommon.h"
+#include "ProjectedC.h"
+#if defined(PHO_HAVE_OPENCV)
+#include "YCoCg.h"
+#endif
+
+#include <string>
+
+namespace pho {
+
+/* What the application consumes, not how it is transported */
+struct ConsumerNeeds {
+    bool points = false;       // XYZ point cloud
+    bool normals = false;      // unit normal vectors
+    bool texture = false;      // grey intensity, as sent by the device
+    bool colorTexture = false; // RGB8 texture, the device must be set to a color texture source (CameraTextureSource)
+    bool confidence = false;
+    bool events = false;
+};
+
+/* Transport formats chosen by BandwidthOptimizer::configure() */
+struct TransportPlan {
+    bool projectedC = false;  // Range as Coord3D_C32f (ProjectedC), else Coord3D_ABC32f (CalibratedABC_Grid)
+    bool normalsAC8 = false;  // Normal as Coord3D_AC8 angles, else Coord3D_ABC32f
+    bool colorYCoCg = false;  // Intensity as Mono16 YCoCg 4:2:0, else RGB8
+    size_t payload = 0;       // bytes per frame as configured
+    size_t fullPayload = 0;   // bytes per frame with the full formats (ABC32f range and normals, RGB8 color)
+
+    size_t savedBytes() const { return fullPayload > payload ? fullPayload - payload : 0; }
+
+    void print(std::ostream& out) const {
+        out << "Transport: Range " << (projectedC ? "ProjectedC (Coord3D_C32f)" : "Coord3D_ABC32f") << ", Normal "
+            << (normalsAC8 ? "Coord3D_AC8" : "Coord3D_ABC32f") << ", color " << (colorYCoCg ? "YCoCg Mono16" : "RGB8")
+            << " | payload " << payload << " bytes, " << savedBytes() << " bytes ("
+            << (fullPayload ? 100 * savedBytes() / fullPayload : 0) << " %) saved per frame" << std::endl;
+    }
+};
+
+/*
+ * One frame in the formats the consumer asked for, decoded on the host where the transport format differs.
+ * The pointers are valid until the next decode() and, where they point into the buffer, until the buffer is pushed
+ * back to the stream.
+ */
+struct DecodedFrame {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    const Vec3D* points = nullptr;
+    const Vec3D* normals = nullptr;
+    const uint8_t* rgb = nullptr; // RGB8, `rgbStride` bytes per row
+    size_t rgbStride = 0;
+    PartView texture;             // Intensity as received
+    PartView confidence;
+    PartView event;
+    size_t transportBytes = 0;    // bytes of the decoded components as received
+    size_t fullBytes = 0;         // bytes of the same components in the full formats
+
+    size_t savedBytes() const { return fullBytes > transportBytes ? fullBytes - transportBytes : 0; }
+};
+
+/**
+ * Selects the smallest transport formats the device supports for the declared consumer needs and decodes them
+ * transparently on the host, so more sensors fit on one link:
+ *  - points:  ProjectedC range (4 instead of 12 bytes per pixel), reconstructed with the cached coordinate maps,
+ *  - normals: Coord3D_AC8 angles (2 instead of 12 bytes per pixel), decoded with calculateNormals(),
+ *  - color:   Mono16 YCoCg 4:2:0 (2 instead of 3 bytes per pixel), decoded with YCoCg::convertToRGB8() (needs
+ *             OpenCV, PHO_HAVE_OPENCV; without it RGB8 is transported).
+ * Components nobody needs are disabled.
+ *
+ *     BandwidthOptimizer optimizer;
+ *     ConsumerNeeds needs;
+ *     needs.points = needs.normals = true;
+ *     optimizer.configure(camera, needs);     // before creating the stream
+ *     views.configure(camera);
+ *     ...
+ *     if (views.map(buffer) && optimizer.decode(views, frame, threads)) {
+ *         use(frame.points, frame.normals);
+ *     }
+ */
+class BandwidthOptimizer {
+public:
+    /*
+     * Configures the device (components, pixel formats, Scan3dOutputMode, multipart output) and prepares the
+     * decoders. The camera must not be acquiring, the ProjectedC coordinate maps may be grabbed with a temporary
+     * stream.
+     */
+    bool configure(ArvCamera* camera, const ConsumerNeeds& needs, TransportPlan* plan = nullptr,
+                   ApplyReport* report = nullptr);
+
+    /* Decodes the mapped views into `frame`, returns false if a needed component is missing or malformed */
+    bool decode(const MultipartViews& views, DecodedFrame& frame, unsigned threads = 1);
+
+    const TransportPlan& plan() const { return _plan; }
+    const ConsumerNeeds& needs() const { return _needs; }
+
+private:
+    bool isEntryAvailable(ArvCamera* camera, const char* component, const char* feature, const char* entry) const;
+    template <typename T> static const T* denseRows(const PartView& view, std::vector<T>& storage);
+
+    ConsumerNeeds _needs;
+    TransportPlan _plan;
+    ProjectedCReconstructor _reconstructor;
+    std::vector<Vec3D> _points;
+    std::vector<Vec3D> _normals;
+    std::vector<NormalsAngles> _angles;   // padded Coord3D_AC8 rows made contiguous
+    std::vector<uint8_t> _rgb;
+};
+
+inline bool BandwidthOptimizer::configure(ArvCamera* camera, const ConsumerNeeds& needs, TransportPlan* plan,
+                                          ApplyReport* report) {
+    if (!camera) {
+        return false;
+    }
+    _needs = needs;
+    _plan = TransportPlan();
+
+    _plan.projectedC = needs.points && isEntryAvailable(camera, nullptr, "Scan3dOutputMode", "ProjectedC");
+    _plan.normalsAC8 = needs.normals && isEntryAvailable(camera, "Normal", "PixelFormat", "Coord3D_AC8");
+#if defined(PHO_HAVE_OPENCV)
+    _plan.colorYCoCg = needs.colorTexture && isEntryAvailable(camera, "Intensity", "PixelFormat", "Mono16");
+#endif
+
+    const bool intensity = needs.texture || needs.colorTexture;
+    DeviceConfig config;
+    config.components = {
+        {Intensity, intensity, needs.colorTexture ? (_plan.colorYCoCg ? "Mono16" : "RGB8") : ""},
+        {Range, needs.points},
+        {Normal, needs.normals, needs.normals ? (_plan.normalsAC8 ? "Coord3D_AC8" : "Coord3D_ABC32f") : ""},
+        {Confidence, needs.confidence},
+        {Event, needs.events},
+        {ColorCameraImage, false},
+        {CoordinateMapA, false},
+        {CoordinateMapB, false},
+    };
+    if (needs.points) {
+        config.scan3dOutputMode = _plan.projectedC ? "ProjectedC" : "CalibratedABC_Grid";
+    }
+    if (needs.normals) {
+        config.minNormalsEstimationRadius = 1; /* 0 is not valid with normals, a configured radius is kept */
+    }
+    config.outputFormat = StreamOutputFormat::MultipartData;
+
+    if (!DeviceConfigurator(camera).apply(config, report)) {
+        std::cerr << "Error: Failed to configure the transport formats!" << std::endl;
+        return false;
+    }
+    if (_plan.projectedC && !_reconstructor.prepare(camera)) {
+        std::cerr << "Error: Failed to fetch the coordinate maps!" << std::endl;
+        return false;
+    }
+
+    GError* error = nullptr;
+    _plan.payload = arv_camera_get_payload(camera, &error);
+    const gint64 width = error ? 0 : arv_camera_get_integer(camera, "Width", &error);
+    const gint64 height = error ? 0 : arv_camera_get_integer(camera, "Height", &error);
+    if (error) {
+        std::cerr << "Error: Failed to read the payload size: " << error->message << std::endl;
+        g_clear_error(&error);
+        return false;
+    }
+    const size_t pixels = size_t(width) * size_t(height);
+    _plan.fullPayload = _plan.payload + (_plan.projectedC ? pixels * (sizeof(Vec3D) - sizeof(float)) : 0)
+                        + (_plan.normalsAC8 ? pixels * (sizeof(Vec3D) - sizeof(NormalsAngles)) : 0)
+                        + (_plan.colorYCoCg ? pixels * (3 - sizeof(uint16_t)) : 0);
+    if (plan) {
+        *plan = _plan;
+    }
+    return true;
+}
+
+inline bool BandwidthOptimizer::decode(const MultipartViews& views, DecodedFrame& frame, unsigned threads) {
+    frame = DecodedFrame();
+
+    /* Rows may be padded (stride above width * elementSize), the last one need not be */
+    const auto sizeMatches = [&frame](const PartView& view, size_t elementSize) {
+        const size_t rowBytes = size_t(view.width) * elementSize;
+        if (!view || view.height == 0 || view.stride < rowBytes
+            || view.size < view.stride * (view.height - 1) + rowBytes) {
+            return false;
+        }
+        if (frame.width == 0) {
+            frame.width = view.width;
+            frame.height = view.height;
+        }
+        return view.width == frame.width && view.height == frame.height;
+    };
+
+    if (_needs.points) {
+        const PartView& range = views.range();
+        const size_t pixels = size_t(range.width) * range.height;
+        if (!sizeMatches(range, _plan.projectedC ? sizeof(float) : sizeof(Vec3D))) {
+            std::cerr << "Error: Missing or unexpected Range part!" << std::endl;
+            return false;
+        }
+        if (_plan.projectedC) {
+            _points.resize(pixels);
+            if (!_reconstructor.reconstruct(range, _points.data(), threads)) {
+                return false;
+            }
+            frame.points = _points.data();
+            frame.transportBytes += pixels * sizeof(float);
+        } else {
+            frame.points = denseRows(range, _points);
+            frame.transportBytes += pixels * sizeof(Vec3D);
+        }
+        frame.fullBytes += pixels * sizeof(Vec3D);
+    }
+
+    if (_needs.normals) {
+        const PartView& normal = views.normal();
+        const size_t pixels = size_t(normal.width) * normal.height;
+        if (!sizeMatches(normal, _plan.normalsAC8 ? sizeof(NormalsAngles) : sizeof(Vec3D))) {
+            std::cerr << "Error: Missing or unexpected Normal part!" << std::endl;
+            return false;
+        }
+        if (_plan.normalsAC8) {
+            _normals.resize(pixels);
+            calculateNormals(denseRows(normal, _angles), normal.width, normal.height, _normals.data(), threads);
+            frame.normals = _normals.data();
+            frame.transportBytes += pixels * sizeof(NormalsAngles);
+        } else {
+            frame.normals = denseRows(normal, _normals);
+            frame.transportBytes += pixels * sizeof(Vec3D);
+        }
+        frame.fullBytes += pixels * sizeof(Vec3D);
+    }
+
+    frame.texture = views.intensity();
+    if (_needs.colorTexture) {
+        const PartView& texture = views.intensity();
+        const size_t pixels = size_t(texture.width) * texture.height;
+        if (!sizeMatches(texture, _plan.colorYCoCg ? sizeof(uint16_t) : 3)) {
+            std::cerr << "Error: Missing or unexpected Intensity part!" << std::endl;
+            return false;
+        }
+#if defined(PHO_HAVE_OPENCV)
+        if (_plan.colorYCoCg) {
+            const size_t stride = size_t(texture.width) * 3;
+            _rgb.resize(stride * texture.height);
+            YCoCg::convertToRGB8(texture.as<YCoCg::YCoCgType>(), texture.stride, int(texture.width),
+                                 int(texture.height), _rgb.data(), stride, YCoCg::ChannelOrder::RGB, threads);
+            frame.rgb = _rgb.data();
+            frame.rgbStride = stride;
+            frame.transportBytes += pixels * sizeof(uint16_t);
+        } else
+#endif
+        {
+            frame.rgb = texture.as<uint8_t>();
+            frame.rgbStride = texture.stride;
+            frame.transportBytes += pixels * 3;
+        }
+        frame.fullBytes += pixels * 3;
+    }
+
+    frame.confidence = views.confidence();
+    frame.event = views.event();
+    return true;
+}
+
+/* The part itself if its rows are contiguous, else a copy of its rows without the padding in `storage` */
+template <typename T>
+inline const T* BandwidthOptimizer::denseRows(const PartView& view, std::vector<T>& storage) {
+    const size_t rowBytes = size_t(view.width) * sizeof(T);
+    if (view.stride == rowBytes) {
+        return view.as<T>();
+    }
+    storage.resize(size_t(view.width) * view.height);
+    for (uint32_t row = 0; row < view.height; ++row) {
+        std::memcpy(storage.data() + size_t(row) * view.width, view.row<T>(row), rowBytes);
+    }
+    return storage.data();
+}
+
+inline bool BandwidthOptimizer::isEntryAvailable(ArvCamera* camera, const char* component, const char* feature,
+                                                 const char* entry) const {
+    GError* error = nullptr;
+    if (component) {
+        arv_camera_set_string(camera, "ComponentSelector", component, &error);
+        if (error) {
+            g_clear_error(&error);
+            return false;
+        }
+    }
+    const bool available = arv_camera_is_enumeration_entry_available(camera, feature, entry, &error);
+    if (error) {
+        g_clear_error(&error);
+        return false;
+    }
+    return available;
+}
+
+}  // namespace pho
+
+#endif  // PHOTONEOMAIN_BANDWIDTHOPTIMIZER_H
@@ -0,0 +1,177 @@
+#ifndef PHOTONEOMAIN_BUFFERARENA_H
+#define PHOTONEOMAIN_BUFFERARENA_H
+
+#include "PhoAravisCommon.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cstdlib>
+#endif
+
+namespace pho {
+
+/**
+ * Memory of the stream buffer pool, allocated once: `count` regions of `bufferSize` bytes in one arena, each
+ * region aligned to `alignment` (64 bytes by default, enough for any SIMD load), handed to aravis with
+ * arv_buffer_new_full() instead of letting it allocate every buffer on the heap.
+ *
+ * The arena is pre-faulted, so the first frames do not pay for page faults while the packets arrive, and backed
+ * by huge pages when available (Linux: explicit huge pages from the hugetlbfs pool, else transparent huge pages;
+ * Windows: large pages if the process holds SeLockMemoryPrivilege). The memory use is bytes(), fixed until the
+ * next allocate().
+ *
+ * aravis does not own the memory: the arena must outlive every stream its buffers were pushed to. Declare it
+ * before the stream, or destroy the stream first.
+ *
+ *     BufferArena arena;
+ *     arena.allocate(payload, 10);
+ *     arena.pushBuffers(stream);
+ */
+class BufferArena {
+public:
+    enum class Backing { None, HugePages, TransparentHugePages, Pages };
+
+    BufferArena() = default;
+    ~BufferArena() { release(); }
+
+    BufferArena(const BufferArena&) = delete;
+    BufferArena& operator=(const BufferArena&) = delete;
+
+    /* Allocates and pre-faults the arena, the previous one is released (its buffers must be destroyed) */
+    bool allocate(size_t bufferSize, size_t count, size_t alignment = 64);
+
+    /* A new buffer on region `index`, owned by the caller (or the stream it is pushed to) */
+    ArvBuffer* newBuffer(size_t index) const {
+        return index < _count ? arv_buffer_new_full(_bufferSize, region(index), nullptr, nullptr) : nullptr;
+    }
+
+    /* Pushes one buffer per region to `stream` */
+    void pushBuffers(ArvStream* stream) const {
+        for (size_t i = 0; i < _count; ++i) {
+            arv_stream_push_buffer(stream, newBuffer(i));
+        }
+    }
+
+    void* region(size_t index) const { return static_cast<uint8_t*>(_data) + index * _stride; }
+
+    size_t bufferSize() const { return _bufferSize; }
+    size_t count() const { return _count; }
+    size_t bytes() const { return _bytes; }
+    Backing backing() const { return _backing; }
+
+    static const char* backingName(Backing backing) {
+        switch (backing) {
+        case Backing::HugePages: return "huge pages";
+        case Backing::TransparentHugePages: return "transparent huge pages";
+        case Backing::Pages: return "pages";
+        default: return "none";
+        }
+    }
+
+    void release();
+
+private:
+    static constexpr size_t hugePageSize = size_t(2) << 20;
+    static constexpr size_t pageSize = 4096;
+
+    void* _data = nullptr;
+    size_t _bytes = 0;
+    size_t _bufferSize = 0;
+    size_t _stride = 0;
+    size_t _count = 0;
+    Backing _backing = Backing::None;
+};
+
+inline bool BufferArena::allocate(size_t bufferSize, size_t count, size_t alignment) {
+    release();
+    if (bufferSize == 0 || count == 0 || alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        return false;
+    }
+
+    const size_t stride = (bufferSize + alignment - 1) / alignment * alignment;
+    size_t bytes = (stride * count + hugePageSize - 1) / hugePageSize * hugePageSize;
+
+#if defined(__linux__)
+    /* MAP_POPULATE pre-faults the whole arena */
+    void* data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE,
+                      -1, 0);
+    Backing backing = Backing::HugePages;
+    if (data == MAP_FAILED) {
+        data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (data == MAP_FAILED) {
+            std::cerr << "Error: Failed to allocate a buffer arena of " << bytes << " bytes" << std::endl;
+            return false;
+        }
+        /* Advise before the pages are touched, so they are faulted in as huge pages */
+        backing = madvise(data, bytes, MADV_HUGEPAGE) == 0 ? Backing::TransparentHugePages : Backing::Pages;
+        for (size_t offset = 0; offset < bytes; offset += pageSize) {
+            static_cast<volatile uint8_t*>(data)[offset] = 0;
+        }
+    }
+#elif defined(_WIN32)
+    Backing backing = Backing::HugePages;
+    const size_t largePage = GetLargePageMinimum();
+    const size_t largeBytes = largePage ? (bytes + largePage - 1) / largePage * largePage : 0;
+    void* data = largePage
+                         ? VirtualAlloc(nullptr, largeBytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE)
+                         : nullptr;
+    if (data) {
+        /* Large pages may be bigger than hugePageSize */
+        bytes = largeBytes;
+    } else {
+        backing = Backing::Pages;
+        data = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        if (!data) {
+            std::cerr << "Error: Failed to allocate a buffer arena of " << bytes << " bytes" << std::endl;
+            return false;
+        }
+        for (size_t offset = 0; offset < bytes; offset += pageSize) {
+            static_cast<volatile uint8_t*>(data)[offset] = 0;
+        }
+    }
+#else
+    Backing backing = Backing::Pages;
+    void* data = std::aligned_alloc(pageSize, bytes);
+    if (!data) {
+        std::cerr << "Error: Failed to allocate a buffer arena of " << bytes << " bytes" << std::endl;
+        return false;
+    }
+    for (size_t offset = 0; offset < bytes; offset += pageSize) {
+        static_cast<volatile uint8_t*>(data)[offset] = 0;
+    }
+#endif
+
+    _data = data;
+    _bytes = bytes;
+    _bufferSize = bufferSize;
+    _stride = stride;
+    _count = count;
+    _backing = backing;
+    return true;
+}
+
+inline void BufferArena::release() {
+    if (!_data) {
+        return;
+    }
+#if defined(__linux__)
+    munmap(_data, _bytes);
+#elif defined(_WIN32)
+    VirtualFree(_data, 0, MEM_RELEASE);
+#else
+    std::free(_data);
+#endif
+    _data = nullptr;
+    _bytes = _bufferSize = _stride = _count = 0;
+    _backing = Backing::None;
+}
+
+}  // namespace pho
+
+#endif  // PHOTONEOMAIN_BUFFERARENA_H
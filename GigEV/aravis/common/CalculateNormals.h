@@ -2,10 +2,17 @@
 #define PHOTONEOMAIN_CALCULATENORMALS_H
 
 #include "PhoAravisCommon.h"
+#include "ParallelRows.h"
+#include "SimdHelpers.h"
 #include <cmath>
 
 namespace pho {
 
+/**
+ * Reference implementation of the Coord3D_AC8 decoding. Allocates the output and uses
+ * a full 256 x 256 lookup table, see the overloads below for the allocation-free
+ * versions intended for per-frame use.
+ */
 inline std::vector<Vec3D> calculateNormals(const NormalsAngles* normalsAngles, uint32_t width, uint32_t height) {
     //Initialize table of angles once, it does not change
     static std::vector<Vec3D> normalsAnglesTable = []() {
@@ -33,6 +40,317 @@ inline std::vector<Vec3D> calculateNormals(const NormalsAngles* normalsAngles, u
     return normals;
 }
 
+namespace detail {
+
+/*
+ * The spherical encoding factorizes into
+ *     x = sin(polar) * cos(azimuth), y = sin(polar) * sin(azimuth), z = cos(polar)
+ * so four 256 entry tables (4 KB in total, stays in L1) replace the 768 KB table above.
+ * The products are bit-exact with the full table.
+ */
+struct NormalsAnglesFactors {
+    float cosAzimuth[256];
+    float sinAzimuth[256];
+    float sinPolar[256];
+    float cosPolar[256];
+};
+
+inline const NormalsAnglesFactors& normalsAnglesFactors() {
+    static const NormalsAnglesFactors factors = []() {
+        NormalsAnglesFactors f;
+        const float pi = 3.14159265359f;
+        for(int i = 0; i < 256; ++i) {
+            float azimuthalAngle = (float) i * pi / 128.0f;
+            float polarAngle = (float) i * pi / 256.0f;
+            f.cosAzimuth[i] = cosf(azimuthalAngle);
+            f.sinAzimuth[i] = sinf(azimuthalAngle);
+            f.sinPolar[i] = sinf(polarAngle);
+            f.cosPolar[i] = cosf(polarAngle);
+        }
+        return f;
+    }();
+    return factors;
+}
+
+#if defined(__AVX2__)
+// Decodes 8 consecutive angle pairs into x, y, z vectors.
+inline void decodeNormals8(const NormalsAnglesFactors& f, const NormalsAngles* in, __m256& x, __m256& y, __m256& z) {
+    // Deinterleave (azimuth, polar) byte pairs into 8 azimuth bytes followed by 8 polar bytes
+    const __m128i deinterleave = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+    const __m128i angles = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in)), deinterleave);
+    const __m256i azimuth = _mm256_cvtepu8_epi32(angles);
+    const __m256i polar = _mm256_cvtepu8_epi32(_mm_srli_si128(angles, 8));
+
+    const __m256 radius = _mm256_i32gather_ps(f.sinPolar, polar, 4);
+    x = _mm256_mul_ps(radius, _mm256_i32gather_ps(f.cosAzimuth, azimuth, 4));
+    y = _mm256_mul_ps(radius, _mm256_i32gather_ps(f.sinAzimuth, azimuth, 4));
+    z = _mm256_i32gather_ps(f.cosPolar, polar, 4);
+}
+#endif
+
+inline void decodeNormals(const NormalsAngles* in, size_t count, Vec3D* out) {
+    const auto& f = normalsAnglesFactors();
+    size_t i = 0;
+#if defined(__AVX2__)
+    for(; i + 8 <= count; i += 8) {
+        __m256 x, y, z;
+        decodeNormals8(f, in + i, x, y, z);
+        float* dst = &out[i].x;
+        simd::storeVec3D4(dst, _mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z));
+        simd::storeVec3D4(dst + 12, _mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1));
+    }
+#endif
+    for(; i < count; ++i) {
+        const float radius = f.sinPolar[in[i].y];
+        out[i].x = radius * f.cosAzimuth[in[i].x];
+        out[i].y = radius * f.sinAzimuth[in[i].x];
+        out[i].z = f.cosPolar[in[i].y];
+    }
+}
+
+inline void decodeNormals(const NormalsAngles* in, size_t count, float* outX, float* outY, float* outZ) {
+    const auto& f = normalsAnglesFactors();
+    size_t i = 0;
+#if defined(__AVX2__)
+    for(; i + 8 <= count; i += 8) {
+        __m256 x, y, z;
+        decodeNormals8(f, in + i, x, y, z);
+        _mm256_storeu_ps(outX + i, x);
+        _mm256_storeu_ps(outY + i, y);
+        _mm256_storeu_ps(outZ + i, z);
+    }
+#endif
+    for(; i < count; ++i) {
+        const float radius = f.sinPolar[in[i].y];
+        outX[i] = radius * f.cosAzimuth[in[i].x];
+        outY[i] = radius * f.sinAzimuth[in[i].x];
+        outZ[i] = f.cosPolar[in[i].y];
+    }
+}
+
+/*
+ * Encoding: polar = acos(z) and azimuth = atan2(y, x), rounded to the nearest table angle. Both use polynomial
+ * approximations (acos: Abramowitz & Stegun 4.4.46, |error| <= 2e-8 rad; atan: minimax, |error| <= 1e-5 rad),
+ * far below the quantization steps of pi / 256 (polar) and pi / 128 (azimuth), and identical in the scalar,
+ * SSE2 and AVX2 code so all of them produce the same bytes.
+ */
+constexpr float normalsPi = 3.14159265359f;
+
+inline float acosApprox(float z) {
+    const float a = std::fabs(z);
+    float p = -0.0012624911f;
+    p = p * a + 0.0066700901f;
+    p = p * a - 0.0170881256f;
+    p = p * a + 0.0308918810f;
+    p = p * a - 0.0501743046f;
+    p = p * a + 0.0889789874f;
+    p = p * a - 0.2145988016f;
+    p = p * a + 1.5707963050f;
+    const float r = std::sqrt(1.0f - a) * p;
+    return z < 0.0f ? normalsPi - r : r;
+}
+
+/* atan2(y, x) in [0, 2 pi) */
+inline float atan2Approx(float y, float x) {
+    const float ax = std::fabs(x);
+    const float ay = std::fabs(y);
+    const float t = std::min(ax, ay) / std::max(std::max(ax, ay), 1e-30f);
+    const float t2 = t * t;
+    float p = -0.01172120f;
+    p = p * t2 + 0.05265332f;
+    p = p * t2 - 0.11643287f;
+    p = p * t2 + 0.19354346f;
+    p = p * t2 - 0.33262347f;
+    p = p * t2 + 0.99997726f;
+    float a = p * t;
+    a = ay > ax ? normalsPi * 0.5f - a : a;
+    a = x < 0.0f ? normalsPi - a : a;
+    return y < 0.0f ? 2.0f * normalsPi - a : a;
+}
+
+inline NormalsAngles encodeNormal(float x, float y, float z) {
+    const float polar = acosApprox(std::min(std::max(z, -1.0f), 1.0f));
+    const int polarIndex = int(std::min(polar * (256.0f / normalsPi) + 0.5f, 255.0f));
+    const int azimuthIndex = int(atan2Approx(y, x) * (128.0f / normalsPi) + 0.5f) & 0xFF;
+    return {uint8_t(azimuthIndex), uint8_t(polarIndex)};
+}
+
+#if defined(__AVX2__)
+// Encodes 8 normals into 8 angle pairs (16 bytes), the same operations as encodeNormal().
+inline void encodeNormals8(__m256 x, __m256 y, __m256 z, NormalsAngles* out) {
+    const __m256 pi = _mm256_set1_ps(normalsPi);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+
+    /* Polar angle */
+    z = _mm256_min_ps(_mm256_max_ps(z, _mm256_set1_ps(-1.0f)), _mm256_set1_ps(1.0f));
+    const __m256 a = _mm256_and_ps(z, absMask);
+    __m256 p = _mm256_set1_ps(-0.0012624911f);
+    p = _mm256_add_ps(_mm256_mul_ps(p, a), _mm256_set1_ps(0.0066700901f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, a), _mm256_set1_ps(-0.0170881256f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, a), _mm256_set1_ps(0.0308918810f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, a), _mm256_set1_ps(-0.0501743046f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, a), _mm256_set1_ps(0.0889789874f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, a), _mm256_set1_ps(-0.2145988016f));
+    p = _mm256_add_ps(_mm256_mul_ps(p, a), _mm256_set1_ps(1.5707963050f));
+    __m256 polar = _mm256_mul_ps(_mm256_sqrt_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), a)), p);
+    polar = _mm256_blendv_ps(polar, _mm256_sub_ps(pi, polar), _mm256_cmp_ps(z, zero, _CMP_LT_OQ));
+
+    /* Azimuthal angle */
+    const __m256 ax = _mm256_and_ps(x, absMask);
+    const __m256 ay = _mm256_and_ps(y, absMask);
+    const __m256 t = _mm256_div_ps(_mm256_min_ps(ax, ay), _mm256_max_ps(_mm256_max_ps(ax, ay), _mm256_set1_ps(1e-30f)));
+    const __m256 t2 = _mm256_mul_ps(t, t);
+    __m256 q = _mm256_set1_ps(-0.01172120f);
+    q = _mm256_add_ps(_mm256_mul_ps(q, t2), _mm256_set1_ps(0.05265332f));
+    q = _mm256_add_ps(_mm256_mul_ps(q, t2), _mm256_set1_ps(-0.11643287f));
+    q = _mm256_add_ps(_mm256_mul_ps(q, t2), _mm256_set1_ps(0.19354346f));
+    q = _mm256_add_ps(_mm256_mul_ps(q, t2), _mm256_set1_ps(-0.33262347f));
+    q = _mm256_add_ps(_mm256_mul_ps(q, t2), _mm256_set1_ps(0.99997726f));
+    __m256 azimuth = _mm256_mul_ps(q, t);
+    azimuth = _mm256_blendv_ps(azimuth, _mm256_sub_ps(_mm256_set1_ps(normalsPi * 0.5f), azimuth),
+                               _mm256_cmp_ps(ay, ax, _CMP_GT_OQ));
+    azimuth = _mm256_blendv_ps(azimuth, _mm256_sub_ps(pi, azimuth), _mm256_cmp_ps(x, zero, _CMP_LT_OQ));
+    azimuth = _mm256_blendv_ps(azimuth, _mm256_sub_ps(_mm256_set1_ps(2.0f * normalsPi), azimuth),
+                               _mm256_cmp_ps(y, zero, _CMP_LT_OQ));
+
+    /* Round half up like the scalar code, then pack (azimuth, polar) byte pairs */
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256i polarIndex = _mm256_cvttps_epi32(_mm256_min_ps(
+            _mm256_add_ps(_mm256_mul_ps(polar, _mm256_set1_ps(256.0f / normalsPi)), half), _mm256_set1_ps(255.0f)));
+    const __m256i azimuthIndex = _mm256_and_si256(
+            _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(azimuth, _mm256_set1_ps(128.0f / normalsPi)), half)),
+            _mm256_set1_epi32(0xFF));
+    const __m256i pairs = _mm256_or_si256(azimuthIndex, _mm256_slli_epi32(polarIndex, 8));
+    const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(pairs, pairs), _MM_SHUFFLE(3, 1, 2, 0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(packed));
+}
+#elif defined(PHO_SIMD_SSE2)
+inline __m128 select(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a));
+}
+
+// Encodes 4 normals into 4 angle pairs (8 bytes), the same operations as encodeNormal().
+inline void encodeNormals4(__m128 x, __m128 y, __m128 z, NormalsAngles* out) {
+    const __m128 pi = _mm_set1_ps(normalsPi);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+    /* Polar angle */
+    z = _mm_min_ps(_mm_max_ps(z, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+    const __m128 a = _mm_and_ps(z, absMask);
+    __m128 p = _mm_set1_ps(-0.0012624911f);
+    p = _mm_add_ps(_mm_mul_ps(p, a), _mm_set1_ps(0.0066700901f));
+    p = _mm_add_ps(_mm_mul_ps(p, a), _mm_set1_ps(-0.0170881256f));
+    p = _mm_add_ps(_mm_mul_ps(p, a), _mm_set1_ps(0.0308918810f));
+    p = _mm_add_ps(_mm_mul_ps(p, a), _mm_set1_ps(-0.0501743046f));
+    p = _mm_add_ps(_mm_mul_ps(p, a), _mm_set1_ps(0.0889789874f));
+    p = _mm_add_ps(_mm_mul_ps(p, a), _mm_set1_ps(-0.2145988016f));
+    p = _mm_add_ps(_mm_mul_ps(p, a), _mm_set1_ps(1.5707963050f));
+    __m128 polar = _mm_mul_ps(_mm_sqrt_ps(_mm_sub_ps(_mm_set1_ps(1.0f), a)), p);
+    polar = select(_mm_cmplt_ps(z, zero), polar, _mm_sub_ps(pi, polar));
+
+    /* Azimuthal angle */
+    const __m128 ax = _mm_and_ps(x, absMask);
+    const __m128 ay = _mm_and_ps(y, absMask);
+    const __m128 t = _mm_div_ps(_mm_min_ps(ax, ay), _mm_max_ps(_mm_max_ps(ax, ay), _mm_set1_ps(1e-30f)));
+    const __m128 t2 = _mm_mul_ps(t, t);
+    __m128 q = _mm_set1_ps(-0.01172120f);
+    q = _mm_add_ps(_mm_mul_ps(q, t2), _mm_set1_ps(0.05265332f));
+    q = _mm_add_ps(_mm_mul_ps(q, t2), _mm_set1_ps(-0.11643287f));
+    q = _mm_add_ps(_mm_mul_ps(q, t2), _mm_set1_ps(0.19354346f));
+    q = _mm_add_ps(_mm_mul_ps(q, t2), _mm_set1_ps(-0.33262347f));
+    q = _mm_add_ps(_mm_mul_ps(q, t2), _mm_set1_ps(0.99997726f));
+    __m128 azimuth = _mm_mul_ps(q, t);
+    azimuth = select(_mm_cmpgt_ps(ay, ax), azimuth, _mm_sub_ps(_mm_set1_ps(normalsPi * 0.5f), azimuth));
+    azimuth = select(_mm_cmplt_ps(x, zero), azimuth, _mm_sub_ps(pi, azimuth));
+    azimuth = select(_mm_cmplt_ps(y, zero), azimuth, _mm_sub_ps(_mm_set1_ps(2.0f * normalsPi), azimuth));
+
+    /* Round half up like the scalar code, then pack (azimuth, polar) byte pairs */
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128i polarIndex = _mm_cvttps_epi32(
+            _mm_min_ps(_mm_add_ps(_mm_mul_ps(polar, _mm_set1_ps(256.0f / normalsPi)), half), _mm_set1_ps(255.0f)));
+    const __m128i azimuthIndex = _mm_and_si128(
+            _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(azimuth, _mm_set1_ps(128.0f / normalsPi)), half)),
+            _mm_set1_epi32(0xFF));
+    /* SSE2 only packs with signed saturation, shift the 16 bit pairs into the signed range and back */
+    const __m128i bias = _mm_set1_epi32(0x8000);
+    const __m128i pairs = _mm_sub_epi32(_mm_or_si128(azimuthIndex, _mm_slli_epi32(polarIndex, 8)), bias);
+    const __m128i packed = _mm_xor_si128(_mm_packs_epi32(pairs, pairs), _mm_set1_epi16(short(0x8000)));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), packed);
+}
+#endif
+
+inline void encodeNormals(const Vec3D* in, size_t count, NormalsAngles* out) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    for(; i + 8 <= count; i += 8) {
+        __m128 x0, y0, z0, x1, y1, z1;
+        simd::loadVec3D4(&in[i].x, x0, y0, z0);
+        simd::loadVec3D4(&in[i + 4].x, x1, y1, z1);
+        encodeNormals8(_mm256_set_m128(x1, x0), _mm256_set_m128(y1, y0), _mm256_set_m128(z1, z0), out + i);
+    }
+#elif defined(PHO_SIMD_SSE2)
+    for(; i + 4 <= count; i += 4) {
+        __m128 x, y, z;
+        simd::loadVec3D4(&in[i].x, x, y, z);
+        encodeNormals4(x, y, z, out + i);
+    }
+#endif
+    for(; i < count; ++i) {
+        out[i] = encodeNormal(in[i].x, in[i].y, in[i].z);
+    }
+}
+
+}  // namespace detail
+
+/**
+ * Decodes Coord3D_AC8 normals into the caller-provided `normals` buffer of
+ * width * height elements. Does not allocate.
+ *
+ * Uses AVX2 when the translation unit is compiled with it (see PHO_ENABLE_AVX2 in
+ * helper_functions.cmake), scalar code otherwise. With `threads` > 1 the rows are split
+ * between that many threads.
+ */
+inline void calculateNormals(const NormalsAngles* normalsAngles, uint32_t width, uint32_t height, Vec3D* normals,
+                             unsigned threads = 1) {
+    parallelRows(height, threads, [&](uint32_t firstRow, uint32_t endRow) {
+        const size_t offset = size_t(firstRow) * width;
+        detail::decodeNormals(normalsAngles + offset, size_t(endRow - firstRow) * width, normals + offset);
+    });
+}
+
+/**
+ * Same as above, but decodes into three separate planes (structure of arrays), each of
+ * width * height floats.
+ */
+inline void calculateNormals(const NormalsAngles* normalsAngles, uint32_t width, uint32_t height,
+                             float* normalsX, float* normalsY, float* normalsZ, unsigned threads = 1) {
+    parallelRows(height, threads, [&](uint32_t firstRow, uint32_t endRow) {
+        const size_t offset = size_t(firstRow) * width;
+        detail::decodeNormals(normalsAngles + offset, size_t(endRow - firstRow) * width,
+                              normalsX + offset, normalsY + offset, normalsZ + offset);
+    });
+}
+
+/**
+ * Encodes unit normals (Coord3D_ABC32f) into the Coord3D_AC8 angles decoded by calculateNormals(), e.g. to store
+ * or forward them at 2 instead of 12 bytes per pixel. Angles are rounded to the nearest decode table entry, so
+ * decoding an encoded normal is off by at most half a quantization step in each angle (below 0.8 degrees) and
+ * encoding a decoded normal gives back the same bytes. Zero normals (pixels without data) encode to an arbitrary
+ * direction. Does not allocate.
+ *
+ * Uses AVX2 when the translation unit is compiled with it, SSE2 on other x86-64 builds, scalar code otherwise.
+ * With `threads` > 1 the rows are split between that many threads.
+ */
+inline void encodeNormals(const Vec3D* normals, uint32_t width, uint32_t height, NormalsAngles* normalsAngles,
+                          unsigned threads = 1) {
+    parallelRows(height, threads, [&](uint32_t firstRow, uint32_t endRow) {
+        const size_t offset = size_t(firstRow) * width;
+        detail::encodeNormals(normals + offset, size_t(endRow - firstRow) * width, normalsAngles + offset);
+    });
+}
+
 }
 
 #endif //PHOTONEOMAIN_CALCULATENORMALS_H
@@ -0,0 +1,276 @@
+#ifndef PHOTONEOMAIN_COMPACTPOINTS_H
+#define PHOTONEOMAIN_COMPACTPOINTS_H
+
+#include "PhoAravisCommon.h"
+#include "SimdHelpers.h"
+
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace pho {
+
+enum class CompactionMask {
+    Auto,       // Confidence if the frame contains it, RangeValid otherwise
+    Confidence, // pixels with non-zero Confidence
+    RangeValid  // pixels with non-zero Z (Coord3D_ABC32f) or C (Coord3D_C32f) range value
+};
+
+/**
+ * Valid pixels of one frame, packed densely: element i of every component and indices()[i] belong to the same
+ * source pixel. Only components with the resolution of the mask are compacted (Range, Intensity, Normal, ...), the
+ * elements keep their pixel format. Reuse the instance for every frame, it allocates only when a frame has more
+ * valid pixels than any frame before.
+ */
+class CompactedPoints {
+public:
+    size_t size() const { return _size; }
+
+    /* Source pixel index (row * width + column) of every element */
+    const uint32_t* indices() const { return _indices.data(); }
+
+    /* Dense values of `component`, nullptr if the component was not compacted */
+    template <typename T> const T* as(OutputMat component) const {
+        const size_t slot = MultipartViews::slotOf(component);
+        return slot < componentCount && _components[slot].elementSize
+                       ? reinterpret_cast<const T*>(_components[slot].data.data()) : nullptr;
+    }
+
+    size_t elementSize(OutputMat component) const {
+        const size_t slot = MultipartViews::slotOf(component);
+        return slot < componentCount ? _components[slot].elementSize : 0;
+    }
+
+    ArvPixelFormat pixelFormat(OutputMat component) const {
+        const size_t slot = MultipartViews::slotOf(component);
+        return slot < componentCount ? _components[slot].pixelFormat : 0;
+    }
+
+    /* Bytes of the compacted components and indices, compare with the sum of the source part sizes */
+    size_t bytes() const {
+        size_t total = _size * sizeof(uint32_t);
+        for (const auto& component : _components) {
+            total += _size * component.elementSize;
+        }
+        return total;
+    }
+
+private:
+    friend bool compactPoints(const MultipartViews& views, CompactedPoints& points, CompactionMask mask);
+
+    static constexpr size_t componentCount = MultipartViews::componentCount;
+
+    struct Component {
+        std::vector<uint8_t> data;
+        size_t elementSize = 0;
+        ArvPixelFormat pixelFormat = 0;
+    };
+
+    std::array<Component, componentCount> _components;
+    std::vector<uint32_t> _indices;
+    size_t _size = 0;
+};
+
+namespace detail {
+
+inline unsigned countTrailingZeros(uint32_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return unsigned(index);
+#else
+    return unsigned(__builtin_ctz(value));
+#endif
+}
+
+/* Copies one element, the sizes of the pixel formats get a fixed size copy */
+inline void copyElement(uint8_t* dst, const uint8_t* src, size_t size) {
+    switch (size) {
+        case 1: *dst = *src; break;
+        case 2: std::memcpy(dst, src, 2); break;
+        case 4: std::memcpy(dst, src, 4); break;
+        case 8: std::memcpy(dst, src, 8); break;
+        case 12: std::memcpy(dst, src, 12); break;
+        case 16: std::memcpy(dst, src, 16); break;
+        default: std::memcpy(dst, src, size); break;
+    }
+}
+
+enum class MaskSource { Confidence8, RangeABC32f, RangeC32f };
+
+/* Bit i set if pixel i of the 16 pixels starting at `row` is valid */
+inline uint32_t validMask16(MaskSource source, const uint8_t* row) {
+#if defined(PHO_SIMD_SSE2)
+    const __m128 zero = _mm_setzero_ps();
+    switch (source) {
+        case MaskSource::Confidence8: {
+            const __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row));
+            return ~uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(values, _mm_setzero_si128()))) & 0xFFFF;
+        }
+        case MaskSource::RangeABC32f: {
+            uint32_t mask = 0;
+            for (int i = 0; i < 4; ++i) {
+                __m128 x, y, z;
+                simd::loadVec3D4(reinterpret_cast<const float*>(row) + 12 * i, x, y, z);
+                mask |= uint32_t(_mm_movemask_ps(_mm_cmpneq_ps(z, zero))) << (4 * i);
+            }
+            return mask;
+        }
+        case MaskSource::RangeC32f: {
+            uint32_t mask = 0;
+            for (int i = 0; i < 4; ++i) {
+                const __m128 c = _mm_loadu_ps(reinterpret_cast<const float*>(row) + 4 * i);
+                mask |= uint32_t(_mm_movemask_ps(_mm_cmpneq_ps(c, zero))) << (4 * i);
+            }
+            return mask;
+        }
+    }
+    return 0;
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < 16; ++i) {
+        float value = 0.0f;
+        switch (source) {
+            case MaskSource::Confidence8: value = row[i]; break;
+            case MaskSource::RangeABC32f: std::memcpy(&value, row + 12 * i + 8, 4); break;
+            case MaskSource::RangeC32f: std::memcpy(&value, row + 4 * i, 4); break;
+        }
+        mask |= uint32_t(value != 0.0f) << i;
+    }
+    return mask;
+#endif
+}
+
+inline bool isValid(MaskSource source, const uint8_t* row, uint32_t column) {
+    float value = 0.0f;
+    switch (source) {
+        case MaskSource::Confidence8: return row[column] != 0;
+        case MaskSource::RangeABC32f: std::memcpy(&value, row + 12 * size_t(column) + 8, 4); break;
+        case MaskSource::RangeC32f: std::memcpy(&value, row + 4 * size_t(column), 4); break;
+    }
+    return value != 0.0f;
+}
+
+}  // namespace detail
+
+/**
+ * Packs the pixels selected by `mask` of all components with the mask resolution into `points` in one pass:
+ * 16 pixels are tested at once (SSE2), fully valid groups are copied as one block, partially valid ones run by
+ * run. Downstream work and data shrink with the invalid fraction. Returns false if the mask component is
+ * missing or has an unsupported pixel format.
+ *
+ *     CompactedPoints points;
+ *     if (views.map(buffer) && compactPoints(views, points)) {
+ *         const Vec3D* xyz = points.as<Vec3D>(Range);        // Coord3D_ABC32f
+ *         const uint16_t* intensity = points.as<uint16_t>(Intensity);
+ *         const uint32_t* pixel = points.indices();
+ *     }
+ */
+inline bool compactPoints(const MultipartViews& views, CompactedPoints& points,
+                          CompactionMask mask = CompactionMask::Auto) {
+    using detail::MaskSource;
+    points._size = 0;
+
+    const PartView* maskView = nullptr;
+    MaskSource source = MaskSource::Confidence8;
+    if (mask != CompactionMask::RangeValid && views.confidence()) {
+        maskView = &views.confidence();
+        if (ARV_PIXEL_FORMAT_BIT_PER_PIXEL(maskView->pixelFormat) != 8) {
+            return false;
+        }
+    } else if (mask != CompactionMask::Confidence && views.range()) {
+        maskView = &views.range();
+        switch (ARV_PIXEL_FORMAT_BIT_PER_PIXEL(maskView->pixelFormat)) {
+            case 96: source = MaskSource::RangeABC32f; break;
+            case 32: source = MaskSource::RangeC32f; break;
+            default: return false;
+        }
+    } else {
+        return false;
+    }
+
+    const uint32_t width = maskView->width;
+    const uint32_t height = maskView->height;
+    const size_t pixels = size_t(width) * height;
+
+    /* Components to compact: every mapped part with the resolution of the mask and whole bytes per pixel */
+    struct Source {
+        const PartView* view;
+        uint8_t* out;
+        size_t elementSize;
+    };
+    std::array<Source, MultipartViews::componentCount> sources;
+    size_t sourceCount = 0;
+    for (size_t slot = 0; slot < MultipartViews::componentCount; ++slot) {
+        auto& component = points._components[slot];
+        const PartView& view = views.view(MultipartViews::components[slot]);
+        const size_t bits = ARV_PIXEL_FORMAT_BIT_PER_PIXEL(view.pixelFormat);
+        component.elementSize = 0;
+        if (!view || view.width != width || view.height != height || bits == 0 || bits % 8 != 0) {
+            continue;
+        }
+        component.elementSize = bits / 8;
+        component.pixelFormat = view.pixelFormat;
+        if (component.data.size() < pixels * component.elementSize) {
+            component.data.resize(pixels * component.elementSize);
+        }
+        sources[sourceCount++] = {&view, component.data.data(), component.elementSize};
+    }
+    if (points._indices.size() < pixels) {
+        points._indices.resize(pixels);
+    }
+
+    size_t count = 0;
+    uint32_t* indices = points._indices.data();
+    for (uint32_t row = 0; row < height; ++row) {
+        const uint8_t* maskRow = maskView->row<uint8_t>(row);
+        const uint32_t rowStart = row * width;
+        const auto copy = [&](uint32_t column, uint32_t length) {
+            for (size_t s = 0; s < sourceCount; ++s) {
+                const Source& src = sources[s];
+                const uint8_t* from = src.view->row<uint8_t>(row) + size_t(column) * src.elementSize;
+                uint8_t* to = src.out + count * src.elementSize;
+                if (length == 1) {
+                    detail::copyElement(to, from, src.elementSize);
+                } else {
+                    std::memcpy(to, from, length * src.elementSize);
+                }
+            }
+            for (uint32_t i = 0; i < length; ++i) {
+                indices[count + i] = rowStart + column + i;
+            }
+            count += length;
+        };
+
+        uint32_t column = 0;
+        const size_t maskStep = source == MaskSource::Confidence8 ? 1 : source == MaskSource::RangeC32f ? 4 : 12;
+        for (; column + 16 <= width; column += 16) {
+            uint32_t valid = detail::validMask16(source, maskRow + column * maskStep);
+            if (valid == 0xFFFF) {
+                copy(column, 16);
+                continue;
+            }
+            /* Runs of valid pixels, each copied at once */
+            while (valid) {
+                const unsigned first = detail::countTrailingZeros(valid);
+                const unsigned length = detail::countTrailingZeros(~(valid >> first));
+                copy(column + first, length);
+                valid &= ~(((1u << length) - 1) << first);
+            }
+        }
+        for (; column < width; ++column) {
+            if (detail::isValid(source, maskRow, column)) {
+                copy(column, 1);
+            }
+        }
+    }
+
+    points._size = count;
+    return true;
+}
+
+}  // namespace pho
+
+#endif  // PHOTONEOMAIN_COMPACTPOINTS_H
@@ -0,0 +1,305 @@
+#ifndef PHOTONEOMAIN_DEVICECONFIG_H
+#define PHOTONEOMAIN_DEVICECONFIG_H
+
+#include "PhoAravisCommon.h"
+
+#include <chrono>
+#include <cmath>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace pho {
+
+struct ComponentConfig {
+    ComponentConfig(OutputMat outputMat, bool enable = true, std::string format = {})
+            : component(outputMat), enabled(enable), pixelFormat(std::move(format)) {}
+
+    OutputMat component;
+    bool enabled;
+    std::string pixelFormat; // e.g. "Coord3D_AC8", empty keeps the device setting
+};
+
+/**
+ * Declarative device configuration. Everything left empty keeps the current device value, components which
+ * are not listed are not touched.
+ */
+struct DeviceConfig {
+    std::vector<ComponentConfig> components;
+    std::string scan3dOutputMode;                   // "CalibratedABC_Grid", "ProjectedC", ...
+    std::optional<gint64> normalsEstimationRadius;  // 1 - 4
+    /* Raises NormalsEstimationRadius to this value only if the device has less, e.g. 1 fixes the 0 which is not
+     * valid with normals and keeps a radius the user configured. Ignored if normalsEstimationRadius is set. */
+    std::optional<gint64> minNormalsEstimationRadius;
+    std::optional<TriggerMode> triggerMode;
+    std::optional<StreamOutputFormat> outputFormat;
+    std::optional<gint64> packetSize;               // GevSCPSPacketSize [bytes]
+    std::optional<gint64> packetDelay;              // GevSCPD [timestamp ticks]
+    /* Any other features, applied last: name and value as accepted by the GenICam node (e.g. "true", "1.5") */
+    std::vector<std::pair<std::string, std::string>> features;
+};
+
+struct ApplyReport {
+    size_t reads = 0;
+    size_t writes = 0;
+    std::vector<std::string> changed; // "Feature[Selector=Value]: old -> new"
+    std::vector<std::string> skipped; // features or selector entries not available on the device
+    double milliseconds = 0.0;
+
+    void print(std::ostream& out) const {
+        out << "Configuration applied in " << milliseconds << " ms: " << reads << " reads, " << writes << " writes"
+            << std::endl;
+        for (const auto& change : changed) {
+            out << "  changed " << change << std::endl;
+        }
+        for (const auto& skip : skipped) {
+            out << "  skipped " << skip << " (not available)" << std::endl;
+        }
+    }
+};
+
+/**
+ * Applies a DeviceConfig with as few GenICam accesses as possible: every feature is read once and only
+ * written if it differs (integer, float and boolean features by value, floats with a relative tolerance of 1e-6,
+ * so "30.72" matches the 30.719999 read back), selectors (ComponentSelector, TriggerSelector) are written only when their value
+ * changes and all settings of one selector value are grouped. Nodes are resolved once per configurator, so
+ * keep the instance around when applying several configurations (e.g. recipe changes).
+ *
+ *     DeviceConfig config;
+ *     config.components = {{Intensity, true}, {Range, true}, {Normal, true, "Coord3D_AC8"}, {Confidence, false}};
+ *     config.triggerMode = TriggerMode::Freerun;
+ *     config.outputFormat = StreamOutputFormat::MultipartData;
+ *
+ *     DeviceConfigurator configurator(camera);
+ *     ApplyReport report;
+ *     configurator.apply(config, &report);
+ */
+class DeviceConfigurator {
+public:
+    explicit DeviceConfigurator(ArvCamera* camera)
+            : _camera(camera), _device(camera ? arv_camera_get_device(camera) : nullptr) {}
+
+    bool apply(const DeviceConfig& config, ApplyReport* report = nullptr);
+
+private:
+    struct Setting {
+        std::string selector; // empty if the feature is not selected
+        std::string selectorValue;
+        std::string feature;
+        std::string value;
+        bool minimum = false; // integer feature raised to `value` only if below
+    };
+
+    static std::vector<Setting> settingsOf(const DeviceConfig& config);
+    ArvGcFeatureNode* node(const std::string& name);
+    static bool satisfies(ArvGcFeatureNode* node, const std::string& current, const Setting& setting);
+    bool read(ArvGcFeatureNode* node, std::string& value, ApplyReport& report);
+    bool write(ArvGcFeatureNode* node, const std::string& value, ApplyReport& report);
+
+    ArvCamera* _camera;
+    ArvDevice* _device;
+    std::unordered_map<std::string, ArvGcFeatureNode*> _nodes;
+};
+
+inline bool DeviceConfigurator::apply(const DeviceConfig& config, ApplyReport* report) {
+    ApplyReport localReport;
+    ApplyReport& out = report ? *report : localReport;
+    out = ApplyReport();
+    if (!_camera || !_device) {
+        return false;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    /* Current value of every selector touched so far and whether its current entry is available */
+    std::unordered_map<std::string, std::string> selectorValues;
+    std::unordered_map<std::string, bool> selectorValid;
+    bool ok = true;
+
+    for (const auto& setting : settingsOf(config)) {
+        std::string displayName = setting.feature;
+        if (!setting.selector.empty()) {
+            displayName += "[" + setting.selector + "=" + setting.selectorValue + "]";
+
+            ArvGcFeatureNode* selector = node(setting.selector);
+            if (!selector) {
+                out.skipped.push_back(displayName);
+                continue;
+            }
+            auto current = selectorValues.find(setting.selector);
+            if (current == selectorValues.end()) {
+                std::string value;
+                if (!read(selector, value, out)) {
+                    ok = false;
+                    break;
+                }
+                current = selectorValues.emplace(setting.selector, value).first;
+                selectorValid[setting.selector] = true;
+            }
+            if (current->second != setting.selectorValue) {
+                current->second = setting.selectorValue;
+                /* Fails for entries the device does not provide (e.g. ColorCamera on devices without it) */
+                selectorValid[setting.selector] = write(selector, setting.selectorValue, out);
+            }
+            if (!selectorValid[setting.selector]) {
+                out.skipped.push_back(displayName);
+                continue;
+            }
+        }
+
+        ArvGcFeatureNode* feature = node(setting.feature);
+        if (!feature) {
+            out.skipped.push_back(displayName);
+            continue;
+        }
+
+        std::string value;
+        if (!read(feature, value, out)) {
+            ok = false;
+            break;
+        }
+        if (satisfies(feature, value, setting)) {
+            continue;
+        }
+        if (!write(feature, setting.value, out)) {
+            std::cerr << "Error: Failed to set " << displayName << " to " << setting.value << std::endl;
+            ok = false;
+            break;
+        }
+        out.changed.push_back(displayName + ": " + value + " -> " + setting.value);
+    }
+
+    out.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return ok;
+}
+
+inline std::vector<DeviceConfigurator::Setting> DeviceConfigurator::settingsOf(const DeviceConfig& config) {
+    std::vector<Setting> settings;
+    if (config.triggerMode) {
+        const bool software = *config.triggerMode == TriggerMode::SWTrigger;
+        settings.push_back({"", "", "AcquisitionMode", "Continuous"});
+        settings.push_back({"TriggerSelector", "FrameStart", "TriggerMode", software ? "On" : "Off"});
+        if (software) {
+            settings.push_back({"TriggerSelector", "FrameStart", "TriggerSource", "Software"});
+        }
+    }
+    if (!config.scan3dOutputMode.empty()) {
+        settings.push_back({"", "", "Scan3dOutputMode", config.scan3dOutputMode});
+    }
+    if (config.normalsEstimationRadius) {
+        settings.push_back({"", "", "NormalsEstimationRadius", std::to_string(*config.normalsEstimationRadius)});
+    } else if (config.minNormalsEstimationRadius) {
+        settings.push_back({"", "", "NormalsEstimationRadius", std::to_string(*config.minNormalsEstimationRadius),
+                            true});
+    }
+    for (const auto& component : config.components) {
+        const char* selectorName = componentSelectorName(component.component);
+        if (!selectorName) {
+            continue;
+        }
+        settings.push_back({"ComponentSelector", selectorName, "ComponentEnable", component.enabled ? "true" : "false"});
+        if (!component.pixelFormat.empty()) {
+            settings.push_back({"ComponentSelector", selectorName, "PixelFormat", component.pixelFormat});
+        }
+    }
+    if (config.outputFormat) {
+        const bool multipart = *config.outputFormat == StreamOutputFormat::MultipartData;
+        settings.push_back({"", "", "GevSCCFGMultipart", multipart ? "true" : "false"});
+    }
+    if (config.packetSize) {
+        settings.push_back({"", "", "GevSCPSPacketSize", std::to_string(*config.packetSize)});
+    }
+    if (config.packetDelay) {
+        settings.push_back({"", "", "GevSCPD", std::to_string(*config.packetDelay)});
+    }
+    for (const auto& feature : config.features) {
+        settings.push_back({"", "", feature.first, feature.second});
+    }
+    return settings;
+}
+
+inline ArvGcFeatureNode* DeviceConfigurator::node(const std::string& name) {
+    const auto cached = _nodes.find(name);
+    if (cached != _nodes.end()) {
+        return cached->second;
+    }
+    ArvGcNode* node = arv_device_get_feature(_device, name.c_str());
+    ArvGcFeatureNode* feature = ARV_IS_GC_FEATURE_NODE(node) ? ARV_GC_FEATURE_NODE(node) : nullptr;
+    _nodes.emplace(name, feature);
+    return feature;
+}
+
+/* Whether the current value already is the wanted one, compared by the type of the node */
+inline bool DeviceConfigurator::satisfies(ArvGcFeatureNode* node, const std::string& current,
+                                          const Setting& setting) {
+    const auto parseInteger = [](const std::string& text, gint64& value) {
+        char* end = nullptr;
+        value = g_ascii_strtoll(text.c_str(), &end, 0);
+        return !text.empty() && end && *end == '\0';
+    };
+    const auto parseBoolean = [](const std::string& text, bool& value) {
+        if (text == "1" || g_ascii_strcasecmp(text.c_str(), "true") == 0) {
+            value = true;
+        } else if (text == "0" || g_ascii_strcasecmp(text.c_str(), "false") == 0) {
+            value = false;
+        } else {
+            return false;
+        }
+        return true;
+    };
+
+    /* Enumerations implement the integer interface too, but are read and written as entry names */
+    if (ARV_IS_GC_ENUMERATION(node)) {
+        return current == setting.value;
+    }
+    if (ARV_IS_GC_INTEGER(node)) {
+        gint64 currentValue = 0, wantedValue = 0;
+        if (parseInteger(current, currentValue) && parseInteger(setting.value, wantedValue)) {
+            return setting.minimum ? currentValue >= wantedValue : currentValue == wantedValue;
+        }
+    } else if (ARV_IS_GC_FLOAT(node)) {
+        char* currentEnd = nullptr;
+        char* wantedEnd = nullptr;
+        const double currentValue = g_ascii_strtod(current.c_str(), &currentEnd);
+        const double wantedValue = g_ascii_strtod(setting.value.c_str(), &wantedEnd);
+        if (*currentEnd == '\0' && *wantedEnd == '\0' && !current.empty() && !setting.value.empty()) {
+            return std::abs(currentValue - wantedValue)
+                   <= 1e-6 * std::max({1.0, std::abs(currentValue), std::abs(wantedValue)});
+        }
+    } else if (ARV_IS_GC_BOOLEAN(node)) {
+        bool currentValue = false, wantedValue = false;
+        if (parseBoolean(current, currentValue) && parseBoolean(setting.value, wantedValue)) {
+            return currentValue == wantedValue;
+        }
+    }
+    return current == setting.value;
+}
+
+inline bool DeviceConfigurator::read(ArvGcFeatureNode* node, std::string& value, ApplyReport& report) {
+    GError* error = nullptr;
+    const char* current = arv_gc_feature_node_get_value_as_string(node, &error);
+    ++report.reads;
+    if (error) {
+        std::cerr << "Error: " << error->message << std::endl;
+        g_clear_error(&error);
+        return false;
+    }
+    value = current ? current : "";
+    return true;
+}
+
+inline bool DeviceConfigurator::write(ArvGcFeatureNode* node, const std::string& value, ApplyReport& report) {
+    GError* error = nullptr;
+    arv_gc_feature_node_set_value_from_string(node, value.c_str(), &error);
+    ++report.writes;
+    if (error) {
+        g_clear_error(&error);
+        return false;
+    }
+    return true;
+}
+
+}  // namespace pho
+
+#endif  // PHOTONEOMAIN_DEVICECONFIG_H
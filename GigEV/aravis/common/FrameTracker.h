@@ -0,0 +1,231 @@
+#ifndef PHOTONEOMAIN_FRAMETRACKER_H
+#define PHOTONEOMAIN_FRAMETRACKER_H
+
+#include "PhoAravisCommon.h"
+#include "StreamStatistics.h"
+
+#include <iomanip>
+
+namespace pho {
+
+/*
+ * Signed number of frames from frame ID `from` to `to`: 1 for consecutive frames, above 1 if frames were skipped,
+ * 0 or below for repeated or late frames. GigE Vision 1.x block IDs are 16 bit and skip 0 when wrapping.
+ */
+inline int64_t frameIdDistance(guint64 from, guint64 to) {
+    int64_t distance = int64_t(to - from);
+    if (from <= 0xFFFF && to <= 0xFFFF) {
+        if (distance < -0x7FFF) {
+            distance += 0xFFFF;
+        } else if (distance > 0x7FFF) {
+            distance -= 0xFFFF;
+        }
+    }
+    return distance;
+}
+
+/**
+ * Frame loss accounting of a stream, from the frame IDs, status and timestamps of the popped buffers.
+ *
+ * Call onBuffer() for every buffer popped from the stream (complete or not) and onNoBuffer() when a pop returned
+ * nothing, from the thread popping the buffers. Detected:
+ *  - skipped frame IDs: frames the host never received a buffer for (underruns, lost leaders / trailers),
+ *  - failed buffers: received incompletely (missing packets, timeouts, ...),
+ *  - late frames: IDs below the last one (out of order), counted back from the skipped ones, and repeated IDs,
+ *  - stalls: an interval between consecutive frames above `stallFactor` times the typical frame interval
+ *    (a moving average of the device timestamps, the host timestamps if the device does not provide them).
+ * The latest events are kept in a fixed size log, so a loss at line rate can be attributed afterwards.
+ */
+class FrameTracker {
+public:
+    enum class EventType { Skipped, Failed, OutOfOrder, Repeated, Stall, NoBuffer };
+
+    struct Event {
+        EventType type;
+        guint64 frameId = 0;
+        int64_t hostTimeUs = 0; // g_get_monotonic_time() when the event was detected
+        uint64_t value = 0;     // skipped frames, ArvBufferStatus, interval [us] or frames behind
+    };
+
+    struct Counters {
+        uint64_t buffers = 0;    // buffers passed to onBuffer()
+        uint64_t completed = 0;
+        uint64_t failed = 0;
+        uint64_t skipped = 0;    // frame IDs without a buffer (so far, late frames are subtracted)
+        uint64_t outOfOrder = 0;
+        uint64_t repeated = 0;
+        uint64_t stalls = 0;
+        uint64_t noBuffer = 0;   // pops without a buffer
+
+        /* Frames the device sent according to the frame IDs */
+        uint64_t expected() const { return completed + failed + skipped - repeated; }
+        double lossPercent() const { return expected() ? 100.0 * (failed + skipped) / expected() : 0.0; }
+    };
+
+    explicit FrameTracker(double stallFactor = 1.5, size_t eventCapacity = 64)
+            : _stallFactor(stallFactor), _events(std::max<size_t>(1, eventCapacity)) {}
+
+    void onBuffer(ArvBuffer* buffer);
+    void onNoBuffer();
+
+    const Counters& counters() const { return _counters; }
+
+    /* Typical interval between two frames in microseconds, 0 until a few frames were received */
+    double frameIntervalUs() const { return _intervalSamples >= warmUpFrames ? _intervalUs : 0.0; }
+
+    /* Logged events, oldest first */
+    std::vector<Event> events() const;
+
+    void print(std::ostream& out, size_t lastEvents = 10) const;
+
+    void clear() {
+        _counters = Counters();
+        _haveFrame = false;
+        _intervalUs = 0.0;
+        _intervalSamples = 0;
+        _eventCount = 0;
+    }
+
+    static const char* eventName(EventType type);
+
+private:
+    static constexpr unsigned warmUpFrames = 8;
+
+    void log(EventType type, guint64 frameId, uint64_t value);
+
+    double _stallFactor;
+    Counters _counters;
+    bool _haveFrame = false;
+    guint64 _lastFrameId = 0;
+    guint64 _lastTimestampNs = 0;
+    bool _deviceTimestamps = false;
+    double _intervalUs = 0.0; // moving average per frame ID
+    unsigned _intervalSamples = 0;
+    std::vector<Event> _events; // ring buffer
+    size_t _eventCount = 0;
+};
+
+inline void FrameTracker::onBuffer(ArvBuffer* buffer) {
+    ++_counters.buffers;
+    const guint64 frameId = arv_buffer_get_frame_id(buffer);
+    const ArvBufferStatus status = arv_buffer_get_status(buffer);
+    if (status == ARV_BUFFER_STATUS_SUCCESS) {
+        ++_counters.completed;
+    } else {
+        ++_counters.failed;
+        log(EventType::Failed, frameId, uint64_t(status));
+    }
+
+    if (!_haveFrame) {
+        _haveFrame = true;
+        _lastFrameId = frameId;
+        _deviceTimestamps = arv_buffer_get_timestamp(buffer) != 0;
+        _lastTimestampNs = _deviceTimestamps ? arv_buffer_get_timestamp(buffer)
+                                             : arv_buffer_get_system_timestamp(buffer);
+        return;
+    }
+
+    const int64_t distance = frameIdDistance(_lastFrameId, frameId);
+    if (distance <= 0) {
+        /* A frame counted as skipped arrived late, the last frame ID and timestamp stay */
+        if (distance == 0) {
+            ++_counters.repeated;
+            log(EventType::Repeated, frameId, 0);
+        } else {
+            ++_counters.outOfOrder;
+            _counters.skipped -= std::min<uint64_t>(_counters.skipped, 1);
+            log(EventType::OutOfOrder, frameId, uint64_t(-distance));
+        }
+        return;
+    }
+    if (distance > 1) {
+        _counters.skipped += uint64_t(distance - 1);
+        log(EventType::Skipped, frameId, uint64_t(distance - 1));
+    }
+    _lastFrameId = frameId;
+
+    /* Failed buffers may miss the leader with the timestamp */
+    const guint64 timestampNs = _deviceTimestamps ? arv_buffer_get_timestamp(buffer)
+                                                  : arv_buffer_get_system_timestamp(buffer);
+    if (timestampNs == 0 || timestampNs <= _lastTimestampNs) {
+        return;
+    }
+    const double intervalUs = double(timestampNs - _lastTimestampNs) / 1000.0 / double(distance);
+    _lastTimestampNs = timestampNs;
+
+    if (_intervalSamples >= warmUpFrames && intervalUs > _stallFactor * _intervalUs) {
+        ++_counters.stalls;
+        log(EventType::Stall, frameId, uint64_t(intervalUs));
+        return; /* keep stalls out of the average */
+    }
+    /* Average of the first frames, then an exponential moving average */
+    ++_intervalSamples;
+    const double weight = _intervalSamples < warmUpFrames ? 1.0 / _intervalSamples : 1.0 / warmUpFrames;
+    _intervalUs += (intervalUs - _intervalUs) * weight;
+}
+
+inline void FrameTracker::onNoBuffer() {
+    ++_counters.noBuffer;
+    log(EventType::NoBuffer, _lastFrameId, 0);
+}
+
+inline std::vector<FrameTracker::Event> FrameTracker::events() const {
+    const size_t count = std::min(_eventCount, _events.size());
+    std::vector<Event> events;
+    events.reserve(count);
+    for (size_t i = _eventCount - count; i < _eventCount; ++i) {
+        events.push_back(_events[i % _events.size()]);
+    }
+    return events;
+}
+
+inline void FrameTracker::print(std::ostream& out, size_t lastEvents) const {
+    /* The format of the caller's stream is restored at the end */
+    const std::ios_base::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    out << "Frames: " << _counters.expected() << " sent, " << _counters.completed << " completed, "
+        << _counters.failed << " failed, " << _counters.skipped << " skipped IDs, " << _counters.outOfOrder
+        << " out of order, " << _counters.repeated << " repeated, " << _counters.stalls << " stalls, "
+        << _counters.noBuffer << " empty pops | loss " << std::fixed << std::setprecision(2)
+        << _counters.lossPercent() << " %, frame interval " << std::setprecision(0) << frameIntervalUs() << " us ("
+        << (_deviceTimestamps ? "device" : "host") << " timestamps)" << std::endl;
+
+    const auto events = this->events();
+    const size_t first = events.size() > lastEvents ? events.size() - lastEvents : 0;
+    for (size_t i = first; i < events.size(); ++i) {
+        const Event& event = events[i];
+        out << "  " << std::setw(12) << event.hostTimeUs << " us  frame " << std::setw(8) << event.frameId << "  "
+            << eventName(event.type);
+        switch (event.type) {
+        case EventType::Skipped: out << " " << event.value << " frames"; break;
+        case EventType::Failed: out << " " << bufferStatusName(ArvBufferStatus(event.value)); break;
+        case EventType::OutOfOrder: out << " " << event.value << " frames late"; break;
+        case EventType::Stall: out << " " << event.value << " us"; break;
+        default: break;
+        }
+        out << std::endl;
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+inline const char* FrameTracker::eventName(EventType type) {
+    switch (type) {
+    case EventType::Skipped: return "skipped";
+    case EventType::Failed: return "failed";
+    case EventType::OutOfOrder: return "out_of_order";
+    case EventType::Repeated: return "repeated";
+    case EventType::Stall: return "stall";
+    case EventType::NoBuffer: return "no_buffer";
+    default: return "unknown";
+    }
+}
+
+inline void FrameTracker::log(EventType type, guint64 frameId, uint64_t value) {
+    _events[_eventCount % _events.size()] = {type, frameId, g_get_monotonic_time(), value};
+    ++_eventCount;
+}
+
+}  // namespace pho
+
+#endif  // PHOTONEOMAIN_FRAMETRACKER_H
@@ -0,0 +1,81 @@
+#ifndef PHOTONEOMAIN_MOTIONCOMPENSATION_H
+#define PHOTONEOMAIN_MOTIONCOMPENSATION_H
+
+#include "PhoAravisCommon.h"
+#include "ParallelRows.h"
+#include "SimdHelpers.h"
+
+namespace pho {
+
+namespace detail {
+
+// point -= velocity * time for valid points (z != 0), invalid points stay at (0, 0, 0).
+inline void compensatePoints(Vec3D* points, const float* times, size_t count, const Vec3D& velocity) {
+    size_t i = 0;
+#if defined(PHO_SIMD_SSE2)
+    const __m128 vx = _mm_set1_ps(velocity.x);
+    const __m128 vy = _mm_set1_ps(velocity.y);
+    const __m128 vz = _mm_set1_ps(velocity.z);
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4) {
+        __m128 x, y, z;
+        simd::loadVec3D4(&points[i].x, x, y, z);
+        const __m128 t = _mm_and_ps(_mm_loadu_ps(times + i), _mm_cmpneq_ps(z, zero));
+        simd::storeVec3D4(&points[i].x, _mm_sub_ps(x, _mm_mul_ps(vx, t)), _mm_sub_ps(y, _mm_mul_ps(vy, t)),
+                          _mm_sub_ps(z, _mm_mul_ps(vz, t)));
+    }
+#endif
+    for (; i < count; ++i) {
+        if (points[i].z != 0.0f) {
+            points[i].x -= velocity.x * times[i];
+            points[i].y -= velocity.y * times[i];
+            points[i].z -= velocity.z * times[i];
+        }
+    }
+}
+
+}  // namespace detail
+
+/**
+ * Motion compensation of a point cloud scanned while the scene moves (e.g. on a conveyor), the GigE counterpart
+ * of the PhoXiAPI MovementCompensation example: every valid point (z != 0) is shifted back by
+ * `velocity` * its event time, the time the point was measured relative to the frame (Event component, one float
+ * per pixel, milliseconds). With `velocity` in mm/ms (= m/s) the points stay in millimeters.
+ *
+ * The Event map comes from a MotionCam-3D in Camera mode, enable it together with Range (Coord3D_ABC32f, i.e.
+ * Scan3dOutputMode CalibratedABC_Grid, or reconstruct ProjectedC range first).
+ */
+inline void compensateMotion(Vec3D* points, const float* eventTimes, uint32_t width, uint32_t height,
+                             const Vec3D& velocity, unsigned threads = 1) {
+    parallelRows(height, threads, [&](uint32_t firstRow, uint32_t endRow) {
+        const size_t offset = size_t(firstRow) * width;
+        detail::compensatePoints(points + offset, eventTimes + offset, size_t(endRow - firstRow) * width, velocity);
+    });
+}
+
+/*
+ * Compensates the Range part in place, i.e. the data of the buffer the views were mapped from (the application
+ * owns it until pushing the buffer back to the stream). Returns false if the parts do not match.
+ */
+inline bool compensateMotion(const PartView& range, const PartView& event, const Vec3D& velocity,
+                             unsigned threads = 1) {
+    if (!range || !event || range.width != event.width || range.height != event.height
+        || ARV_PIXEL_FORMAT_BIT_PER_PIXEL(range.pixelFormat) != 8 * sizeof(Vec3D)
+        || ARV_PIXEL_FORMAT_BIT_PER_PIXEL(event.pixelFormat) != 8 * sizeof(float)) {
+        std::cerr << "Error: Motion compensation needs Coord3D_ABC32f Range and a 32 bit float Event part of the "
+                     "same size!" << std::endl;
+        return false;
+    }
+
+    parallelRows(range.height, threads, [&](uint32_t firstRow, uint32_t endRow) {
+        for (uint32_t row = firstRow; row < endRow; ++row) {
+            detail::compensatePoints(const_cast<Vec3D*>(range.row<Vec3D>(row)), event.row<float>(row), range.width,
+                                     velocity);
+        }
+    });
+    return true;
+}
+
+}  // namespace pho
+
+#endif  // PHOTONEOMAIN_MOTIONCOMPENSATION_H
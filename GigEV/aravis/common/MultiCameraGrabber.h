@@ -0,0 +1,357 @@
+#ifndef PHOTONEOMAIN_MULTICAMERAGRABBER_H
+#define PHOTONEOMAIN_MULTICAMERAGRABBER_H
+
+#include "BufferArena.h"
+#include "PhoAravisCommon.h"
+#include "StreamStatistics.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+namespace pho {
+
+/* Restricts the calling thread to CPU `cpu`. Threads created by it afterwards inherit the affinity on Linux */
+inline bool pinCurrentThread(int cpu) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+    return cpu < 64 && SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) != 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+/* A camera to open, `cpu` < 0 leaves its receive threads unpinned */
+struct CameraSource {
+    std::string deviceIp;
+    int cpu = -1;
+};
+
+/**
+ * Acquisition from several cameras on one host. Each camera has its own stream, buffer pool (a BufferArena
+ * allocated by the receive thread, so on NUMA hosts the memory is local to its CPU) and receive thread
+ * which pops the buffers and hands them to the shared handler, tagged with the index of the camera in the list
+ * passed to open(). The receive thread is pinned to the CPU of its camera before it creates the stream, so on
+ * Linux the aravis stream thread (packet reception) inherits the pinning as well. Keep the cameras on different
+ * cores and away from the core handling the NIC interrupts.
+ *
+ * The handler is called concurrently from the receive threads and must be thread-safe; the buffer goes back to
+ * its stream when the handler returns. Incomplete buffers are counted as failed and not delivered.
+ *
+ *     MultiCameraGrabber grabber;
+ *     grabber.open({{"192.168.1.10", 2}, {"192.168.1.11", 3}});
+ *     ... configure grabber.camera(i) ...
+ *     grabber.start([](unsigned camera, ArvBuffer* buffer) { ... });
+ *     ...
+ *     grabber.stop();
+ */
+class MultiCameraGrabber {
+public:
+    using Handler = std::function<void(unsigned camera, ArvBuffer* buffer)>;
+
+    struct CameraStatistics {
+        std::string deviceIp;
+        int cpu = -1;
+        uint64_t received = 0;  // buffers popped from the stream
+        uint64_t delivered = 0; // handed to the handler
+        uint64_t failed = 0;    // status other than success
+        uint64_t bytes = 0;     // payload of the delivered buffers
+        TransportCounters transport; // underruns: frames dropped by aravis for lack of a free buffer
+    };
+
+    struct Statistics {
+        std::vector<CameraStatistics> cameras;
+        double seconds = 0.0; // since start()
+        uint64_t delivered = 0;
+        uint64_t dropped = 0; // failed buffers and underruns of all cameras
+        uint64_t bytes = 0;
+
+        double framesPerSecond() const { return seconds > 0.0 ? delivered / seconds : 0.0; }
+        double megabytesPerSecond() const { return seconds > 0.0 ? bytes / seconds / 1e6 : 0.0; }
+    };
+
+    explicit MultiCameraGrabber(size_t buffersPerCamera = 8, guint64 popTimeoutUs = 100000)
+            : _buffersPerCamera(std::max<size_t>(2, buffersPerCamera)), _popTimeoutUs(popTimeoutUs) {}
+
+    ~MultiCameraGrabber() { stop(); }
+
+    MultiCameraGrabber(const MultiCameraGrabber&) = delete;
+    MultiCameraGrabber& operator=(const MultiCameraGrabber&) = delete;
+
+    /* Connects to all cameras, fails if any of them cannot be opened */
+    bool open(const std::vector<CameraSource>& sources);
+
+    /*
+     * Creates the streams and buffer pools (current payload size of each camera) on the receive threads, then
+     * starts the acquisition on all cameras. Configure the cameras before calling this.
+     */
+    bool start(Handler handler);
+
+    /* Stops the acquisition on all cameras, joins the receive threads and destroys the streams */
+    void stop();
+
+    size_t size() const { return _cameras.size(); }
+    ArvCamera* camera(unsigned index) const { return _cameras[index]->camera.get(); }
+    ArvStream* stream(unsigned index) const { return _cameras[index]->stream.get(); }
+
+    Statistics statistics() const;
+    void print(std::ostream& out) const;
+
+private:
+    struct Camera {
+        CameraSource source;
+        std::unique_ptr<ArvCamera, void (*)(ArvCamera*)> camera{nullptr, gobject_destroyer<ArvCamera>};
+        BufferArena arena; // outlives the stream
+        std::unique_ptr<ArvStream, void (*)(ArvStream*)> stream{nullptr, gobject_destroyer<ArvStream>};
+        std::thread thread;
+        std::atomic<uint64_t> received{0};
+        std::atomic<uint64_t> delivered{0};
+        std::atomic<uint64_t> failed{0};
+        std::atomic<uint64_t> bytes{0};
+    };
+
+    enum class StreamState { Pending, Ready, Failed };
+
+    void receiveLoop(unsigned index);
+    bool createStream(Camera& camera);
+    void setStreamState(unsigned index, StreamState state);
+
+    size_t _buffersPerCamera;
+    guint64 _popTimeoutUs;
+    Handler _handler;
+    std::vector<std::unique_ptr<Camera>> _cameras;
+    std::atomic<bool> _running{false};
+    std::chrono::steady_clock::time_point _started;
+
+    std::mutex _mutex; // guards _streamStates during start()
+    std::condition_variable _streamsCreated;
+    std::vector<StreamState> _streamStates;
+};
+
+inline bool MultiCameraGrabber::open(const std::vector<CameraSource>& sources) {
+    stop();
+    _cameras.clear();
+
+    for (const auto& source : sources) {
+        auto camera = std::make_unique<Camera>();
+        camera->source = source;
+
+        GError* error = nullptr;
+        camera->camera.reset(arv_camera_new(source.deviceIp.c_str(), &error));
+        if (error || !ARV_IS_CAMERA(camera->camera.get())) {
+            std::cerr << "Error: Failed to connect to " << source.deviceIp << ": " << (error ? error->message : "")
+                      << std::endl;
+            g_clear_error(&error);
+            _cameras.clear();
+            return false;
+        }
+        if (arv_camera_is_gv_device(camera->camera.get())) {
+            arv_camera_gv_set_packet_size_adjustment(camera->camera.get(), ARV_GV_PACKET_SIZE_ADJUSTMENT_ALWAYS);
+        }
+        _cameras.push_back(std::move(camera));
+    }
+    return !_cameras.empty();
+}
+
+inline bool MultiCameraGrabber::start(Handler handler) {
+    if (_cameras.empty() || _running) {
+        return false;
+    }
+
+    _handler = std::move(handler);
+    _streamStates.assign(_cameras.size(), StreamState::Pending);
+    _running = true;
+    for (unsigned i = 0; i < _cameras.size(); ++i) {
+        Camera& camera = *_cameras[i];
+        camera.received = camera.delivered = camera.failed = camera.bytes = 0;
+        camera.thread = std::thread(&MultiCameraGrabber::receiveLoop, this, i);
+    }
+
+    /* The streams are created by the (pinned) receive threads */
+    bool created = true;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _streamsCreated.wait(lock, [&]() {
+            return std::none_of(_streamStates.begin(), _streamStates.end(),
+                                [](StreamState state) { return state == StreamState::Pending; });
+        });
+        created = std::all_of(_streamStates.begin(), _streamStates.end(),
+                              [](StreamState state) { return state == StreamState::Ready; });
+    }
+    if (!created) {
+        stop();
+        return false;
+    }
+
+    _started = std::chrono::steady_clock::now();
+    for (const auto& camera : _cameras) {
+        GError* error = nullptr;
+        arv_camera_start_acquisition(camera->camera.get(), &error);
+        if (error) {
+            std::cerr << "Error: Failed to start acquisition on " << camera->source.deviceIp << ": "
+                      << error->message << std::endl;
+            g_clear_error(&error);
+            stop();
+            return false;
+        }
+    }
+    return true;
+}
+
+inline void MultiCameraGrabber::stop() {
+    if (!_running) {
+        return;
+    }
+
+    for (const auto& camera : _cameras) {
+        if (camera->stream) {
+            arv_camera_stop_acquisition(camera->camera.get(), nullptr);
+        }
+    }
+    _running = false;
+    for (const auto& camera : _cameras) {
+        if (camera->thread.joinable()) {
+            camera->thread.join();
+        }
+    }
+    for (const auto& camera : _cameras) {
+        camera->stream.reset();
+    }
+}
+
+inline void MultiCameraGrabber::receiveLoop(unsigned index) {
+    Camera& camera = *_cameras[index];
+    if (camera.source.cpu >= 0 && !pinCurrentThread(camera.source.cpu)) {
+        std::cerr << "Warning: Failed to pin the receive thread of " << camera.source.deviceIp << " to CPU "
+                  << camera.source.cpu << std::endl;
+    }
+
+    const bool created = createStream(camera);
+    setStreamState(index, created ? StreamState::Ready : StreamState::Failed);
+    if (!created) {
+        return;
+    }
+
+    ArvStream* stream = camera.stream.get();
+    while (_running) {
+        ArvBuffer* buffer = arv_stream_timeout_pop_buffer(stream, _popTimeoutUs);
+        if (!buffer) {
+            continue;
+        }
+        camera.received.fetch_add(1, std::memory_order_relaxed);
+        if (arv_buffer_get_status(buffer) == ARV_BUFFER_STATUS_SUCCESS) {
+            size_t size = 0;
+            arv_buffer_get_data(buffer, &size);
+            if (_handler) {
+                _handler(index, buffer);
+            }
+            camera.delivered.fetch_add(1, std::memory_order_relaxed);
+            camera.bytes.fetch_add(size, std::memory_order_relaxed);
+        } else {
+            camera.failed.fetch_add(1, std::memory_order_relaxed);
+        }
+        arv_stream_push_buffer(stream, buffer);
+    }
+}
+
+inline bool MultiCameraGrabber::createStream(Camera& camera) {
+    GError* error = nullptr;
+    const size_t payload = arv_camera_get_payload(camera.camera.get(), &error);
+    if (error) {
+        std::cerr << "Error: Failed to obtain payload size of " << camera.source.deviceIp << ": " << error->message
+                  << std::endl;
+        g_clear_error(&error);
+        return false;
+    }
+
+    camera.stream.reset(arv_camera_create_stream(camera.camera.get(), nullptr, nullptr, &error));
+    if (error || !ARV_IS_STREAM(camera.stream.get())) {
+        std::cerr << "Error: Failed to create stream of " << camera.source.deviceIp << ": "
+                  << (error ? error->message : "") << std::endl;
+        g_clear_error(&error);
+        camera.stream.reset();
+        return false;
+    }
+
+    if (!camera.arena.allocate(payload, _buffersPerCamera)) {
+        camera.stream.reset();
+        return false;
+    }
+    camera.arena.pushBuffers(camera.stream.get());
+    return true;
+}
+
+inline void MultiCameraGrabber::setStreamState(unsigned index, StreamState state) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _streamStates[index] = state;
+    }
+    _streamsCreated.notify_all();
+}
+
+inline MultiCameraGrabber::Statistics MultiCameraGrabber::statistics() const {
+    Statistics statistics;
+    if (_running) {
+        statistics.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - _started).count();
+    }
+    for (const auto& camera : _cameras) {
+        CameraStatistics cameraStatistics;
+        cameraStatistics.deviceIp = camera->source.deviceIp;
+        cameraStatistics.cpu = camera->source.cpu;
+        cameraStatistics.received = camera->received;
+        cameraStatistics.delivered = camera->delivered;
+        cameraStatistics.failed = camera->failed;
+        cameraStatistics.bytes = camera->bytes;
+        cameraStatistics.transport = StreamStatistics::transport(camera->stream.get());
+
+        statistics.delivered += cameraStatistics.delivered;
+        statistics.dropped += cameraStatistics.failed + cameraStatistics.transport.underruns;
+        statistics.bytes += cameraStatistics.bytes;
+        statistics.cameras.push_back(std::move(cameraStatistics));
+    }
+    return statistics;
+}
+
+inline void MultiCameraGrabber::print(std::ostream& out) const {
+    const Statistics statistics = this->statistics();
+    /* The format of the caller's stream is restored at the end */
+    const std::ios_base::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(1);
+    for (size_t i = 0; i < statistics.cameras.size(); ++i) {
+        const auto& camera = statistics.cameras[i];
+        const double seconds = std::max(statistics.seconds, 1e-9);
+        out << "  [" << i << "] " << std::left << std::setw(16) << camera.deviceIp << std::right << " cpu "
+            << std::setw(3) << (camera.cpu >= 0 ? std::to_string(camera.cpu) : std::string("-"))
+            << " | " << std::setw(7) << camera.delivered / seconds << " fps " << std::setw(8)
+            << camera.bytes / seconds / 1e6 << " MB/s | failed " << camera.failed << ", underruns "
+            << camera.transport.underruns << ", missing packets " << camera.transport.missingPackets << std::endl;
+    }
+    out << "  Total: " << statistics.framesPerSecond() << " fps, " << statistics.megabytesPerSecond()
+        << " MB/s, " << statistics.dropped << " dropped" << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+}
+
+}  // namespace pho
+
+#endif  // PHOTONEOMAIN_MULTICAMERAGRABBER_H
@@ -0,0 +1,399 @@
+#ifndef PHOTONEOMAIN_MULTIPARTRECORDING_H
+#define PHOTONEOMAIN_MULTIPARTRECORDING_H
+
+#include "PhoAravisCommon.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace pho {
+
+/* Per-frame metadata, available both for live buffers and for replayed frames */
+struct FrameInfo {
+    guint64 frameId = 0;
+    guint64 timestampNs = 0;       // device timestamp
+    guint64 systemTimestampNs = 0; // host time when the frame was received
+};
+
+inline FrameInfo frameInfo(ArvBuffer* buffer) {
+    FrameInfo info;
+    info.frameId = arv_buffer_get_frame_id(buffer);
+    info.timestampNs = arv_buffer_get_timestamp(buffer);
+    info.systemTimestampNs = arv_buffer_get_system_timestamp(buffer);
+    return info;
+}
+
+/*
+ * Processing code written against this signature runs unchanged on live buffers
+ * (`views.map(buffer); handler(views, frameInfo(buffer));`) and on recordings (MultipartReplayer::play()).
+ */
+using FrameHandler = std::function<void(const MultipartViews& views, const FrameInfo& info)>;
+
+namespace recording {
+
+/*
+ * File layout (native endianness):
+ *     FileHeader, ComponentEntry[componentCount]
+ *     frames: FrameHeader, PartHeader[partCount], part data (each part starts at a 64 byte aligned file offset)
+ * Frames are only ever appended, a recording cut short (e.g. the process was killed) stays readable up to the
+ * last complete frame.
+ */
+constexpr char fileMagic[8] = {'P', 'H', 'O', 'M', 'P', 'R', 'E', 'C'};
+constexpr uint32_t fileVersion = 1;
+constexpr uint32_t frameMagic = 0x46524D50; // "PMRF"
+constexpr uint64_t dataAlignment = 64;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t componentCount;
+};
+
+struct ComponentEntry {
+    uint32_t outputMat;
+    uint32_t componentId;
+};
+
+struct FrameHeader {
+    uint32_t magic;
+    uint32_t partCount;
+    uint64_t frameId;
+    uint64_t timestampNs;
+    uint64_t systemTimestampNs;
+    uint64_t recordSize; // whole frame record including headers, data and padding
+};
+
+struct PartHeader {
+    uint32_t componentId;
+    uint32_t pixelFormat;
+    uint32_t width;
+    uint32_t height;
+    uint64_t stride;
+    uint64_t offset; // from the start of the frame record
+    uint64_t size;
+};
+
+static_assert(sizeof(FileHeader) == 16 && sizeof(ComponentEntry) == 8, "Unexpected recording header layout");
+static_assert(sizeof(FrameHeader) == 40 && sizeof(PartHeader) == 40, "Unexpected recording header layout");
+
+inline uint64_t alignUp(uint64_t value) {
+    return (value + dataAlignment - 1) / dataAlignment * dataAlignment;
+}
+
+}  // namespace recording
+
+/**
+ * Appends complete multipart buffers (all parts with component ID, pixel format, size and timestamps) to a file.
+ *
+ *     MultipartRecorder recorder;
+ *     recorder.open("capture.phorec", views); // views configured with MultipartViews::configure(camera)
+ *     ...
+ *     recorder.append(buffer);               // for every buffer popped from the stream
+ */
+class MultipartRecorder {
+public:
+    MultipartRecorder() = default;
+    ~MultipartRecorder() { close(); }
+
+    MultipartRecorder(const MultipartRecorder&) = delete;
+    MultipartRecorder& operator=(const MultipartRecorder&) = delete;
+
+    /* Creates (truncates) `path`. `views` provides the component ID -> component mapping used on replay */
+    bool open(const std::string& path, const MultipartViews& views) {
+        close();
+        _file = std::fopen(path.c_str(), "wb");
+        if (!_file) {
+            std::cerr << "Error: Failed to create " << path << std::endl;
+            return false;
+        }
+        /* Large stdio buffer, parts are written straight from the aravis buffers */
+        std::setvbuf(_file, nullptr, _IOFBF, 4 << 20);
+
+        _offset = 0;
+        _frameCount = 0;
+        const auto components = views.enabledComponents();
+        recording::FileHeader header{};
+        std::memcpy(header.magic, recording::fileMagic, sizeof(header.magic));
+        header.version = recording::fileVersion;
+        header.componentCount = static_cast<uint32_t>(components.size());
+        bool ok = write(&header, sizeof(header));
+        for (const auto& component : components) {
+            const recording::ComponentEntry entry{static_cast<uint32_t>(component.first), component.second};
+            ok = ok && write(&entry, sizeof(entry));
+        }
+        if (!ok) {
+            close();
+        }
+        return ok;
+    }
+
+    /*
+     * Appends all parts of a successfully received multipart buffer. A write error (e.g. disk full) closes the
+     * recorder, so no later frame is appended after a partial record. The replayer reads the file up to the first
+     * incomplete record.
+     */
+    bool append(ArvBuffer* buffer) {
+        if (!_file || !ARV_IS_BUFFER(buffer) || arv_buffer_get_status(buffer) != ARV_BUFFER_STATUS_SUCCESS
+            || arv_buffer_get_payload_type(buffer) != ARV_BUFFER_PAYLOAD_TYPE_MULTIPART) {
+            return false;
+        }
+
+        const guint partCount = arv_buffer_get_n_parts(buffer);
+        _parts.resize(partCount);
+        _partHeaders.resize(partCount);
+
+        const uint64_t frameStart = recording::alignUp(_offset);
+        uint64_t dataOffset = sizeof(recording::FrameHeader) + partCount * sizeof(recording::PartHeader);
+        for (guint part = 0; part < partCount; ++part) {
+            const PartView view = partView(buffer, part);
+            _parts[part] = view;
+            dataOffset = recording::alignUp(dataOffset); // frameStart is aligned too
+            auto& header = _partHeaders[part];
+            header.componentId = arv_buffer_get_part_component_id(buffer, part);
+            header.pixelFormat = view.pixelFormat;
+            header.width = view.width;
+            header.height = view.height;
+            header.stride = view.stride;
+            header.offset = dataOffset;
+            header.size = view.size;
+            dataOffset += view.size;
+        }
+
+        const FrameInfo info = frameInfo(buffer);
+        recording::FrameHeader frame{};
+        frame.magic = recording::frameMagic;
+        frame.partCount = partCount;
+        frame.frameId = info.frameId;
+        frame.timestampNs = info.timestampNs;
+        frame.systemTimestampNs = info.systemTimestampNs;
+        frame.recordSize = dataOffset;
+
+        bool ok = pad(frameStart) && write(&frame, sizeof(frame))
+                  && write(_partHeaders.data(), _partHeaders.size() * sizeof(recording::PartHeader));
+        for (guint part = 0; ok && part < partCount; ++part) {
+            ok = pad(frameStart + _partHeaders[part].offset) && write(_parts[part].data, _parts[part].size);
+        }
+        if (!ok) {
+            std::cerr << "Error: Failed to write frame " << info.frameId << ", recording stopped" << std::endl;
+            close();
+            return false;
+        }
+        ++_frameCount;
+        return true;
+    }
+
+    /* Returns false if the buffered data could not be written */
+    bool close() {
+        if (!_file) {
+            return true;
+        }
+        const bool ok = std::fclose(_file) == 0;
+        _file = nullptr;
+        if (!ok) {
+            std::cerr << "Error: Failed to write the end of the recording" << std::endl;
+        }
+        return ok;
+    }
+
+    bool isOpen() const { return _file != nullptr; }
+    size_t frameCount() const { return _frameCount; }
+    uint64_t bytesWritten() const { return _offset; }
+
+private:
+    bool write(const void* data, size_t size) {
+        if (size && std::fwrite(data, 1, size, _file) != size) {
+            return false;
+        }
+        _offset += size;
+        return true;
+    }
+
+    bool pad(uint64_t offset) {
+        static const char zeros[recording::dataAlignment] = {};
+        return write(zeros, size_t(offset - _offset));
+    }
+
+    std::FILE* _file = nullptr;
+    uint64_t _offset = 0;
+    size_t _frameCount = 0;
+    std::vector<PartView> _parts;
+    std::vector<recording::PartHeader> _partHeaders;
+};
+
+/**
+ * Memory-maps a file written by MultipartRecorder and feeds its frames to a FrameHandler. The views passed to
+ * the handler point directly into the mapping, no data is copied, and part data is 64 byte aligned.
+ *
+ *     MultipartReplayer replayer;
+ *     if (replayer.open("capture.phorec")) {
+ *         replayer.play(handler, MultipartReplayer::Speed::RealTime);
+ *     }
+ */
+class MultipartReplayer {
+public:
+    enum class Speed {
+        RealTime, // frames are delivered with the spacing of their device timestamps
+        Maximum,  // as fast as the handler consumes them
+    };
+
+    MultipartReplayer() = default;
+    ~MultipartReplayer() { close(); }
+
+    MultipartReplayer(const MultipartReplayer&) = delete;
+    MultipartReplayer& operator=(const MultipartReplayer&) = delete;
+
+    bool open(const std::string& path) {
+        close();
+        GError* error = nullptr;
+        _mapping = g_mapped_file_new(path.c_str(), FALSE, &error);
+        if (error) {
+            std::cerr << "Error: Failed to map " << path << ": " << error->message << std::endl;
+            g_clear_error(&error);
+            return false;
+        }
+        _data = reinterpret_cast<const uint8_t*>(g_mapped_file_get_contents(_mapping));
+        _size = g_mapped_file_get_length(_mapping);
+
+        if (!index()) {
+            std::cerr << "Error: " << path << " is not a multipart recording!" << std::endl;
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (_mapping) {
+            g_mapped_file_unref(_mapping);
+            _mapping = nullptr;
+        }
+        _data = nullptr;
+        _size = 0;
+        _frames.clear();
+        _components.clear();
+    }
+
+    size_t frameCount() const { return _frames.size(); }
+
+    /* Component ID -> component mapping of the recording, e.g. to configure own MultipartViews */
+    const std::vector<std::pair<OutputMat, guint32>>& components() const { return _components; }
+
+    /* Points `views` (configured from components()) to the parts of frame `index` */
+    bool frame(size_t index, MultipartViews& views, FrameInfo& info) const {
+        if (index >= _frames.size()) {
+            return false;
+        }
+        const uint8_t* record = _data + _frames[index];
+        const auto* frame = reinterpret_cast<const recording::FrameHeader*>(record);
+        const auto* parts = reinterpret_cast<const recording::PartHeader*>(frame + 1);
+
+        info.frameId = frame->frameId;
+        info.timestampNs = frame->timestampNs;
+        info.systemTimestampNs = frame->systemTimestampNs;
+
+        views.clear();
+        for (uint32_t part = 0; part < frame->partCount; ++part) {
+            PartView view;
+            view.data = record + parts[part].offset;
+            view.size = parts[part].size;
+            view.width = parts[part].width;
+            view.height = parts[part].height;
+            view.stride = parts[part].stride;
+            view.pixelFormat = parts[part].pixelFormat;
+            views.setView(parts[part].componentId, view);
+        }
+        return true;
+    }
+
+    /* Calls `handler` for every frame, `loops` times over the whole recording. Returns the number of frames played */
+    size_t play(const FrameHandler& handler, Speed speed = Speed::Maximum, size_t loops = 1) const {
+        MultipartViews views;
+        views.configure(_components);
+
+        size_t played = 0;
+        for (size_t loop = 0; loop < loops; ++loop) {
+            const auto start = std::chrono::steady_clock::now();
+            guint64 firstTimestamp = 0;
+            for (size_t index = 0; index < _frames.size(); ++index) {
+                FrameInfo info;
+                frame(index, views, info);
+                if (speed == Speed::RealTime) {
+                    const guint64 timestamp = info.timestampNs ? info.timestampNs : info.systemTimestampNs;
+                    if (index == 0) {
+                        firstTimestamp = timestamp;
+                    } else if (timestamp > firstTimestamp) {
+                        std::this_thread::sleep_until(start + std::chrono::nanoseconds(timestamp - firstTimestamp));
+                    }
+                }
+                handler(views, info);
+                ++played;
+            }
+        }
+        return played;
+    }
+
+private:
+    /* Validates the headers and collects the frame offsets, stops at the first incomplete frame */
+    bool index() {
+        recording::FileHeader header;
+        if (_size < sizeof(header)) {
+            return false;
+        }
+        std::memcpy(&header, _data, sizeof(header));
+        if (std::memcmp(header.magic, recording::fileMagic, sizeof(header.magic)) != 0
+            || header.version != recording::fileVersion) {
+            return false;
+        }
+
+        uint64_t offset = sizeof(header);
+        if (_size < offset + uint64_t(header.componentCount) * sizeof(recording::ComponentEntry)) {
+            return false;
+        }
+        for (uint32_t i = 0; i < header.componentCount; ++i) {
+            recording::ComponentEntry entry;
+            std::memcpy(&entry, _data + offset, sizeof(entry));
+            _components.emplace_back(static_cast<OutputMat>(entry.outputMat), entry.componentId);
+            offset += sizeof(entry);
+        }
+
+        while (true) {
+            offset = recording::alignUp(offset);
+            if (offset + sizeof(recording::FrameHeader) > _size) {
+                break;
+            }
+            const auto* frame = reinterpret_cast<const recording::FrameHeader*>(_data + offset);
+            const uint64_t headersSize = sizeof(recording::FrameHeader)
+                                         + uint64_t(frame->partCount) * sizeof(recording::PartHeader);
+            if (frame->magic != recording::frameMagic || frame->recordSize < headersSize
+                || offset + frame->recordSize > _size) {
+                break;
+            }
+            const auto* parts = reinterpret_cast<const recording::PartHeader*>(frame + 1);
+            bool valid = true;
+            for (uint32_t part = 0; part < frame->partCount; ++part) {
+                valid = valid && parts[part].offset >= headersSize && parts[part].offset <= frame->recordSize
+                        && parts[part].size <= frame->recordSize - parts[part].offset;
+            }
+            if (!valid) {
+                break;
+            }
+            _frames.push_back(offset);
+            offset += frame->recordSize;
+        }
+        return true;
+    }
+
+    GMappedFile* _mapping = nullptr;
+    const uint8_t* _data = nullptr;
+    size_t _size = 0;
+    std::vector<uint64_t> _frames; // file offsets of the complete frames
+    std::vector<std::pair<OutputMat, guint32>> _components;
+};
+
+}  // namespace pho
+
+#endif  // PHOTONEOMAIN_MULTIPARTRECORDING_H
@@ -0,0 +1,45 @@
+#ifndef PHOTONEOMAIN_PARALLELROWS_H
+#define PHOTONEOMAIN_PARALLELROWS_H
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace pho {
+
+/**
+ * Splits the rows [0, height) into at most `threads` contiguous bands and calls
+ * `rowsFunc(firstRow, endRow)` for each band.
+ *
+ * Band boundaries are multiples of `rowAlignment` (e.g. 2 for formats subsampled in
+ * the vertical direction). The first band runs on the calling thread, the others on
+ * short-lived std::threads which are joined before returning. With `threads` <= 1 the
+ * function is called once for the whole image on the calling thread.
+ */
+template <typename RowsFunc>
+void parallelRows(uint32_t height, unsigned threads, RowsFunc&& rowsFunc, uint32_t rowAlignment = 1) {
+    rowAlignment = std::max(1u, rowAlignment);
+    uint32_t band = (height + std::max(1u, threads) - 1) / std::max(1u, threads);
+    band = (band + rowAlignment - 1) / rowAlignment * rowAlignment;
+    if (threads <= 1 || band >= height) {
+        rowsFunc(uint32_t(0), height);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (uint32_t first = band; first < height; first += band) {
+        const uint32_t end = std::min(first + band, height);
+        workers.emplace_back([&rowsFunc, first, end]() { rowsFunc(first, end); });
+    }
+    rowsFunc(uint32_t(0), band);
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+}  // namespace pho
+
+#endif  // PHOTONEOMAIN_PARALLELROWS_H
@@ -2,9 +2,14 @@
 #define PHOTONEOMAIN_PHOARAVISCOMMON_H
 
 #include <arv.h>
+#include <glib/gstdio.h>
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <memory>
 #include <iostream>
+#include <string>
 #include <vector>
 
 namespace pho {
@@ -102,41 +107,41 @@ bool triggerFrame(ArvCamera* camera) {
     return true;
 }
 
-bool setOutputMat(ArvCamera* camera, OutputMat outputMat, bool state) {
-    if (!camera) {
-        return false;
-    }
-
-    GError* error = nullptr;
-    std::string selectorOption;
+/* Returns the ComponentSelector enumeration entry for the given component or nullptr */
+inline const char* componentSelectorName(OutputMat outputMat) {
     switch (outputMat) {
         case OutputMat::Intensity:
-            selectorOption = "Intensity";
-            break;
+            return "Intensity";
         case OutputMat::Range:
-            selectorOption = "Range";
-            break;
+            return "Range";
         case OutputMat::Normal:
-            selectorOption = "Normal";
-            break;
+            return "Normal";
         case OutputMat::CoordinateMapA:
-            selectorOption = "CoordinateMapA";
-            break;
+            return "CoordinateMapA";
         case OutputMat::CoordinateMapB:
-            selectorOption = "CoordinateMapB";
-            break;
+            return "CoordinateMapB";
         case OutputMat::Confidence:
-            selectorOption = "Confidence";
-            break;
+            return "Confidence";
         case OutputMat::Event:
-            selectorOption = "Event";
-            break;
+            return "Event";
         case OutputMat::ColorCameraImage:
-            selectorOption = "ColorCamera";
-            break;
+            return "ColorCamera";
         default:
-            return false;
+            return nullptr;
     }
+}
+
+bool setOutputMat(ArvCamera* camera, OutputMat outputMat, bool state) {
+    if (!camera) {
+        return false;
+    }
+
+    GError* error = nullptr;
+    const char* selectorName = componentSelectorName(outputMat);
+    if (!selectorName) {
+        return false;
+    }
+    const std::string selectorOption = selectorName;
 
     if(!arv_camera_is_enumeration_entry_available(camera, "ComponentSelector", selectorOption.c_str(), &error)) {
         std::cerr << "Warning: Camera does not support enumeration '" << selectorOption
@@ -164,6 +169,39 @@ bool setOutputMat(ArvCamera* camera, OutputMat outputMat, bool state) {
     return true;
 }
 
+/*
+ * Reads the ComponentIDValue of the given component, i.e. the ID identifying its part in multipart buffers.
+ * Returns false if the component is not available on the device.
+ */
+inline bool getComponentId(ArvCamera* camera, OutputMat outputMat, guint32& componentId) {
+    const char* selectorName = componentSelectorName(outputMat);
+    if (!camera || !selectorName) {
+        return false;
+    }
+
+    GError* error = nullptr;
+    if (!arv_camera_is_enumeration_entry_available(camera, "ComponentSelector", selectorName, &error) || error) {
+        g_clear_error(&error);
+        return false;
+    }
+
+    arv_camera_set_string(camera, "ComponentSelector", selectorName, &error);
+    if (error) {
+        std::cerr << "Error: " << error->message << std::endl;
+        g_clear_error(&error);
+        return false;
+    }
+
+    componentId = static_cast<guint32>(arv_camera_get_integer(camera, "ComponentIDValue", &error));
+    if (error) {
+        std::cerr << "Error: " << error->message << std::endl;
+        g_clear_error(&error);
+        return false;
+    }
+
+    return true;
+}
+
 bool setStreamOutputFormat(ArvCamera* camera, StreamOutputFormat format) {
     if (!camera) {
         return false;
@@ -191,6 +229,304 @@ bool setStreamOutputFormat(ArvCamera* camera, StreamOutputFormat format) {
     return true;
 }
 
+/*
+ * Non-owning view of one component (part) of a multipart buffer. Points directly into the buffer memory, so it
+ * is valid only until the buffer is pushed back to the stream.
+ */
+struct PartView {
+    const void* data = nullptr;
+    size_t size = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    size_t stride = 0; // bytes per row
+    ArvPixelFormat pixelFormat = 0;
+
+    explicit operator bool() const { return data != nullptr; }
+
+    template <typename T> const T* as() const { return static_cast<const T*>(data); }
+
+    template <typename T> const T* row(uint32_t rowIndex) const {
+        return reinterpret_cast<const T*>(static_cast<const uint8_t*>(data) + rowIndex * stride);
+    }
+};
+
+/* View of part `part` of a multipart buffer, the stride includes the horizontal padding of the part */
+inline PartView partView(ArvBuffer* buffer, guint part) {
+    PartView view;
+    view.data = arv_buffer_get_part_data(buffer, part, &view.size);
+    view.width = static_cast<uint32_t>(arv_buffer_get_part_width(buffer, part));
+    view.height = static_cast<uint32_t>(arv_buffer_get_part_height(buffer, part));
+    view.pixelFormat = arv_buffer_get_part_pixel_format(buffer, part);
+    const size_t bitsPerPixel = ARV_PIXEL_FORMAT_BIT_PER_PIXEL(view.pixelFormat);
+    if (bitsPerPixel % 8 == 0 && bitsPerPixel > 0) {
+        gint paddingX = 0, paddingY = 0;
+        arv_buffer_get_part_padding(buffer, part, &paddingX, &paddingY);
+        view.stride = view.width * bitsPerPixel / 8 + paddingX;
+    } else {
+        view.stride = view.height > 0 ? view.size / view.height : 0;
+    }
+    return view;
+}
+
+/*
+ * Typed access to the components of multipart buffers.
+ *
+ * configure() reads which components are enabled and their ComponentIDValue once. Parts are sent in increasing
+ * component ID order, so for each frame map() only confirms the expected part index of each enabled component
+ * (falling back to arv_buffer_find_component() if the layout differs) and fills the views. No data is copied.
+ *
+ *     MultipartViews views;
+ *     views.configure(camera);            // after enabling components, before acquisition
+ *     ...
+ *     if (views.map(buffer)) {
+ *         const PartView& range = views.range();
+ *         const Vec3D* points = range.as<Vec3D>();
+ *     }
+ */
+class MultipartViews {
+public:
+    static constexpr OutputMat components[] = {
+        Intensity, Range, Confidence, CoordinateMapA, CoordinateMapB, Normal, Event, ColorCameraImage
+    };
+    static constexpr size_t componentCount = sizeof(components) / sizeof(components[0]);
+
+    /* Reads ComponentEnable and ComponentIDValue of all components available on the device */
+    bool configure(ArvCamera* camera) {
+        _enabled.clear();
+        clear();
+
+        GError* error = nullptr;
+        for (size_t slot = 0; slot < componentCount; ++slot) {
+            guint32 componentId = 0;
+            if (!getComponentId(camera, components[slot], componentId)) {
+                continue; /* not available on this device */
+            }
+            const bool enabled = arv_camera_get_boolean(camera, "ComponentEnable", &error);
+            if (error) {
+                std::cerr << "Error: " << error->message << std::endl;
+                g_clear_error(&error);
+                return false;
+            }
+            if (enabled) {
+                _enabled.push_back({componentId, slot});
+            }
+        }
+
+        std::sort(_enabled.begin(), _enabled.end(), [](const EnabledComponent& a, const EnabledComponent& b) {
+            return a.componentId < b.componentId;
+        });
+        return !_enabled.empty();
+    }
+
+    /* Points the views to the parts of `buffer`. Returns false if it is not a multipart buffer */
+    bool map(ArvBuffer* buffer) {
+        clear();
+        if (!ARV_IS_BUFFER(buffer) || arv_buffer_get_payload_type(buffer) != ARV_BUFFER_PAYLOAD_TYPE_MULTIPART) {
+            return false;
+        }
+
+        const guint nparts = arv_buffer_get_n_parts(buffer);
+        for (guint i = 0; i < _enabled.size(); ++i) {
+            const auto& component = _enabled[i];
+            gint part = static_cast<gint>(i);
+            if (i >= nparts || arv_buffer_get_part_component_id(buffer, i) != component.componentId) {
+                part = arv_buffer_find_component(buffer, component.componentId);
+                if (part < 0) {
+                    continue;
+                }
+            }
+
+            _views[component.slot] = partView(buffer, static_cast<guint>(part));
+        }
+        return true;
+    }
+
+    /* Enabled components and their IDs, e.g. to store them next to recorded buffers */
+    std::vector<std::pair<OutputMat, guint32>> enabledComponents() const {
+        std::vector<std::pair<OutputMat, guint32>> result;
+        for (const auto& component : _enabled) {
+            result.emplace_back(components[component.slot], component.componentId);
+        }
+        return result;
+    }
+
+    /* Same as configure(camera), from a list returned by enabledComponents() */
+    bool configure(const std::vector<std::pair<OutputMat, guint32>>& enabledComponents) {
+        _enabled.clear();
+        clear();
+        for (const auto& component : enabledComponents) {
+            const size_t slot = slotOf(component.first);
+            if (slot < componentCount) {
+                _enabled.push_back({component.second, slot});
+            }
+        }
+        std::sort(_enabled.begin(), _enabled.end(), [](const EnabledComponent& a, const EnabledComponent& b) {
+            return a.componentId < b.componentId;
+        });
+        return !_enabled.empty();
+    }
+
+    /* Views of parts which do not come from an ArvBuffer (e.g. replayed from a file): clear(), then setView() */
+    void clear() {
+        for (auto& view : _views) {
+            view = PartView();
+        }
+    }
+
+    /* Returns false if no enabled component has `componentId` */
+    bool setView(guint32 componentId, const PartView& view) {
+        for (const auto& component : _enabled) {
+            if (component.componentId == componentId) {
+                _views[component.slot] = view;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /* Index of the component in `components` (componentCount if unknown) */
+    static constexpr size_t slotOf(OutputMat outputMat) {
+        for (size_t slot = 0; slot < componentCount; ++slot) {
+            if (components[slot] == outputMat) {
+                return slot;
+            }
+        }
+        return componentCount;
+    }
+
+    /* Returns an empty view if the component is not part of the last mapped buffer */
+    const PartView& view(OutputMat outputMat) const {
+        static const PartView empty;
+        const size_t slot = slotOf(outputMat);
+        return slot < componentCount ? _views[slot] : empty;
+    }
+
+    const PartView& intensity() const { return _views[slotOf(Intensity)]; }
+    const PartView& range() const { return _views[slotOf(Range)]; }
+    const PartView& confidence() const { return _views[slotOf(Confidence)]; }
+    const PartView& normal() const { return _views[slotOf(Normal)]; }
+    const PartView& event() const { return _views[slotOf(Event)]; }
+
+    bool isEnabled(OutputMat outputMat) const {
+        for (const auto& component : _enabled) {
+            if (components[component.slot] == outputMat) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    struct EnabledComponent {
+        guint32 componentId;
+        size_t slot;
+    };
+
+    std::vector<EnabledComponent> _enabled; // sorted by component ID, i.e. in part order
+    std::array<PartView, componentCount> _views;
+};
+
+/* Timing of connectCamera() */
+struct ConnectReport {
+    double connectMs = 0.0; // arv_camera_new(): device lookup, GenICam XML download and parsing
+    size_t xmlSize = 0;
+};
+
+/*
+ * Connects to the device like arv_camera_new() and reports how long it took. aravis 0.8 downloads and parses the
+ * GenICam XML inside arv_camera_new() and has no public way to create a GigE Vision device from a local file, so
+ * the XML is downloaded on every connect. See exportGenicamXml() for keeping a copy for offline tools.
+ */
+inline ArvCamera* connectCamera(const char* deviceIp, GError** error, ConnectReport* report = nullptr) {
+    const auto start = std::chrono::steady_clock::now();
+    ArvCamera* camera = arv_camera_new(deviceIp, error);
+    if (report) {
+        *report = ConnectReport();
+        report->connectMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (ARV_IS_CAMERA(camera)) {
+            arv_device_get_genicam_xml(arv_camera_get_device(camera), &report->xmlSize);
+        }
+    }
+    return camera;
+}
+
+/* Default directory of exportGenicamXml() */
+inline std::string genicamExportDirectory() {
+    gchar* path = g_build_filename(g_get_user_cache_dir(), "photoneo", "genicam", nullptr);
+    std::string directory = path;
+    g_free(path);
+    return directory;
+}
+
+/* File name prefix of all exported XML files of one model and firmware version, safe for any file system */
+inline std::string genicamExportPrefix(const std::string& model, const std::string& firmware) {
+    std::string prefix = model + "_" + firmware + "_";
+    for (char& c : prefix) {
+        if (!g_ascii_isalnum(c) && c != '.' && c != '-') {
+            c = '_';
+        }
+    }
+    return prefix;
+}
+
+/*
+ * Writes the GenICam XML of a connected device to `directory`, named by model, firmware version and SHA-1 of the
+ * XML, for tools working without the device (arv_gc_new() parses the file offline). A file of the same model and
+ * firmware with a different checksum is replaced, an identical one is kept. Returns false if the XML is not
+ * available or the file could not be written, `file` receives the path.
+ */
+inline bool exportGenicamXml(ArvCamera* camera, const std::string& directory = genicamExportDirectory(),
+                             std::string* file = nullptr) {
+    size_t size = 0;
+    const char* xml = arv_device_get_genicam_xml(arv_camera_get_device(camera), &size);
+    if (!xml || size == 0) {
+        std::cerr << "Error: The device did not provide its GenICam XML" << std::endl;
+        return false;
+    }
+
+    const char* model = arv_camera_get_model_name(camera, nullptr);
+    const char* firmware = arv_camera_is_feature_available(camera, "DeviceFirmwareVersion", nullptr)
+                                   ? arv_camera_get_string(camera, "DeviceFirmwareVersion", nullptr)
+                                   : arv_camera_get_string(camera, "DeviceVersion", nullptr);
+    const std::string prefix = genicamExportPrefix(model ? model : "unknown", firmware ? firmware : "unknown");
+
+    gchar* checksum = g_compute_checksum_for_data(G_CHECKSUM_SHA1, reinterpret_cast<const guchar*>(xml), size);
+    gchar* path = g_build_filename(directory.c_str(), (prefix + checksum + ".xml").c_str(), nullptr);
+    if (file) {
+        *file = path;
+    }
+
+    bool ok = g_file_test(path, G_FILE_TEST_IS_REGULAR);
+    if (!ok && g_mkdir_with_parents(directory.c_str(), 0755) == 0) {
+        /* A stale file of the same model and firmware (e.g. device XML updated) is replaced */
+        const std::string hex(checksum);
+        const auto isExport = [&](const std::string& name) {
+            return name.size() == prefix.size() + hex.size() + 4 && name.compare(0, prefix.size(), prefix) == 0
+                   && name.compare(name.size() - 4, 4, ".xml") == 0
+                   && std::all_of(name.begin() + prefix.size(), name.end() - 4,
+                                  [](char c) { return g_ascii_isxdigit(c) != 0; });
+        };
+        if (GDir* dir = g_dir_open(directory.c_str(), 0, nullptr)) {
+            while (const gchar* name = g_dir_read_name(dir)) {
+                if (isExport(name)) {
+                    gchar* stale = g_build_filename(directory.c_str(), name, nullptr);
+                    g_remove(stale);
+                    g_free(stale);
+                }
+            }
+            g_dir_close(dir);
+        }
+        /* Written atomically, concurrent exports never see a partial file */
+        ok = g_file_set_contents(path, xml, gssize(size), nullptr);
+    }
+    if (!ok) {
+        std::cerr << "Error: Failed to write GenICam XML file " << path << std::endl;
+    }
+    g_free(path);
+    g_free(checksum);
+    return ok;
+}
+
 } //namespace pho
 
 #endif  // PHOTONEOMAIN_PHOARAVISCOMMON_H
@@ -0,0 +1,393 @@
+#ifndef PHOTONEOMAIN_PROJECTEDC_H
+#define PHOTONEOMAIN_PROJECTEDC_H
+
+#include "PhoAravisCommon.h"
+#include "ParallelRows.h"
+#include "SimdHelpers.h"
+
+#include <cstring>
+#include <list>
+#include <string>
+#include <utility>
+
+namespace pho {
+
+namespace detail {
+
+// x = z * factorX, y = z * factorY, z = z. Invalid points (z = 0) end up at (0, 0, 0).
+inline void reconstructPoints(const float* range, const float* factorX, const float* factorY, size_t count,
+                              Vec3D* points) {
+    size_t i = 0;
+#if defined(PHO_SIMD_SSE2)
+    for (; i + 4 <= count; i += 4) {
+        const __m128 z = _mm_loadu_ps(range + i);
+        simd::storeVec3D4(&points[i].x, _mm_mul_ps(z, _mm_loadu_ps(factorX + i)),
+                          _mm_mul_ps(z, _mm_loadu_ps(factorY + i)), z);
+    }
+#endif
+    for (; i < count; ++i) {
+        points[i].x = range[i] * factorX[i];
+        points[i].y = range[i] * factorY[i];
+        points[i].z = range[i];
+    }
+}
+
+}  // namespace detail
+
+/**
+ * Reconstructs point clouds from the `Range` component in the `ProjectedC` Scan3dOutputMode.
+ *
+ * The static coordinate maps (`CoordinateMapA` / `CoordinateMapB` components) and the `Scan3dFocalLength`,
+ * `Scan3dAspectRatio`, `Scan3dPrincipalPointU` and `Scan3dPrincipalPointV` features are fetched once per settings
+ * state and folded into two per-pixel factors, so the per-frame work is a single pass of two multiplications per
+ * point:
+ *
+ *     x = range * (coordMapA - Scan3dPrincipalPointU) / Scan3dFocalLength
+ *     y = range * (coordMapB - Scan3dPrincipalPointV) / (Scan3dFocalLength * Scan3dAspectRatio)
+ *     z = range
+ *
+ * The settings state is identified by the values of the features from `settingsFeatures` (those the maps depend
+ * on). prepare() reads them and reuses cached maps for a known state, so switching between a few recipes does not
+ * fetch the maps again.
+ */
+class ProjectedCReconstructor {
+public:
+    // Features which change the coordinate maps or the projection parameters.
+    static std::vector<std::string> defaultSettingsFeatures() {
+        return {"Width", "Height", "Resolution", "CameraResolution", "OperationMode", "CameraSpace",
+                "Scan3dFocalLength", "Scan3dAspectRatio", "Scan3dPrincipalPointU", "Scan3dPrincipalPointV"};
+    }
+
+    explicit ProjectedCReconstructor(std::vector<std::string> settingsFeatures = defaultSettingsFeatures(),
+                                     size_t maxCachedStates = 4)
+            : _settingsFeatures(std::move(settingsFeatures)), _maxCachedStates(std::max<size_t>(1, maxCachedStates)) {}
+
+    /*
+     * Activates the coordinate maps for the current device settings. Call once after connecting and again after
+     * changing settings.
+     *
+     * On a cache miss the maps are grabbed with a temporary stream: CoordinateMapA / CoordinateMapB are enabled
+     * for a single frame (triggered if software trigger is set up) and disabled again afterwards. The camera must
+     * not be acquiring at that time, i.e. call this before creating the application stream or after stopping it.
+     */
+    bool prepare(ArvCamera* camera, guint64 timeoutUs = 5000000);
+
+    /*
+     * Same as above, but takes the coordinate maps from `buffer` on a cache miss (for applications streaming
+     * CoordinateMapA / CoordinateMapB along with the other components whenever settings change).
+     */
+    bool prepare(ArvCamera* camera, ArvBuffer* buffer);
+
+    bool isReady() const { return _active != nullptr; }
+    uint32_t width() const { return _active ? _active->width : 0; }
+    uint32_t height() const { return _active ? _active->height : 0; }
+
+    /*
+     * Converts `width` x `height` range values (Coord3D_C32f) into points stored to `pointCloud`, with
+     * `threads` > 1 the rows are split between that many threads. The size must match the prepared maps.
+     */
+    bool reconstruct(const float* range, uint32_t width, uint32_t height, Vec3D* pointCloud, unsigned threads = 1) const;
+
+    // Converts the Range part of a multipart buffer.
+    bool reconstruct(ArvBuffer* buffer, Vec3D* pointCloud, unsigned threads = 1) const;
+
+    // Converts a Range view (see MultipartViews).
+    bool reconstruct(const PartView& range, Vec3D* pointCloud, unsigned threads = 1) const;
+
+    // Drops all cached maps, the next prepare() fetches them again.
+    void clearCache() {
+        _cache.clear();
+        _active.reset();
+    }
+
+private:
+    struct CoordinateMaps {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<float> factorX;
+        std::vector<float> factorY;
+    };
+    using CoordinateMapsPtr = std::shared_ptr<const CoordinateMaps>;
+
+    bool activateCached(const std::string& settingsKey);
+    void insertCache(const std::string& settingsKey, CoordinateMapsPtr maps);
+    std::string readSettingsKey(ArvCamera* camera) const;
+    bool resolveComponentIds(ArvCamera* camera);
+    CoordinateMapsPtr buildMaps(ArvCamera* camera, ArvBuffer* buffer) const;
+    CoordinateMapsPtr grabMaps(ArvCamera* camera, guint64 timeoutUs) const;
+
+    std::vector<std::string> _settingsFeatures;
+    size_t _maxCachedStates;
+    std::list<std::pair<std::string, CoordinateMapsPtr>> _cache; // most recently used first
+    CoordinateMapsPtr _active;
+    guint32 _rangeId = OutputMat::Range;
+    guint32 _coordinateMapAId = OutputMat::CoordinateMapA;
+    guint32 _coordinateMapBId = OutputMat::CoordinateMapB;
+};
+
+inline bool ProjectedCReconstructor::prepare(ArvCamera* camera, guint64 timeoutUs) {
+    if (!camera || !resolveComponentIds(camera)) {
+        return false;
+    }
+
+    const std::string settingsKey = readSettingsKey(camera);
+    if (activateCached(settingsKey)) {
+        return true;
+    }
+
+    auto maps = grabMaps(camera, timeoutUs);
+    if (!maps) {
+        return false;
+    }
+    insertCache(settingsKey, std::move(maps));
+    return true;
+}
+
+inline bool ProjectedCReconstructor::prepare(ArvCamera* camera, ArvBuffer* buffer) {
+    if (!camera || !resolveComponentIds(camera)) {
+        return false;
+    }
+
+    const std::string settingsKey = readSettingsKey(camera);
+    if (activateCached(settingsKey)) {
+        return true;
+    }
+
+    auto maps = buildMaps(camera, buffer);
+    if (!maps) {
+        return false;
+    }
+    insertCache(settingsKey, std::move(maps));
+    return true;
+}
+
+inline bool ProjectedCReconstructor::reconstruct(const float* range, uint32_t width, uint32_t height,
+                                                 Vec3D* pointCloud, unsigned threads) const {
+    if (!_active || !range || !pointCloud || width != _active->width || height != _active->height) {
+        std::cerr << "Error: Range size does not match the coordinate maps!" << std::endl;
+        return false;
+    }
+
+    const CoordinateMaps& maps = *_active;
+    parallelRows(height, threads, [&](uint32_t firstRow, uint32_t endRow) {
+        const size_t offset = size_t(firstRow) * width;
+        detail::reconstructPoints(range + offset, maps.factorX.data() + offset, maps.factorY.data() + offset,
+                                  size_t(endRow - firstRow) * width, pointCloud + offset);
+    });
+    return true;
+}
+
+inline bool ProjectedCReconstructor::reconstruct(ArvBuffer* buffer, Vec3D* pointCloud, unsigned threads) const {
+    const gint part = arv_buffer_find_component(buffer, _rangeId);
+    if (part < 0) {
+        std::cerr << "Error: Buffer does not contain the Range component!" << std::endl;
+        return false;
+    }
+
+    return reconstruct(partView(buffer, guint(part)), pointCloud, threads);
+}
+
+inline bool ProjectedCReconstructor::reconstruct(const PartView& range, Vec3D* pointCloud, unsigned threads) const {
+    /* Rows may be padded, a view without a stride is taken as unpadded */
+    const size_t rowBytes = size_t(range.width) * sizeof(float);
+    const size_t stride = range.stride ? range.stride : rowBytes;
+    if (!range || range.height == 0 || stride < rowBytes || range.size < stride * (range.height - 1) + rowBytes) {
+        std::cerr << "Error: Unexpected Range part size, is Scan3dOutputMode set to ProjectedC?" << std::endl;
+        return false;
+    }
+    if (stride == rowBytes) {
+        return reconstruct(range.as<float>(), range.width, range.height, pointCloud, threads);
+    }
+
+    if (!_active || !pointCloud || range.width != _active->width || range.height != _active->height) {
+        std::cerr << "Error: Range size does not match the coordinate maps!" << std::endl;
+        return false;
+    }
+
+    const CoordinateMaps& maps = *_active;
+    parallelRows(range.height, threads, [&](uint32_t firstRow, uint32_t endRow) {
+        for (uint32_t row = firstRow; row < endRow; ++row) {
+            const size_t offset = size_t(row) * range.width;
+            detail::reconstructPoints(range.row<float>(row), maps.factorX.data() + offset,
+                                      maps.factorY.data() + offset, range.width, pointCloud + offset);
+        }
+    });
+    return true;
+}
+
+inline bool ProjectedCReconstructor::activateCached(const std::string& settingsKey) {
+    for (auto it = _cache.begin(); it != _cache.end(); ++it) {
+        if (it->first == settingsKey) {
+            _cache.splice(_cache.begin(), _cache, it);
+            _active = _cache.front().second;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline void ProjectedCReconstructor::insertCache(const std::string& settingsKey, CoordinateMapsPtr maps) {
+    _active = maps;
+    _cache.emplace_front(settingsKey, std::move(maps));
+    while (_cache.size() > _maxCachedStates) {
+        _cache.pop_back();
+    }
+}
+
+inline std::string ProjectedCReconstructor::readSettingsKey(ArvCamera* camera) const {
+    ArvDevice* device = arv_camera_get_device(camera);
+    std::string key;
+    for (const auto& feature : _settingsFeatures) {
+        key += feature;
+        key += '=';
+        ArvGcNode* node = arv_device_get_feature(device, feature.c_str());
+        if (ARV_IS_GC_FEATURE_NODE(node)) {
+            GError* error = nullptr;
+            const char* value = arv_gc_feature_node_get_value_as_string(ARV_GC_FEATURE_NODE(node), &error);
+            if (!error && value) {
+                key += value;
+            }
+            g_clear_error(&error);
+        }
+        key += ';';
+    }
+    return key;
+}
+
+inline bool ProjectedCReconstructor::resolveComponentIds(ArvCamera* camera) {
+    if (!getComponentId(camera, Range, _rangeId)
+        || !getComponentId(camera, CoordinateMapA, _coordinateMapAId)
+        || !getComponentId(camera, CoordinateMapB, _coordinateMapBId)) {
+        std::cerr << "Error: Device does not provide Range and coordinate map components!" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+inline ProjectedCReconstructor::CoordinateMapsPtr ProjectedCReconstructor::buildMaps(ArvCamera* camera,
+                                                                                     ArvBuffer* buffer) const {
+    if (!ARV_IS_BUFFER(buffer) || arv_buffer_get_status(buffer) != ARV_BUFFER_STATUS_SUCCESS) {
+        std::cerr << "Error: Invalid buffer with coordinate maps!" << std::endl;
+        return nullptr;
+    }
+
+    const gint partA = arv_buffer_find_component(buffer, _coordinateMapAId);
+    const gint partB = arv_buffer_find_component(buffer, _coordinateMapBId);
+    if (partA < 0 || partB < 0) {
+        std::cerr << "Error: Buffer does not contain CoordinateMapA and CoordinateMapB!" << std::endl;
+        return nullptr;
+    }
+
+    /* Views with the stride of the parts, rows may be padded */
+    const PartView mapA = partView(buffer, guint(partA));
+    const PartView mapB = partView(buffer, guint(partB));
+    auto maps = std::make_shared<CoordinateMaps>();
+    maps->width = mapA.width;
+    maps->height = mapA.height;
+    const size_t pixels = size_t(maps->width) * maps->height;
+
+    const size_t rowBytes = size_t(maps->width) * sizeof(float);
+    const auto fits = [&](const PartView& map) {
+        return map && map.width == maps->width && map.height == maps->height && map.stride >= rowBytes
+               && map.size >= map.stride * (map.height - 1) + rowBytes;
+    };
+    if (pixels == 0 || !fits(mapA) || !fits(mapB)) {
+        std::cerr << "Error: Unexpected coordinate map size!" << std::endl;
+        return nullptr;
+    }
+
+    GError* error = nullptr;
+    const double focalLength = arv_camera_get_float(camera, "Scan3dFocalLength", &error);
+    const double aspectRatio = error ? 0.0 : arv_camera_get_float(camera, "Scan3dAspectRatio", &error);
+    const double principalPointU = error ? 0.0 : arv_camera_get_float(camera, "Scan3dPrincipalPointU", &error);
+    const double principalPointV = error ? 0.0 : arv_camera_get_float(camera, "Scan3dPrincipalPointV", &error);
+    if (error) {
+        std::cerr << "Error: Failed to read Scan3d parameters: " << error->message << std::endl;
+        g_clear_error(&error);
+        return nullptr;
+    }
+    if (focalLength == 0.0 || aspectRatio == 0.0) {
+        std::cerr << "Error: Invalid Scan3dFocalLength / Scan3dAspectRatio!" << std::endl;
+        return nullptr;
+    }
+
+    const auto scaleX = static_cast<float>(1.0 / focalLength);
+    const auto scaleY = static_cast<float>(1.0 / (focalLength * aspectRatio));
+    const auto u = static_cast<float>(principalPointU);
+    const auto v = static_cast<float>(principalPointV);
+    maps->factorX.resize(pixels);
+    maps->factorY.resize(pixels);
+    for (uint32_t row = 0; row < maps->height; ++row) {
+        const float* a = mapA.row<float>(row);
+        const float* b = mapB.row<float>(row);
+        float* factorX = maps->factorX.data() + size_t(row) * maps->width;
+        float* factorY = maps->factorY.data() + size_t(row) * maps->width;
+        for (uint32_t column = 0; column < maps->width; ++column) {
+            factorX[column] = (a[column] - u) * scaleX;
+            factorY[column] = (b[column] - v) * scaleY;
+        }
+    }
+    return maps;
+}
+
+inline ProjectedCReconstructor::CoordinateMapsPtr ProjectedCReconstructor::grabMaps(ArvCamera* camera,
+                                                                                    guint64 timeoutUs) const {
+    GError* error = nullptr;
+    auto isEnabled = [&](OutputMat outputMat) {
+        arv_camera_set_string(camera, "ComponentSelector", componentSelectorName(outputMat), &error);
+        const bool enabled = !error && arv_camera_get_boolean(camera, "ComponentEnable", &error);
+        g_clear_error(&error);
+        return enabled;
+    };
+    const bool mapAEnabled = isEnabled(CoordinateMapA);
+    const bool mapBEnabled = isEnabled(CoordinateMapB);
+    const bool multipart = arv_camera_gv_get_multipart(camera, &error);
+    const bool multipartKnown = !error;
+    g_clear_error(&error);
+
+    /* Every exit below goes through the restore of the components and the output format at the end */
+    CoordinateMapsPtr maps;
+    const bool enabled = setOutputMat(camera, CoordinateMapA, true) && setOutputMat(camera, CoordinateMapB, true)
+                         && setStreamOutputFormat(camera, StreamOutputFormat::MultipartData);
+
+    const size_t payload = enabled ? arv_camera_get_payload(camera, &error) : 0;
+    auto stream = create_gobject_unique(enabled && !error ? arv_camera_create_stream(camera, nullptr, nullptr, &error)
+                                                          : nullptr);
+    const bool streaming = enabled && !error && ARV_IS_STREAM(stream.get());
+    if (streaming) {
+        arv_stream_push_buffer(stream.get(), arv_buffer_new(payload, nullptr));
+        arv_camera_start_acquisition(camera, &error);
+    }
+
+    if (streaming && !error) {
+        const char* triggerMode = arv_camera_get_string(camera, "TriggerMode", nullptr);
+        const char* triggerSource = arv_camera_get_string(camera, "TriggerSource", nullptr);
+        if (triggerMode && triggerSource && !strcmp(triggerMode, "On") && !strcmp(triggerSource, "Software")) {
+            triggerFrame(camera);
+        }
+
+        auto buffer = create_gobject_unique(arv_stream_timeout_pop_buffer(stream.get(), timeoutUs));
+        if (buffer) {
+            maps = buildMaps(camera, buffer.get());
+        } else {
+            std::cerr << "Error: Timeout while waiting for the coordinate maps!" << std::endl;
+        }
+        arv_camera_stop_acquisition(camera, nullptr);
+    }
+
+    if (error) {
+        std::cerr << "Error: " << error->message << std::endl;
+        g_clear_error(&error);
+    }
+
+    setOutputMat(camera, CoordinateMapA, mapAEnabled);
+    setOutputMat(camera, CoordinateMapB, mapBEnabled);
+    if (multipartKnown) {
+        setStreamOutputFormat(camera, multipart ? StreamOutputFormat::MultipartData : StreamOutputFormat::ImageData);
+    }
+    return maps;
+}
+
+}  // namespace pho
+
+#endif  // PHOTONEOMAIN_PROJECTEDC_H
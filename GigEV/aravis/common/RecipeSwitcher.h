@@ -0,0 +1,229 @@
+#ifndef PHOTONEOMAIN_RECIPESWITCHER_H
+#define PHOTONEOMAIN_RECIPESWITCHER_H
+
+#include "DeviceConfig.h"
+
+#include <chrono>
+#include <string>
+
+namespace pho {
+
+/* A named device configuration stored in one of the device UserSets ("UserSet0", "UserSet1", ...) */
+struct Recipe {
+    std::string userSet;
+    std::string description;
+    DeviceConfig config;
+};
+
+struct SwitchReport {
+    double stopMs = 0.0;          // acquisition stop and draining of the buffers of the previous recipe
+    double loadMs = 0.0;          // UserSetSelector + UserSetLoad
+    double startMs = 0.0;         // payload check and acquisition start
+    double totalMs = 0.0;
+    size_t drained = 0;           // completed buffers of the previous recipe returned to the stream
+    bool payloadChanged = false;
+    bool buffersTooSmall = false; // the stream buffers must be re-created, the acquisition was not restarted
+    guint payload = 0;
+};
+
+/**
+ * Switches between recipes pre-stored in device UserSets. A switch is one UserSetLoad instead of writing every
+ * feature, the stream and its buffers stay as they are: the acquisition is stopped, the recipe loaded, the
+ * payload size checked and the acquisition started again. Only when the new payload does not fit the buffers the
+ * caller has to re-create them (switchTo() returns with `buffersTooSmall` set and the acquisition stopped).
+ * Allocating the buffers for the largest recipe payload avoids that completely.
+ *
+ *     RecipeSwitcher switcher(camera, stream);
+ *     switcher.store({"UserSet0", "Camera mode", cameraConfig});
+ *     switcher.store({"UserSet1", "Scanner mode", scannerConfig});
+ *     ...
+ *     switcher.switchTo("UserSet1", true, &report);
+ */
+class RecipeSwitcher {
+public:
+    /* `stream` is optional, when given, buffers completed before the switch are returned to it */
+    explicit RecipeSwitcher(ArvCamera* camera, ArvStream* stream = nullptr)
+            : _camera(camera), _stream(stream), _configurator(camera) {}
+
+    /* Applies the recipe configuration and saves it to its UserSet, the acquisition must be stopped */
+    bool store(const Recipe& recipe, ApplyReport* report = nullptr);
+
+    /*
+     * Loads the recipe stored in `userSet`. With `acquiring` set, the running acquisition is stopped before and
+     * started again after the load, unless the new payload does not fit the buffers.
+     */
+    bool switchTo(const std::string& userSet, bool acquiring, SwitchReport* report = nullptr);
+
+    const std::string& current() const { return _current; }
+
+    /* Payload size of the current recipe, 0 before the first store() or switchTo() */
+    guint payload() const { return _payload; }
+
+    /*
+     * Size of the stream buffers, 0 (default) if they were allocated for the payload of the configuration active
+     * when the first switchTo() is called, or for the new payload after a switch reported `buffersTooSmall`
+     */
+    void setBufferSize(size_t bytes) { _bufferSize = bytes; }
+
+private:
+    bool select(const std::string& userSet);
+    bool execute(const char* command);
+    size_t drain();
+
+    ArvCamera* _camera;
+    ArvStream* _stream;
+    DeviceConfigurator _configurator;
+    std::string _selected; // UserSetSelector value as last written
+    std::string _current;
+    guint _payload = 0;
+    size_t _bufferSize = 0;
+    guint _buffersPayload = 0; // payload the buffers were allocated for, used when _bufferSize is 0
+};
+
+inline bool RecipeSwitcher::store(const Recipe& recipe, ApplyReport* report) {
+    if (!_camera) {
+        return false;
+    }
+    if (!_configurator.apply(recipe.config, report) || !select(recipe.userSet)) {
+        return false;
+    }
+
+    GError* error = nullptr;
+    if (!recipe.description.empty()) {
+        arv_camera_set_string(_camera, "UserSetDescription", recipe.description.c_str(), &error);
+        if (error) {
+            std::cerr << "Error: Failed to set UserSetDescription: " << error->message << std::endl;
+            g_clear_error(&error);
+            return false;
+        }
+    }
+    if (!execute("UserSetSave")) {
+        return false;
+    }
+
+    _current = recipe.userSet;
+    _payload = arv_camera_get_payload(_camera, &error);
+    if (error) {
+        std::cerr << "Error: Failed to obtain payload size!" << std::endl;
+        g_clear_error(&error);
+        return false;
+    }
+    return true;
+}
+
+inline bool RecipeSwitcher::switchTo(const std::string& userSet, bool acquiring, SwitchReport* report) {
+    SwitchReport localReport;
+    SwitchReport& out = report ? *report : localReport;
+    out = SwitchReport();
+    if (!_camera) {
+        return false;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    const auto ms = [](Clock::time_point from, Clock::time_point to) {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    };
+    const auto start = Clock::now();
+
+    GError* error = nullptr;
+    if (acquiring) {
+        /* UserSetLoad is not allowed while acquiring */
+        arv_camera_stop_acquisition(_camera, &error);
+        if (error) {
+            std::cerr << "Error: " << error->message << std::endl;
+            g_clear_error(&error);
+            return false;
+        }
+        out.drained = drain();
+    }
+    if (!_bufferSize && !_buffersPayload) {
+        /* The buffers were allocated for the payload of the configuration before the first switch */
+        _buffersPayload = arv_camera_get_payload(_camera, &error);
+        if (error) {
+            std::cerr << "Error: Failed to obtain payload size!" << std::endl;
+            g_clear_error(&error);
+            return false;
+        }
+    }
+    const auto stopped = Clock::now();
+
+    if (!select(userSet) || !execute("UserSetLoad")) {
+        return false;
+    }
+    _current = userSet;
+    const auto loaded = Clock::now();
+
+    /* One register read, the buffers are kept as long as the new payload fits */
+    out.payload = arv_camera_get_payload(_camera, &error);
+    if (error) {
+        std::cerr << "Error: Failed to obtain payload size!" << std::endl;
+        g_clear_error(&error);
+        return false;
+    }
+    out.payloadChanged = out.payload != _payload;
+    out.buffersTooSmall = out.payload > (_bufferSize ? _bufferSize : _buffersPayload);
+    _payload = out.payload;
+    if (out.buffersTooSmall && !_bufferSize) {
+        /* The caller re-creates the buffers for the new payload */
+        _buffersPayload = out.payload;
+    }
+
+    if (acquiring && !out.buffersTooSmall) {
+        arv_camera_start_acquisition(_camera, &error);
+        if (error) {
+            std::cerr << "Error: Failed to start acquisition!" << std::endl;
+            g_clear_error(&error);
+            return false;
+        }
+    }
+    const auto end = Clock::now();
+
+    out.stopMs = ms(start, stopped);
+    out.loadMs = ms(stopped, loaded);
+    out.startMs = ms(loaded, end);
+    out.totalMs = ms(start, end);
+    return true;
+}
+
+inline bool RecipeSwitcher::select(const std::string& userSet) {
+    if (_selected == userSet) {
+        return true;
+    }
+    GError* error = nullptr;
+    arv_camera_set_string(_camera, "UserSetSelector", userSet.c_str(), &error);
+    if (error) {
+        std::cerr << "Error: Failed to select UserSetSelector='" << userSet << "': " << error->message << std::endl;
+        g_clear_error(&error);
+        _selected.clear();
+        return false;
+    }
+    _selected = userSet;
+    return true;
+}
+
+inline bool RecipeSwitcher::execute(const char* command) {
+    GError* error = nullptr;
+    arv_camera_execute_command(_camera, command, &error);
+    if (error) {
+        std::cerr << "Error: Failed to execute " << command << ": " << error->message << std::endl;
+        g_clear_error(&error);
+        return false;
+    }
+    return true;
+}
+
+inline size_t RecipeSwitcher::drain() {
+    size_t drained = 0;
+    if (!_stream) {
+        return drained;
+    }
+    while (ArvBuffer* buffer = arv_stream_try_pop_buffer(_stream)) {
+        arv_stream_push_buffer(_stream, buffer);
+        ++drained;
+    }
+    return drained;
+}
+
+}  // namespace pho
+
+#endif  // PHOTONEOMAIN_RECIPESWITCHER_H
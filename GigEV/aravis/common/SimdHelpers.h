@@ -0,0 +1,46 @@
+#ifndef PHOTONEOMAIN_SIMDHELPERS_H
+#define PHOTONEOMAIN_SIMDHELPERS_H
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace pho {
+namespace simd {
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(__AVX2__)
+#define PHO_SIMD_SSE2 1
+
+// Interleaves 4 x, y, z values into 4 packed Vec3D (12 floats).
+inline void storeVec3D4(float* out, __m128 x, __m128 y, __m128 z) {
+    const __m128 zx = _mm_shuffle_ps(z, x, _MM_SHUFFLE(2, 1, 3, 0)); // z0 z3 x1 x2
+    const __m128 yz = _mm_shuffle_ps(y, z, _MM_SHUFFLE(2, 1, 2, 1)); // y1 y2 z1 z2
+    const __m128 xy = _mm_shuffle_ps(x, y, _MM_SHUFFLE(1, 0, 1, 0)); // x0 x1 y0 y1
+    const __m128 xxyy = _mm_shuffle_ps(zx, yz, _MM_SHUFFLE(1, 1, 3, 3)); // x2 x2 y2 y2
+    const __m128 zzxx = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)); // z2 z2 x3 x3
+    const __m128 yyzz = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)); // y3 y3 z3 z3
+    _mm_storeu_ps(out + 0, _mm_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 2, 0)));   // x0 y0 z0 x1
+    _mm_storeu_ps(out + 4, _mm_shuffle_ps(yz, xxyy, _MM_SHUFFLE(2, 0, 2, 0))); // y1 z1 x2 y2
+    _mm_storeu_ps(out + 8, _mm_shuffle_ps(zzxx, yyzz, _MM_SHUFFLE(2, 0, 2, 0))); // z2 x3 y3 z3
+}
+
+// Deinterleaves 4 packed Vec3D (12 floats) into 4 x, y, z values, the inverse of storeVec3D4.
+inline void loadVec3D4(const float* in, __m128& x, __m128& y, __m128& z) {
+    const __m128 a = _mm_loadu_ps(in + 0); // x0 y0 z0 x1
+    const __m128 b = _mm_loadu_ps(in + 4); // y1 z1 x2 y2
+    const __m128 c = _mm_loadu_ps(in + 8); // z2 x3 y3 z3
+    const __m128 x23 = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 0, 2, 2)); // x2 x2 z2 x3
+    const __m128 y01 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)); // y0 y0 y1 y1
+    const __m128 z01 = _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)); // z0 z0 z1 z1
+    x = _mm_shuffle_ps(a, x23, _MM_SHUFFLE(3, 0, 3, 0));                // x0 x1 x2 x3
+    y = _mm_shuffle_ps(y01, _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0)); // y0 y1 y2 y3
+    z = _mm_shuffle_ps(z01, _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0)); // z0 z1 z2 z3
+}
+#endif
+
+}  // namespace simd
+}  // namespace pho
+
+#endif  // PHOTONEOMAIN_SIMDHELPERS_H
@@ -0,0 +1,71 @@
+#ifndef PHOTONEOMAIN_SPSCRING_H
+#define PHOTONEOMAIN_SPSCRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace pho {
+
+/**
+ * Bounded lock-free ring buffer for exactly one producer and one consumer thread.
+ *
+ * The capacity is rounded up to a power of two. tryPush() / tryPop() never block, a full
+ * ring is reported to the producer so it can decide what to drop.
+ */
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        _slots.resize(size);
+        _mask = size - 1;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer side
+    bool tryPush(const T& value) {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head.load(std::memory_order_acquire) > _mask) {
+            return false;
+        }
+        _slots[tail & _mask] = value;
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool tryPop(T& value) {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = _slots[head & _mask];
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called concurrently with push / pop
+    size_t size() const {
+        const size_t head = _head.load(std::memory_order_acquire);
+        return _tail.load(std::memory_order_acquire) - head;
+    }
+
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return _mask + 1; }
+
+private:
+    std::vector<T> _slots;
+    size_t _mask = 0;
+    alignas(64) std::atomic<size_t> _head{0}; // next slot to pop, written by the consumer
+    alignas(64) std::atomic<size_t> _tail{0}; // next slot to push, written by the producer
+};
+
+}  // namespace pho
+
+#endif  // PHOTONEOMAIN_SPSCRING_H
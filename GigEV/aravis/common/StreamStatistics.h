@@ -0,0 +1,287 @@
+#ifndef PHOTONEOMAIN_STREAMSTATISTICS_H
+#define PHOTONEOMAIN_STREAMSTATISTICS_H
+
+#include "PhoAravisCommon.h"
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <mutex>
+#include <string>
+
+namespace pho {
+
+/**
+ * Rolling latency histogram over the last `window` samples.
+ *
+ * Samples (in microseconds) go to log-linear buckets: exact below 16 us, then 16 buckets per
+ * power of two, so the reported percentiles are at most 6.25 % above the real value.
+ * record() and percentile() do not allocate.
+ */
+class LatencyHistogram {
+public:
+    explicit LatencyHistogram(size_t window = 1024) : _samples(std::max<size_t>(1, window)) {}
+
+    void record(uint64_t valueUs) {
+        const uint16_t bucket = bucketOf(valueUs);
+        if (_count == _samples.size()) {
+            --_buckets[_samples[_next]];
+        } else {
+            ++_count;
+        }
+        _samples[_next] = bucket;
+        ++_buckets[bucket];
+        _next = (_next + 1) % _samples.size();
+    }
+
+    /* Upper bound of the bucket holding the `p`-th percentile (0 - 100) of the window, 0 if empty */
+    uint64_t percentile(double p) const {
+        if (_count == 0) {
+            return 0;
+        }
+        const size_t rank = std::max<size_t>(1, size_t(std::ceil(p / 100.0 * _count)));
+        size_t seen = 0;
+        for (size_t bucket = 0; bucket < bucketCount; ++bucket) {
+            seen += _buckets[bucket];
+            if (seen >= rank) {
+                return bucketUpperBound(bucket);
+            }
+        }
+        return bucketUpperBound(bucketCount - 1);
+    }
+
+    size_t count() const { return _count; }
+    size_t window() const { return _samples.size(); }
+
+    void clear() {
+        _buckets.fill(0);
+        _count = 0;
+        _next = 0;
+    }
+
+private:
+    static constexpr unsigned subBucketBits = 4;
+    static constexpr unsigned subBuckets = 1u << subBucketBits;
+    static constexpr size_t bucketCount = (64 - subBucketBits + 1) * subBuckets;
+
+    static uint16_t bucketOf(uint64_t value) {
+        if (value < subBuckets) {
+            return uint16_t(value);
+        }
+        unsigned exponent = 63;
+        while (!(value >> exponent)) {
+            --exponent;
+        }
+        const unsigned shift = exponent - subBucketBits;
+        return uint16_t((shift + 1) * subBuckets + ((value >> shift) & (subBuckets - 1)));
+    }
+
+    static uint64_t bucketUpperBound(size_t bucket) {
+        if (bucket < subBuckets) {
+            return bucket;
+        }
+        const unsigned shift = unsigned(bucket / subBuckets) - 1;
+        const uint64_t lower = (uint64_t(subBuckets) | (bucket & (subBuckets - 1))) << shift;
+        return lower + ((uint64_t(1) << shift) - 1);
+    }
+
+    std::vector<uint16_t> _samples; // bucket index of every sample in the window
+    std::array<uint32_t, bucketCount> _buckets{};
+    size_t _count = 0;
+    size_t _next = 0;
+};
+
+inline const char* bufferStatusName(ArvBufferStatus status) {
+    switch (status) {
+    case ARV_BUFFER_STATUS_SUCCESS: return "success";
+    case ARV_BUFFER_STATUS_CLEARED: return "cleared";
+    case ARV_BUFFER_STATUS_TIMEOUT: return "timeout";
+    case ARV_BUFFER_STATUS_MISSING_PACKETS: return "missing_packets";
+    case ARV_BUFFER_STATUS_WRONG_PACKET_ID: return "wrong_packet_id";
+    case ARV_BUFFER_STATUS_SIZE_MISMATCH: return "size_mismatch";
+    case ARV_BUFFER_STATUS_FILLING: return "filling";
+    case ARV_BUFFER_STATUS_ABORTED: return "aborted";
+    default: return "unknown";
+    }
+}
+
+/* Counters maintained by aravis itself, see StreamStatistics::transport() */
+struct TransportCounters {
+    guint64 completedBuffers = 0;
+    guint64 failures = 0;
+    guint64 underruns = 0; // no free buffer in the stream when a frame arrived
+    guint64 resentPackets = 0;
+    guint64 missingPackets = 0;
+};
+
+/**
+ * Instrumentation of an aravis stream: transport counters, buffer status and per-frame latencies.
+ *
+ * Call onDequeued() right after a buffer is popped from the stream and onReleased() right before it is
+ * pushed back. Three rolling histograms are kept:
+ *  - arrival: system timestamp minus device timestamp. aravis takes the system timestamp when the first
+ *    packet of the frame (the leader) arrives, so this is the delay until the frame starts arriving, not its
+ *    transfer time. Unless the device and the host clocks are synchronized (PTP), the clocks have an unknown
+ *    offset, so this is reported relative to the smallest difference seen so far, i.e. above the best case.
+ *  - pickup: from the system timestamp until the application popped the buffer. Includes the transfer of the
+ *    rest of the frame, then the time the completed buffer waited in the output queue.
+ *  - release: from the pop until the buffer is pushed back (application processing time).
+ *
+ * The methods are thread-safe, e.g. buffers may be dequeued and released on different threads.
+ */
+class StreamStatistics {
+public:
+    explicit StreamStatistics(size_t window = 1024)
+            : _arrival(window), _pickup(window), _release(window) {}
+
+    void onDequeued(ArvBuffer* buffer) {
+        const int64_t nowNs = g_get_real_time() * 1000;
+        const int64_t monotonicUs = g_get_monotonic_time();
+        const ArvBufferStatus status = arv_buffer_get_status(buffer);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        ++_statusCounts[statusSlot(status)];
+        _dequeuedAt.emplace_back(buffer, monotonicUs);
+        if (status != ARV_BUFFER_STATUS_SUCCESS) {
+            return;
+        }
+
+        const int64_t systemNs = int64_t(arv_buffer_get_system_timestamp(buffer));
+        const int64_t deviceNs = int64_t(arv_buffer_get_timestamp(buffer));
+        if (deviceNs != 0) {
+            const int64_t offsetNs = systemNs - deviceNs;
+            if (!_hasDeviceOffset || offsetNs < _minDeviceOffsetNs) {
+                _minDeviceOffsetNs = offsetNs;
+                _hasDeviceOffset = true;
+            }
+            _arrival.record(uint64_t(offsetNs - _minDeviceOffsetNs) / 1000);
+        }
+        _pickup.record(uint64_t(std::max<int64_t>(0, nowNs - systemNs)) / 1000);
+    }
+
+    void onReleased(ArvBuffer* buffer) {
+        const int64_t monotonicUs = g_get_monotonic_time();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        const auto dequeued = std::find_if(_dequeuedAt.begin(), _dequeuedAt.end(),
+                                           [buffer](const auto& entry) { return entry.first == buffer; });
+        if (dequeued == _dequeuedAt.end()) {
+            return;
+        }
+        _release.record(uint64_t(std::max<int64_t>(0, monotonicUs - dequeued->second)));
+        *dequeued = _dequeuedAt.back();
+        _dequeuedAt.pop_back();
+    }
+
+    /* Reads the counters of the stream, resent / missing packets are only available on GigE Vision streams */
+    static TransportCounters transport(ArvStream* stream) {
+        TransportCounters counters;
+        if (!stream) {
+            return counters;
+        }
+        arv_stream_get_statistics(stream, &counters.completedBuffers, &counters.failures, &counters.underruns);
+        if (ARV_IS_GV_STREAM(stream)) {
+            arv_gv_stream_get_statistics(ARV_GV_STREAM(stream), &counters.resentPackets, &counters.missingPackets);
+        }
+        return counters;
+    }
+
+    uint64_t statusCount(ArvBufferStatus status) const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _statusCounts[statusSlot(status)];
+    }
+
+    /* Copies of the histograms, safe to inspect while frames are being recorded */
+    LatencyHistogram arrivalLatency() const { return locked(_arrival); }
+    LatencyHistogram pickupLatency() const { return locked(_pickup); }
+    LatencyHistogram releaseLatency() const { return locked(_release); }
+
+    void print(std::ostream& out, ArvStream* stream) const {
+        const TransportCounters counters = transport(stream);
+        out << "Stream: completed " << counters.completedBuffers << ", failures " << counters.failures
+            << ", underruns " << counters.underruns << ", resent packets " << counters.resentPackets
+            << ", missing packets " << counters.missingPackets << std::endl;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        out << "Buffer status:";
+        for (size_t slot = 0; slot < _statusCounts.size(); ++slot) {
+            if (_statusCounts[slot]) {
+                out << " " << bufferStatusName(ArvBufferStatus(int(slot) - 1)) << " " << _statusCounts[slot];
+            }
+        }
+        out << std::endl;
+
+        out << "Latency [us], last " << std::left << std::setw(18) << std::to_string(_release.window()) + " frames"
+            << std::right;
+        for (const char* p : {"p50", "p90", "p99", "max"}) {
+            out << std::setw(9) << p;
+        }
+        out << std::endl;
+        printHistogram(out, "arrival (device -> 1st pkt)", _arrival);
+        printHistogram(out, "pickup (1st pkt -> pop)", _pickup);
+        printHistogram(out, "release (pop -> push)", _release);
+    }
+
+    /*
+     * Prints the statistics if at least `period` passed since the last dump, so it can be called
+     * from the acquisition loop of every frame.
+     */
+    bool printPeriodically(std::ostream& out, ArvStream* stream, std::chrono::milliseconds period) {
+        const auto now = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (now - _lastPrint < period) {
+                return false;
+            }
+            _lastPrint = now;
+        }
+        print(out, stream);
+        return true;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _arrival.clear();
+        _pickup.clear();
+        _release.clear();
+        _statusCounts.fill(0);
+        _dequeuedAt.clear();
+        _hasDeviceOffset = false;
+    }
+
+private:
+    /* ArvBufferStatus starts at ARV_BUFFER_STATUS_UNKNOWN = -1 */
+    static constexpr size_t statusSlots = ARV_BUFFER_STATUS_ABORTED + 2;
+
+    static size_t statusSlot(ArvBufferStatus status) {
+        const int slot = int(status) + 1;
+        return slot >= 0 && size_t(slot) < statusSlots ? size_t(slot) : 0;
+    }
+
+    LatencyHistogram locked(const LatencyHistogram& histogram) const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return histogram;
+    }
+
+    static void printHistogram(std::ostream& out, const char* name, const LatencyHistogram& histogram) {
+        out << "  " << std::left << std::setw(34) << name << std::right;
+        for (double p : {50.0, 90.0, 99.0, 100.0}) {
+            out << std::setw(9) << histogram.percentile(p);
+        }
+        out << std::endl;
+    }
+
+    mutable std::mutex _mutex;
+    LatencyHistogram _arrival;
+    LatencyHistogram _pickup;
+    LatencyHistogram _release;
+    std::array<uint64_t, statusSlots> _statusCounts{};
+    std::vector<std::pair<ArvBuffer*, int64_t>> _dequeuedAt; // buffers held by the application, a handful at most
+    int64_t _minDeviceOffsetNs = 0;
+    bool _hasDeviceOffset = false;
+    std::chrono::steady_clock::time_point _lastPrint = std::chrono::steady_clock::now();
+};
+
+}  // namespace pho
+
+#endif  // PHOTONEOMAIN_STREAMSTATISTICS_H
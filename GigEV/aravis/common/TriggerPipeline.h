@@ -0,0 +1,234 @@
+#ifndef PHOTONEOMAIN_TRIGGERPIPELINE_H
+#define PHOTONEOMAIN_TRIGGERPIPELINE_H
+
+#include "BufferArena.h"
+#include "FrameTracker.h"
+#include "PhoAravisCommon.h"
+#include "StreamStatistics.h"
+
+#include <deque>
+#include <string>
+
+namespace pho {
+
+/*
+ * Microseconds from a trigger issued at `triggerUs` (g_get_real_time()) to the arrival of the first packet of
+ * `buffer`. The system timestamp of aravis is taken on the same clock, so the time the buffer waited in the output
+ * queue is not included.
+ */
+inline uint64_t triggerToBufferUs(gint64 triggerUs, ArvBuffer* buffer) {
+    const guint64 arrivalNs = arv_buffer_get_system_timestamp(buffer);
+    const gint64 arrivalUs = arrivalNs ? gint64(arrivalNs / 1000) : g_get_real_time();
+    return uint64_t(std::max<gint64>(arrivalUs - triggerUs, 0));
+}
+
+/**
+ * Software triggering with up to `depth` triggers outstanding, so the exposure of the next frames overlaps with
+ * the transfer and processing of the current one. The buffer pool holds one buffer per outstanding trigger plus
+ * the one being processed.
+ *
+ * Triggers are matched to buffers by frame ID: the device numbers frames consecutively, so a gap in the frame IDs
+ * means the frames of the oldest outstanding triggers were lost. A trigger without any frame for `timeoutUs` is
+ * considered lost too and replaced by a new one. A depth above 1 needs a device which accepts triggers while the
+ * previous frame is still being acquired (TriggerOverlap other than Off), start() warns otherwise.
+ *
+ *     TriggerPipeline pipeline(camera, 3);
+ *     pipeline.start();
+ *     while (...) {
+ *         ArvBuffer* buffer = pipeline.pop();  // the next trigger is already issued here
+ *         ...
+ *         pipeline.release(buffer);
+ *     }
+ *     pipeline.stop();
+ */
+class TriggerPipeline {
+public:
+    struct Statistics {
+        uint64_t triggers = 0;
+        uint64_t completed = 0; // buffers with success status
+        uint64_t failed = 0;    // buffers with other status
+        uint64_t lost = 0;      // triggers without a buffer
+        uint64_t timeouts = 0;
+    };
+
+    explicit TriggerPipeline(ArvCamera* camera, unsigned depth = 2, guint64 timeoutUs = 2000000)
+            : _camera(camera), _depth(std::max(1u, depth)), _timeoutUs(timeoutUs) {}
+
+    ~TriggerPipeline() { stop(); }
+
+    TriggerPipeline(const TriggerPipeline&) = delete;
+    TriggerPipeline& operator=(const TriggerPipeline&) = delete;
+
+    /*
+     * Creates the stream with `depth` + 1 buffers of the current payload size, starts the acquisition and issues
+     * the first `depth` triggers. The device must be configured for software trigger.
+     */
+    bool start();
+
+    /* Stops the acquisition and destroys the stream, outstanding triggers are dropped */
+    void stop();
+
+    /*
+     * Waits for the buffer of the oldest outstanding trigger and issues the next trigger before returning, so the
+     * device works on the following frames while the caller processes this one. Returns nullptr after `timeoutUs`.
+     * Buffers with a failed status are returned as well, check arv_buffer_get_status().
+     */
+    ArvBuffer* pop();
+
+    /* Returns the buffer popped last to the stream */
+    void release(ArvBuffer* buffer);
+
+    /* Trigger-to-buffer latency in microseconds, matched by frame ID, see triggerToBufferUs() */
+    const LatencyHistogram& latency() const { return _latency; }
+    const Statistics& statistics() const { return _statistics; }
+    unsigned depth() const { return _depth; }
+    ArvStream* stream() const { return _stream.get(); }
+    const BufferArena& bufferArena() const { return _arena; }
+
+private:
+    bool trigger();
+
+    ArvCamera* _camera;
+    unsigned _depth;
+    guint64 _timeoutUs;
+    BufferArena _arena; // outlives the stream
+    std::unique_ptr<ArvStream, void (*)(ArvStream*)> _stream{nullptr, gobject_destroyer<ArvStream>};
+    std::deque<gint64> _outstanding; // trigger times (g_get_real_time()), oldest first
+    guint64 _lastFrameId = 0;
+    bool _haveFrameId = false;
+    LatencyHistogram _latency;
+    Statistics _statistics;
+};
+
+inline bool TriggerPipeline::start() {
+    if (!_camera || _stream) {
+        return false;
+    }
+
+    GError* error = nullptr;
+    _stream.reset(arv_camera_create_stream(_camera, nullptr, nullptr, &error));
+    if (error || !ARV_IS_STREAM(_stream.get())) {
+        std::cerr << "Error: Failed to create stream!" << std::endl;
+        g_clear_error(&error);
+        _stream.reset();
+        return false;
+    }
+
+    const size_t payload = arv_camera_get_payload(_camera, &error);
+    if (error) {
+        std::cerr << "Error: Failed to obtain payload size!" << std::endl;
+        g_clear_error(&error);
+        _stream.reset();
+        return false;
+    }
+    /* One buffer per outstanding trigger, one for the frame being processed */
+    if (!_arena.allocate(payload, _depth + 1)) {
+        _stream.reset();
+        return false;
+    }
+    _arena.pushBuffers(_stream.get());
+
+    arv_camera_start_acquisition(_camera, &error);
+    if (error) {
+        std::cerr << "Error: Failed to start acquisition!" << std::endl;
+        g_clear_error(&error);
+        _stream.reset();
+        return false;
+    }
+
+    if (_depth > 1 && arv_camera_is_feature_available(_camera, "TriggerOverlap", nullptr)) {
+        const char* overlap = arv_camera_get_string(_camera, "TriggerOverlap", nullptr);
+        if (overlap && std::string(overlap) == "Off") {
+            std::cerr << "Warning: TriggerOverlap is Off, triggers issued while acquiring may be ignored" << std::endl;
+        }
+    }
+
+    _outstanding.clear();
+    _haveFrameId = false;
+    for (unsigned i = 0; i < _depth; ++i) {
+        if (!trigger()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline void TriggerPipeline::stop() {
+    if (!_stream) {
+        return;
+    }
+    GError* error = nullptr;
+    arv_camera_stop_acquisition(_camera, &error);
+    if (error) {
+        std::cerr << "Error: " << error->message << std::endl;
+        g_clear_error(&error);
+    }
+    _stream.reset();
+    _outstanding.clear();
+}
+
+inline ArvBuffer* TriggerPipeline::pop() {
+    if (!_stream || _outstanding.empty()) {
+        return nullptr;
+    }
+
+    ArvBuffer* buffer = arv_stream_timeout_pop_buffer(_stream.get(), _timeoutUs);
+    if (!buffer) {
+        /* The oldest trigger did not produce a frame, replace it */
+        ++_statistics.timeouts;
+        ++_statistics.lost;
+        _outstanding.pop_front();
+        trigger();
+        return nullptr;
+    }
+
+    /* Triggers between the previous and this frame ID produced no buffer */
+    const guint64 frameId = arv_buffer_get_frame_id(buffer);
+    if (_haveFrameId) {
+        guint64 missing = guint64(std::max<int64_t>(frameIdDistance(_lastFrameId, frameId) - 1, 0));
+        for (; missing > 0 && _outstanding.size() > 1; --missing) {
+            ++_statistics.lost;
+            _outstanding.pop_front();
+        }
+    }
+    _lastFrameId = frameId;
+    _haveFrameId = true;
+
+    if (!_outstanding.empty()) {
+        _latency.record(triggerToBufferUs(_outstanding.front(), buffer));
+        _outstanding.pop_front();
+    }
+    if (arv_buffer_get_status(buffer) == ARV_BUFFER_STATUS_SUCCESS) {
+        ++_statistics.completed;
+    } else {
+        ++_statistics.failed;
+    }
+
+    /* Keep the pipeline full while the caller processes this buffer */
+    while (_outstanding.size() < _depth) {
+        if (!trigger()) {
+            break;
+        }
+    }
+    return buffer;
+}
+
+inline void TriggerPipeline::release(ArvBuffer* buffer) {
+    if (_stream && buffer) {
+        arv_stream_push_buffer(_stream.get(), buffer);
+    }
+}
+
+inline bool TriggerPipeline::trigger() {
+    _outstanding.push_back(g_get_real_time());
+    if (!triggerFrame(_camera)) {
+        _outstanding.pop_back();
+        return false;
+    }
+    ++_statistics.triggers;
+    return true;
+}
+
+}  // namespace pho
+
+#endif  // PHOTONEOMAIN_TRIGGERPIPELINE_H
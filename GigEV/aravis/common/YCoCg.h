@@ -1,9 +1,26 @@
 #ifndef PHOTONEOMAIN_YCOCG_H
 #define PHOTONEOMAIN_YCOCG_H
 
+#include "ParallelRows.h"
+
+#include <algorithm>
+#include <cmath>
 #include <cstdint>
+#include <limits>
+#include <type_traits>
 #include <opencv2/core/core.hpp>
 
+/*
+ * The vectorized conversions need SSSE3 and SSE4.1: -msse4.1 (or a -march including it) on GCC / Clang, or
+ * PHO_ENABLE_AVX2 (see helper_functions.cmake). MSVC defines __AVX2__ with /arch:AVX2 but never the SSE4.1 macro.
+ * Default x86-64 builds use the scalar code.
+ */
+#if defined(__AVX2__) || (defined(__SSSE3__) && defined(__SSE4_1__))
+#define PHO_SIMD_SSE41 1
+#include <smmintrin.h>
+#include <tmmintrin.h>
+#endif
+
 namespace pho {
 /**
  * Utility class providing conversion function for images.
@@ -38,13 +55,61 @@ public:
     using RGBType = cv::Vec<ChannelType, 3>;
     using YCoCgType = ChannelType;
 
+    using RGB8Type = cv::Vec3b;
+
+    // Channel order of the converted pixels.
+    enum class ChannelOrder { RGB, BGR };
+
     // Converts the image in the YCoCg format to BGR.
     // Preconditions: even-sized matrix.
     static cv::Mat_<BGRType> convertToRGB(const cv::Mat_<YCoCgType>& ycocgImg);
 
+    // Converts the image in the YCoCg format to RGB into `rgbImg`. The output is (re)allocated only if its size
+    // does not match, so the same image can be reused for every frame.
+    // Produces the same values as the function above, vectorized when compiled with SSE4.1 or PHO_ENABLE_AVX2
+    // (see PHO_SIMD_SSE41 above) and row-parallel with `threads` > 1.
+    // Preconditions: even-sized matrix.
+    static void convertToRGB(const cv::Mat_<YCoCgType>& ycocgImg, cv::Mat_<RGBType>& rgbImg, unsigned threads = 1);
+
+    // Converts the image in the YCoCg format directly to 8 bits per channel in the requested channel order.
+    // The 10 bit values are scaled down in the same pass, no further normalization or cvtColor is needed.
+    // Preconditions: even-sized matrix.
+    static void convertToRGB8(const cv::Mat_<YCoCgType>& ycocgImg, cv::Mat_<RGB8Type>& rgbImg,
+                              ChannelOrder order = ChannelOrder::RGB, unsigned threads = 1);
+
+    // Raw buffer versions of the above, usable directly on the received buffer data.
+    // Strides are in bytes. The output buffers must hold `height` rows of `width` * 3 channels.
+    static void convertToRGB(const YCoCgType* src, size_t srcStride, int width, int height,
+                             ChannelType* dst, size_t dstStride, ChannelOrder order, unsigned threads = 1);
+    static void convertToRGB8(const YCoCgType* src, size_t srcStride, int width, int height,
+                              std::uint8_t* dst, size_t dstStride, ChannelOrder order, unsigned threads = 1);
+
+    // Converts an RGB (or BGR) image with 10 bit channel values to the YCoCg Mono16 format, the inverse of
+    // convertToRGB. Larger channel values are saturated.
+    // Co and Cg of a plaquette are averaged over its non-black pixels and non-black pixels are stored with
+    // Y >= 1, so that black pixels (and only those) decode as black again.
+    // `ycocgImg` is (re)allocated only if its size does not match.
+    // Preconditions: even-sized matrix.
+    static void convertFromRGB(const cv::Mat_<RGBType>& rgbImg, cv::Mat_<YCoCgType>& ycocgImg,
+                               ChannelOrder order = ChannelOrder::RGB, unsigned threads = 1);
+
+    // Raw buffer version of the above. Strides are in bytes.
+    static void convertFromRGB(const ChannelType* src, size_t srcStride, int width, int height,
+                               YCoCgType* dst, size_t dstStride, ChannelOrder order, unsigned threads = 1);
+
 private:
     // Pixel conversions.
     static RGBType pixelRGB(const ChannelType y, const ChannelType co, const ChannelType cg);
+
+    // Decodes the plaquette rows [firstRow, endRow) of a 2-row band, output channel type is either
+    // ChannelType (10 bit values) or std::uint8_t (scaled down to 8 bits).
+    template <typename OutType>
+    static void convertRows(const YCoCgType* src, size_t srcStride, int width, int firstRow, int endRow,
+                            OutType* dst, size_t dstStride, ChannelOrder order);
+
+    // Encodes the plaquette rows [firstRow, endRow).
+    static void convertRowsFromRGB(const ChannelType* src, size_t srcStride, int width, int firstRow, int endRow,
+                                   YCoCgType* dst, size_t dstStride, ChannelOrder order);
 };
 
 YCoCg::RGBType YCoCg::pixelRGB(const ChannelType y, const ChannelType co, const ChannelType cg) {
@@ -86,6 +151,305 @@ cv::Mat_<YCoCg::RGBType> YCoCg::convertToRGB(const cv::Mat_<YCoCgType>& ycocgImg
     }
     return rgbImg;
 }
+
+#if defined(PHO_SIMD_SSE41)
+namespace detail {
+
+// Decodes 8 pixels of the upper and 8 pixels of the lower row of four 2x2 plaquettes.
+// Same arithmetic as YCoCg::pixelRGB, the conditional subtractions are saturating subtractions.
+inline void decodeYCoCg8(__m128i top, __m128i bottom, __m128i rgbTop[3], __m128i rgbBottom[3]) {
+    const int yShift = 16 - YCoCg::pixelDepth;
+    const __m128i mask = _mm_set1_epi32((1 << yShift) - 1);
+    const __m128i delta = _mm_set1_epi16(1 << (YCoCg::pixelDepth - 1));
+    const __m128i maxValue = _mm_set1_epi16((1 << YCoCg::pixelDepth) - 1);
+
+    // The chroma halves are in the low bits of the two pixels of a plaquette row, which form one 32 bit lane.
+    // Assemble them there and broadcast back to both 16 bit halves (nearest neighbor interpolation).
+    __m128i co = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(top, mask), yShift),
+                              _mm_and_si128(_mm_srli_epi32(top, 16), mask));
+    __m128i cg = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(bottom, mask), yShift),
+                              _mm_and_si128(_mm_srli_epi32(bottom, 16), mask));
+    co = _mm_or_si128(co, _mm_slli_epi32(co, 16));
+    cg = _mm_or_si128(cg, _mm_slli_epi32(cg, 16));
+
+    const __m128i halfCg = _mm_srli_epi16(cg, 1);
+    const __m128i b2 = _mm_srli_epi16(_mm_add_epi16(co, cg), 1);
+
+    const __m128i ys[2] = {_mm_srli_epi16(top, yShift), _mm_srli_epi16(bottom, yShift)};
+    __m128i* outs[2] = {rgbTop, rgbBottom};
+    for (int i = 0; i < 2; ++i) {
+        const __m128i y = ys[i];
+        const __m128i black = _mm_cmpeq_epi16(y, _mm_setzero_si128());
+        const __m128i r1 = _mm_add_epi16(_mm_add_epi16(y, y), co);
+        const __m128i r = _mm_srli_epi16(_mm_subs_epu16(r1, cg), 1);
+        const __m128i g = _mm_subs_epu16(_mm_add_epi16(y, halfCg), delta);
+        const __m128i b = _mm_subs_epu16(_mm_add_epi16(y, _mm_add_epi16(delta, delta)), b2);
+        outs[i][0] = _mm_andnot_si128(black, _mm_min_epu16(r, maxValue));
+        outs[i][1] = _mm_andnot_si128(black, _mm_min_epu16(g, maxValue));
+        outs[i][2] = _mm_andnot_si128(black, _mm_min_epu16(b, maxValue));
+    }
+}
+
+// Interleaves 8 16 bit pixels of three channels into 24 consecutive values.
+inline void storeInterleaved(std::uint16_t* dst, __m128i c0, __m128i c1, __m128i c2) {
+    const __m128i out0 = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(c0, _mm_setr_epi8(0, 1, -128, -128, -128, -128, 2, 3, -128, -128, -128, -128, 4, 5, -128, -128)),
+            _mm_shuffle_epi8(c1, _mm_setr_epi8(-128, -128, 0, 1, -128, -128, -128, -128, 2, 3, -128, -128, -128, -128, 4, 5))),
+            _mm_shuffle_epi8(c2, _mm_setr_epi8(-128, -128, -128, -128, 0, 1, -128, -128, -128, -128, 2, 3, -128, -128, -128, -128)));
+    const __m128i out1 = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(c0, _mm_setr_epi8(-128, -128, 6, 7, -128, -128, -128, -128, 8, 9, -128, -128, -128, -128, 10, 11)),
+            _mm_shuffle_epi8(c1, _mm_setr_epi8(-128, -128, -128, -128, 6, 7, -128, -128, -128, -128, 8, 9, -128, -128, -128, -128))),
+            _mm_shuffle_epi8(c2, _mm_setr_epi8(4, 5, -128, -128, -128, -128, 6, 7, -128, -128, -128, -128, 8, 9, -128, -128)));
+    const __m128i out2 = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(c0, _mm_setr_epi8(-128, -128, -128, -128, 12, 13, -128, -128, -128, -128, 14, 15, -128, -128, -128, -128)),
+            _mm_shuffle_epi8(c1, _mm_setr_epi8(10, 11, -128, -128, -128, -128, 12, 13, -128, -128, -128, -128, 14, 15, -128, -128))),
+            _mm_shuffle_epi8(c2, _mm_setr_epi8(-128, -128, 10, 11, -128, -128, -128, -128, 12, 13, -128, -128, -128, -128, 14, 15)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), out0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 8), out1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), out2);
+}
+
+// Interleaves 16 8 bit pixels of three channels into 48 consecutive bytes.
+inline void storeInterleaved(std::uint8_t* dst, __m128i c0, __m128i c1, __m128i c2) {
+    const __m128i out0 = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(c0, _mm_setr_epi8(0, -128, -128, 1, -128, -128, 2, -128, -128, 3, -128, -128, 4, -128, -128, 5)),
+            _mm_shuffle_epi8(c1, _mm_setr_epi8(-128, 0, -128, -128, 1, -128, -128, 2, -128, -128, 3, -128, -128, 4, -128, -128))),
+            _mm_shuffle_epi8(c2, _mm_setr_epi8(-128, -128, 0, -128, -128, 1, -128, -128, 2, -128, -128, 3, -128, -128, 4, -128)));
+    const __m128i out1 = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(c0, _mm_setr_epi8(-128, -128, 6, -128, -128, 7, -128, -128, 8, -128, -128, 9, -128, -128, 10, -128)),
+            _mm_shuffle_epi8(c1, _mm_setr_epi8(5, -128, -128, 6, -128, -128, 7, -128, -128, 8, -128, -128, 9, -128, -128, 10))),
+            _mm_shuffle_epi8(c2, _mm_setr_epi8(-128, 5, -128, -128, 6, -128, -128, 7, -128, -128, 8, -128, -128, 9, -128, -128)));
+    const __m128i out2 = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(c0, _mm_setr_epi8(-128, 11, -128, -128, 12, -128, -128, 13, -128, -128, 14, -128, -128, 15, -128, -128)),
+            _mm_shuffle_epi8(c1, _mm_setr_epi8(-128, -128, 11, -128, -128, 12, -128, -128, 13, -128, -128, 14, -128, -128, 15, -128))),
+            _mm_shuffle_epi8(c2, _mm_setr_epi8(10, -128, -128, 11, -128, -128, 12, -128, -128, 13, -128, -128, 14, -128, -128, 15)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), out0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), out1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 32), out2);
+}
+
+// Deinterleaves 8 pixels of 16 bit three channel data (24 consecutive values).
+inline void loadDeinterleaved(const std::uint16_t* src, __m128i& c0, __m128i& c1, __m128i& c2) {
+    const __m128i in0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    const __m128i in1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 8));
+    const __m128i in2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+    c0 = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(in0, _mm_setr_epi8(0, 1, 6, 7, 12, 13, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128)),
+            _mm_shuffle_epi8(in1, _mm_setr_epi8(-128, -128, -128, -128, -128, -128, 2, 3, 8, 9, 14, 15, -128, -128, -128, -128))),
+            _mm_shuffle_epi8(in2, _mm_setr_epi8(-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 4, 5, 10, 11)));
+    c1 = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(in0, _mm_setr_epi8(2, 3, 8, 9, 14, 15, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128)),
+            _mm_shuffle_epi8(in1, _mm_setr_epi8(-128, -128, -128, -128, -128, -128, 4, 5, 10, 11, -128, -128, -128, -128, -128, -128))),
+            _mm_shuffle_epi8(in2, _mm_setr_epi8(-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 0, 1, 6, 7, 12, 13)));
+    c2 = _mm_or_si128(_mm_or_si128(
+            _mm_shuffle_epi8(in0, _mm_setr_epi8(4, 5, 10, 11, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128)),
+            _mm_shuffle_epi8(in1, _mm_setr_epi8(-128, -128, -128, -128, 0, 1, 6, 7, 12, 13, -128, -128, -128, -128, -128, -128))),
+            _mm_shuffle_epi8(in2, _mm_setr_epi8(-128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 2, 3, 8, 9, 14, 15)));
+}
+
+// Encodes 8 pixels of the upper and 8 pixels of the lower row of four 2x2 plaquettes.
+inline void encodeYCoCg8(const __m128i rgbTop[3], const __m128i rgbBottom[3], __m128i& top, __m128i& bottom) {
+    const int yShift = 16 - YCoCg::pixelDepth;
+    const __m128i maxValue = _mm_set1_epi16((1 << YCoCg::pixelDepth) - 1);
+    const __m128i one = _mm_set1_epi16(1);
+
+    __m128i ys[2], valid[2], coSum[2], cgSum[2];
+    const __m128i* ins[2] = {rgbTop, rgbBottom};
+    for (int i = 0; i < 2; ++i) {
+        const __m128i r = _mm_min_epu16(ins[i][0], maxValue);
+        const __m128i g = _mm_min_epu16(ins[i][1], maxValue);
+        const __m128i b = _mm_min_epu16(ins[i][2], maxValue);
+        const __m128i black = _mm_cmpeq_epi16(_mm_or_si128(_mm_or_si128(r, g), b), _mm_setzero_si128());
+        const __m128i y = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(_mm_add_epi16(r, b), _mm_add_epi16(g, g)),
+                                                       _mm_add_epi16(one, one)), 2);
+        ys[i] = _mm_andnot_si128(black, _mm_max_epu16(y, one));
+        valid[i] = _mm_andnot_si128(black, one);
+        coSum[i] = _mm_andnot_si128(black, _mm_sub_epi16(r, b));
+        cgSum[i] = _mm_andnot_si128(black, _mm_sub_epi16(_mm_add_epi16(g, g), _mm_add_epi16(r, b)));
+    }
+
+    // Horizontal pairs of the summed rows give the per plaquette sums in 32 bit lanes
+    const __m128i count = _mm_max_epi32(_mm_madd_epi16(_mm_add_epi16(valid[0], valid[1]), one), _mm_set1_epi32(1));
+    const __m128 countF = _mm_cvtepi32_ps(count);
+    const __m128i offset = _mm_set1_epi32(1 << YCoCg::pixelDepth);
+    const __m128i co = _mm_add_epi32(offset, _mm_cvtps_epi32(_mm_div_ps(
+            _mm_cvtepi32_ps(_mm_madd_epi16(_mm_add_epi16(coSum[0], coSum[1]), one)), countF)));
+    const __m128i cg = _mm_add_epi32(offset, _mm_cvtps_epi32(_mm_div_ps(
+            _mm_cvtepi32_ps(_mm_madd_epi16(_mm_add_epi16(cgSum[0], cgSum[1]), one)), _mm_add_ps(countF, countF))));
+
+    // Upper half of Co / Cg goes to the left pixel, lower half to the right pixel
+    const __m128i mask = _mm_set1_epi32((1 << yShift) - 1);
+    const __m128i coBits = _mm_or_si128(_mm_srli_epi32(co, yShift), _mm_slli_epi32(_mm_and_si128(co, mask), 16));
+    const __m128i cgBits = _mm_or_si128(_mm_srli_epi32(cg, yShift), _mm_slli_epi32(_mm_and_si128(cg, mask), 16));
+    top = _mm_or_si128(_mm_slli_epi16(ys[0], yShift), coBits);
+    bottom = _mm_or_si128(_mm_slli_epi16(ys[1], yShift), cgBits);
+}
+
+}  // namespace detail
+#endif
+
+template <typename OutType>
+void YCoCg::convertRows(const YCoCgType* src, size_t srcStride, int width, int firstRow, int endRow,
+                        OutType* dst, size_t dstStride, ChannelOrder order) {
+    static_assert(std::is_same_v<OutType, ChannelType> || std::is_same_v<OutType, std::uint8_t>,
+                  "Unsupported output channel type");
+    const int yShift = std::numeric_limits<ChannelType>::digits - pixelDepth;
+    const int outShift = std::is_same_v<OutType, std::uint8_t> ? pixelDepth - 8 : 0;
+    const ChannelType mask = static_cast<ChannelType>((1 << yShift) - 1);
+    const ChannelType delta = (1 << (pixelDepth - 1));
+    const ChannelType maxValue = 2 * delta - 1;
+    const int red = order == ChannelOrder::RGB ? 0 : 2;
+    const int blue = 2 - red;
+
+    for (int row = firstRow; row < endRow; row += 2) {
+        const auto* top = reinterpret_cast<const YCoCgType*>(reinterpret_cast<const std::uint8_t*>(src) + row * srcStride);
+        const auto* bottom = reinterpret_cast<const YCoCgType*>(reinterpret_cast<const std::uint8_t*>(top) + srcStride);
+        auto* outTop = reinterpret_cast<OutType*>(reinterpret_cast<std::uint8_t*>(dst) + row * dstStride);
+        auto* outBottom = reinterpret_cast<OutType*>(reinterpret_cast<std::uint8_t*>(outTop) + dstStride);
+
+        int col = 0;
+#if defined(PHO_SIMD_SSE41)
+        for (; col + 16 <= width; col += 16) {
+            __m128i rgb[2][2][3]; // [half][top/bottom][channel]
+            for (int half = 0; half < 2; ++half) {
+                detail::decodeYCoCg8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(top + col + 8 * half)),
+                                     _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + col + 8 * half)),
+                                     rgb[half][0], rgb[half][1]);
+            }
+            OutType* outs[2] = {outTop + 3 * col, outBottom + 3 * col};
+            for (int i = 0; i < 2; ++i) {
+                if constexpr (std::is_same_v<OutType, std::uint8_t>) {
+                    __m128i c[3];
+                    for (int ch = 0; ch < 3; ++ch) {
+                        c[ch] = _mm_packus_epi16(_mm_srli_epi16(rgb[0][i][ch], outShift),
+                                                 _mm_srli_epi16(rgb[1][i][ch], outShift));
+                    }
+                    detail::storeInterleaved(outs[i], c[red], c[1], c[blue]);
+                } else {
+                    for (int half = 0; half < 2; ++half) {
+                        detail::storeInterleaved(outs[i] + 24 * half, rgb[half][i][red], rgb[half][i][1], rgb[half][i][blue]);
+                    }
+                }
+            }
+        }
+#endif
+        for (; col < width; col += 2) {
+            const ChannelType co = ((top[col] & mask) << yShift) + (top[col + 1] & mask);
+            const ChannelType cg = ((bottom[col] & mask) << yShift) + (bottom[col + 1] & mask);
+            const ChannelType ys[4] = {ChannelType(top[col] >> yShift), ChannelType(top[col + 1] >> yShift),
+                                       ChannelType(bottom[col] >> yShift), ChannelType(bottom[col + 1] >> yShift)};
+            OutType* outs[4] = {outTop + 3 * col, outTop + 3 * col + 3, outBottom + 3 * col, outBottom + 3 * col + 3};
+            for (int i = 0; i < 4; ++i) {
+                // Branchless version of pixelRGB
+                const int y = ys[i];
+                const int black = y == 0 ? 0 : ~0;
+                const int r = std::max(2 * y + co - cg, 0) / 2;
+                const int g = std::max(y + cg / 2 - delta, 0);
+                const int b = std::max(y + 2 * delta - (co + cg) / 2, 0);
+                outs[i][red] = static_cast<OutType>((std::min<int>(r, maxValue) & black) >> outShift);
+                outs[i][1] = static_cast<OutType>((std::min<int>(g, maxValue) & black) >> outShift);
+                outs[i][blue] = static_cast<OutType>((std::min<int>(b, maxValue) & black) >> outShift);
+            }
+        }
+    }
+}
+
+inline void YCoCg::convertToRGB(const YCoCgType* src, size_t srcStride, int width, int height,
+                                ChannelType* dst, size_t dstStride, ChannelOrder order, unsigned threads) {
+    parallelRows(height, threads, [&](uint32_t firstRow, uint32_t endRow) {
+        convertRows(src, srcStride, width, firstRow, endRow, dst, dstStride, order);
+    }, 2);
+}
+
+inline void YCoCg::convertToRGB8(const YCoCgType* src, size_t srcStride, int width, int height,
+                                 std::uint8_t* dst, size_t dstStride, ChannelOrder order, unsigned threads) {
+    parallelRows(height, threads, [&](uint32_t firstRow, uint32_t endRow) {
+        convertRows(src, srcStride, width, firstRow, endRow, dst, dstStride, order);
+    }, 2);
+}
+
+inline void YCoCg::convertRowsFromRGB(const ChannelType* src, size_t srcStride, int width, int firstRow, int endRow,
+                                      YCoCgType* dst, size_t dstStride, ChannelOrder order) {
+    const int yShift = std::numeric_limits<ChannelType>::digits - pixelDepth;
+    const int mask = (1 << yShift) - 1;
+    const int maxValue = (1 << pixelDepth) - 1;
+    const int offset = 1 << pixelDepth;
+    const int red = order == ChannelOrder::RGB ? 0 : 2;
+    const int blue = 2 - red;
+
+    for (int row = firstRow; row < endRow; row += 2) {
+        const auto* top = reinterpret_cast<const ChannelType*>(reinterpret_cast<const std::uint8_t*>(src) + row * srcStride);
+        const auto* bottom = reinterpret_cast<const ChannelType*>(reinterpret_cast<const std::uint8_t*>(top) + srcStride);
+        auto* outTop = reinterpret_cast<YCoCgType*>(reinterpret_cast<std::uint8_t*>(dst) + row * dstStride);
+        auto* outBottom = reinterpret_cast<YCoCgType*>(reinterpret_cast<std::uint8_t*>(outTop) + dstStride);
+
+        int col = 0;
+#if defined(PHO_SIMD_SSE41)
+        for (; col + 8 <= width; col += 8) {
+            __m128i rgbTop[3], rgbBottom[3];
+            detail::loadDeinterleaved(top + 3 * col, rgbTop[red], rgbTop[1], rgbTop[blue]);
+            detail::loadDeinterleaved(bottom + 3 * col, rgbBottom[red], rgbBottom[1], rgbBottom[blue]);
+            __m128i ycocgTop, ycocgBottom;
+            detail::encodeYCoCg8(rgbTop, rgbBottom, ycocgTop, ycocgBottom);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(outTop + col), ycocgTop);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(outBottom + col), ycocgBottom);
+        }
+#endif
+        for (; col < width; col += 2) {
+            const ChannelType* pixels[4] = {top + 3 * col, top + 3 * col + 3, bottom + 3 * col, bottom + 3 * col + 3};
+            int ys[4];
+            int count = 0, coSum = 0, cgSum = 0;
+            for (int i = 0; i < 4; ++i) {
+                const int r = std::min<int>(pixels[i][red], maxValue);
+                const int g = std::min<int>(pixels[i][1], maxValue);
+                const int b = std::min<int>(pixels[i][blue], maxValue);
+                if (r == 0 && g == 0 && b == 0) {
+                    ys[i] = 0;
+                    continue;
+                }
+                ys[i] = std::max((r + 2 * g + b + 2) >> 2, 1);
+                ++count;
+                coSum += r - b;
+                cgSum += 2 * g - r - b;
+            }
+            // Same float division and rounding as the vectorized version
+            const float countF = static_cast<float>(std::max(count, 1));
+            const int co = offset + static_cast<int>(std::lrint(static_cast<float>(coSum) / countF));
+            const int cg = offset + static_cast<int>(std::lrint(static_cast<float>(cgSum) / (countF + countF)));
+            outTop[col] = static_cast<YCoCgType>((ys[0] << yShift) | (co >> yShift));
+            outTop[col + 1] = static_cast<YCoCgType>((ys[1] << yShift) | (co & mask));
+            outBottom[col] = static_cast<YCoCgType>((ys[2] << yShift) | (cg >> yShift));
+            outBottom[col + 1] = static_cast<YCoCgType>((ys[3] << yShift) | (cg & mask));
+        }
+    }
+}
+
+inline void YCoCg::convertFromRGB(const ChannelType* src, size_t srcStride, int width, int height,
+                                  YCoCgType* dst, size_t dstStride, ChannelOrder order, unsigned threads) {
+    parallelRows(height, threads, [&](uint32_t firstRow, uint32_t endRow) {
+        convertRowsFromRGB(src, srcStride, width, firstRow, endRow, dst, dstStride, order);
+    }, 2);
+}
+
+inline void YCoCg::convertFromRGB(const cv::Mat_<RGBType>& rgbImg, cv::Mat_<YCoCgType>& ycocgImg,
+                                  ChannelOrder order, unsigned threads) {
+    ycocgImg.create(rgbImg.size());
+    convertFromRGB(rgbImg[0][0].val, rgbImg.step, rgbImg.cols, rgbImg.rows,
+                   ycocgImg[0], ycocgImg.step, order, threads);
+}
+
+inline void YCoCg::convertToRGB(const cv::Mat_<YCoCgType>& ycocgImg, cv::Mat_<RGBType>& rgbImg, unsigned threads) {
+    rgbImg.create(ycocgImg.size());
+    convertToRGB(ycocgImg[0], ycocgImg.step, ycocgImg.cols, ycocgImg.rows,
+                 rgbImg[0][0].val, rgbImg.step, ChannelOrder::RGB, threads);
+}
+
+inline void YCoCg::convertToRGB8(const cv::Mat_<YCoCgType>& ycocgImg, cv::Mat_<RGB8Type>& rgbImg,
+                                 ChannelOrder order, unsigned threads) {
+    rgbImg.create(ycocgImg.size());
+    convertToRGB8(ycocgImg[0], ycocgImg.step, ycocgImg.cols, ycocgImg.rows,
+                  rgbImg[0][0].val, rgbImg.step, order, threads);
+}
 }
 
 #endif  // PHOTONEOMAIN_YCOCG_H
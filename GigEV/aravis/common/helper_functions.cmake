@@ -11,6 +11,11 @@ macro(find_aravis_dependencies)
 endmacro()
 
 find_aravis_dependencies()
+find_package(Threads REQUIRED)
+
+# Compile the host-side kernels in common/ (normals, YCoCg decoding etc.) with AVX2 / FMA (implies SSE4.1).
+# Only enable when the binaries will run on a CPU supporting it.
+option(PHO_ENABLE_AVX2 "Build examples with AVX2 optimized kernels" OFF)
 
 # Usage:
 # generate_example_app(<target_name>
@@ -50,6 +55,67 @@ function(generate_example_app TARGET)
     target_link_libraries(${TARGET}
         PRIVATE
             PkgConfig::aravis_deps
+            Threads::Threads
             ${MY_LINK_LIBS}
     )
+
+    if(PHO_ENABLE_AVX2)
+        if(MSVC)
+            target_compile_options(${TARGET} PRIVATE /arch:AVX2)
+        else()
+            target_compile_options(${TARGET} PRIVATE -mavx2 -mfma)
+        endif()
+    endif()
+endfunction()
+
+# Usage:
+# generate_benchmark_app(<target_name>
+#     SOURCES
+#         <source_file1>.cpp
+#     INCLUDE_DIRS
+#         <some_include_directory>
+#     LINK_LIBS
+#         <some_library>
+#     ARGS
+#         <arguments of the run target>
+# )
+#
+# Same as generate_example_app, plus:
+#  - optimized (-O2) in single configuration builds without CMAKE_BUILD_TYPE, timings of unoptimized code are
+#    meaningless,
+#  - a `run-<target_name>` target running the benchmark with ARGS, and a `benchmarks` target running all of them.
+function(generate_benchmark_app TARGET)
+    set(OPTIONS)
+    set(ONE_VALUE)
+    set(MULTI_VALUE SOURCES INCLUDE_DIRS LINK_LIBS ARGS)
+    cmake_parse_arguments(MY "${OPTIONS}" "${ONE_VALUE}" "${MULTI_VALUE}" ${ARGN})
+
+    if(MY_UNPARSED_ARGUMENTS)
+        message(FATAL_ERROR "Unknown arguments ${MY_UNPARSED_ARGUMENTS}")
+    endif()
+
+    generate_example_app(${TARGET}
+        SOURCES
+            ${MY_SOURCES}
+        INCLUDE_DIRS
+            ${MY_INCLUDE_DIRS}
+        LINK_LIBS
+            ${MY_LINK_LIBS}
+    )
+
+    get_property(MULTI_CONFIG GLOBAL PROPERTY GENERATOR_IS_MULTI_CONFIG)
+    if(NOT MULTI_CONFIG AND NOT CMAKE_BUILD_TYPE AND NOT MSVC)
+        target_compile_options(${TARGET} PRIVATE -O2)
+    endif()
+
+    add_custom_target(run-${TARGET}
+        COMMAND ${TARGET} ${MY_ARGS}
+        DEPENDS ${TARGET}
+        USES_TERMINAL
+        COMMENT "Running ${TARGET}"
+    )
+    if(NOT TARGET benchmarks)
+        add_custom_target(benchmarks)
+    endif()
+    add_dependencies(benchmarks run-${TARGET})
 endfunction()